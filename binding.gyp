@@ -77,6 +77,8 @@
     ],
     'variables': {
       'runtime_link%': 'shared',
+      # Build with `--sharp_profile_transitions=true` to report sandbox transitions in counters()
+      'sharp_profile_transitions%': 'false',
       'conditions': [
         ['OS != "win"', {
           'pkg_config_path': '<!(node -p "require(\'./lib/libvips\').pkgConfigPath()")',
@@ -99,6 +101,7 @@
       'src/pipeline_sandbox.cc',
       'src/utilities.cc',
       'src/rlbox_mgr.cc',
+      'src/rlbox_profile.cc',
       'src/sharp.cc'
     ],
     'include_dirs': [
@@ -106,6 +109,9 @@
       '../rlbox/code/include'
     ],
     'conditions': [
+      ['sharp_profile_transitions == "true"', {
+        'defines': ['SHARP_PROFILE_TRANSITIONS']
+      }],
       ['use_global_libvips == "true"', {
         # Use pkg-config for include and lib
         'include_dirs': ['<!@(PKG_CONFIG_PATH="<(pkg_config_path)" pkg-config --cflags-only-I vips-cpp vips glib-2.0 | sed s\/-I//g)'],
@@ -106,32 +106,53 @@ function pipelineColorspace (colorspace) {
  * Set the output colourspace.
  * By default output image will be web-friendly sRGB, with additional channels interpreted as alpha channels.
  *
+ * When a 16-bit input is output as 8-bit `srgb` or `b-w`, it is reduced to 8 bits straight after resizing
+ * rather than at the end, halving the memory traffic of later operations.
+ * This is skipped when an operation that works in absolute pixel values follows, such as `linear` or `threshold`.
+ *
  * @example
  * // Output 16 bits per pixel RGB
  * await sharp(input)
  *  .toColourspace('rgb16')
  *  .toFile('16-bpp.png')
  *
+ * @example
+ * // Keep 16 bits per channel until output
+ * await sharp(input)
+ *  .resize(320)
+ *  .toColourspace('srgb', { reduceEarly: false })
+ *  .toFile('8-bpp.jpg')
+ *
  * @param {string} [colourspace] - output colourspace e.g. `srgb`, `rgb`, `cmyk`, `lab`, `b-w` [...](https://github.com/libvips/libvips/blob/3c0bfdf74ce1dc37a6429bed47fa76f16e2cd70a/libvips/iofuncs/enumtypes.c#L777-L794)
+ * @param {Object} [options]
+ * @param {boolean} [options.reduceEarly=true] - reduce 16-bit images to 8 bits straight after resizing, when the output is 8-bit.
  * @returns {Sharp}
  * @throws {Error} Invalid parameters
  */
-function toColourspace (colourspace) {
+function toColourspace (colourspace, options) {
   if (!is.string(colourspace)) {
     throw is.invalidParameterError('colourspace', 'string', colourspace);
   }
   this.options.colourspace = colourspace;
+  if (is.object(options) && is.defined(options.reduceEarly)) {
+    if (is.bool(options.reduceEarly)) {
+      this.options.reduceEarly = options.reduceEarly;
+    } else {
+      throw is.invalidParameterError('reduceEarly', 'boolean', options.reduceEarly);
+    }
+  }
   return this;
 }
 
 /**
  * Alternative spelling of `toColourspace`.
  * @param {string} [colorspace] - output colorspace.
+ * @param {Object} [options]
  * @returns {Sharp}
  * @throws {Error} Invalid parameters
  */
-function toColorspace (colorspace) {
-  return this.toColourspace(colorspace);
+function toColorspace (colorspace, options) {
+  return this.toColourspace(colorspace, options);
 }
 
 /**
@@ -9,6 +9,7 @@ require('./sharp');
 
 // Use NODE_DEBUG=sharp to enable libvips warnings
 const debuglog = util.debuglog('sharp');
+const debuglogEnabled = debuglog.enabled === true || /\bsharp\b/i.test(process.env.NODE_DEBUG || '');
 
 /**
  * Constructor factory to create an instance of `sharp`, to which further methods are chained.
@@ -18,12 +19,16 @@ const debuglog = util.debuglog('sharp');
  *
  * Non-critical problems encountered during processing are emitted as `warning` events.
  *
+ * The order chosen for point-wise operations either side of a resize is emitted as a `plan` event,
+ * and is only worked out when there is a listener or `NODE_DEBUG=sharp` is set.
+ *
  * Implements the [stream.Duplex](http://nodejs.org/api/stream.html#stream_class_stream_duplex) class.
  *
  * @constructs Sharp
  *
  * @emits Sharp#info
  * @emits Sharp#warning
+ * @emits Sharp#plan
  *
  * @example
  * sharp('input.jpg')
@@ -176,6 +181,8 @@ const Sharp = function (input, options) {
     affineInterpolator: this.constructor.interpolators.bilinear,
     kernel: 'lanczos3',
     fastShrinkOnLoad: true,
+    reorderTolerance: 0,
+    debugPlan: debuglogEnabled,
     // operations
     tintA: 128,
     tintB: 128,
@@ -213,6 +220,7 @@ const Sharp = function (input, options) {
     ensureAlpha: -1,
     colourspace: 'srgb',
     colourspaceInput: 'last',
+    reduceEarly: true,
     composite: [],
     // output
     fileOut: '',
@@ -286,11 +294,21 @@ const Sharp = function (input, options) {
     timeoutSeconds: 0,
     linearA: 1,
     linearB: 0,
+    // metadata
+    metadataHeaderOnly: false,
+    // stats
+    statsApproximate: false,
+    statsMaxPixels: 1048576,
     // Function to notify of libvips warnings
     debuglog: warning => {
       this.emit('warning', warning);
       debuglog(warning);
     },
+    // Function to notify of the order of point-wise operations
+    planlog: plan => {
+      this.emit('plan', plan);
+      debuglog(plan);
+    },
     // Function to notify of queue length changes
     queueListener: function (queueLength) {
       Sharp.queue.emit('change', queueLength);
@@ -1,5 +1,7 @@
 'use strict';
 
+const os = require('os');
+const util = require('util');
 const color = require('color');
 const is = require('./is');
 const sharp = require('./sharp');
@@ -325,6 +327,8 @@ function _isStreamInput () {
  * - `iptc`: Buffer containing raw IPTC data, if present
  * - `xmp`: Buffer containing raw XMP data, if present
  * - `tifftagPhotoshop`: Buffer containing raw TIFFTAG_PHOTOSHOP data, if present
+ * - `headerComplete`: Boolean indicating whether the header could be parsed, when using `headerOnly`.
+ *   When `false`, only `format` is provided.
  *
  * @example
  * const metadata = await sharp(input).metadata();
@@ -354,10 +358,33 @@ function _isStreamInput () {
  *     : { width, height };
  * }
  *
+ * @example
+ * // Check the dimensions of an upload from its first 64 KiB, before accepting the rest
+ * const { format, width, height, headerComplete } = await sharp(prefix, { failOnError: false })
+ *   .metadata({ headerOnly: true });
+ * if (!headerComplete) {
+ *   // the header extends beyond the prefix, read more of the upload and try again
+ * }
+ *
+ * @param {Object} [options]
+ * @param {boolean} [options.headerOnly=false] - parse the header alone, ignoring `pages`, `page`, `level` and `subifd`,
+ *   and never touching pixel data. Buffer input may be a truncated prefix of the image, in which case
+ *   `headerComplete` reports whether the prefix contained the whole header. A header that is invalid,
+ *   rather than cut short, is an error. Formats whose loader must decode
+ *   pixels to read the header, such as those handled by ImageMagick, and raw or created input fail fast.
  * @param {Function} [callback] - called with the arguments `(err, metadata)`
  * @returns {Promise<Object>|Sharp}
+ * @throws {Error} Invalid parameters
  */
-function metadata (callback) {
+function metadata (options, callback) {
+  if (is.object(options) && is.defined(options.headerOnly)) {
+    this._setBooleanOption('metadataHeaderOnly', options.headerOnly);
+  } else if (this.options.metadataHeaderOnly) {
+    this.options.metadataHeaderOnly = false;
+  }
+  if (is.fn(options)) {
+    callback = options;
+  }
   if (is.fn(callback)) {
     if (this._isStreamInput()) {
       this.on('finish', () => {
@@ -415,6 +442,7 @@ function metadata (callback) {
  * - `entropy`: Histogram-based estimation of greyscale entropy, discarding alpha channel if any.
  * - `sharpness`: Estimation of greyscale sharpness based on the standard deviation of a Laplacian convolution, discarding alpha channel if any.
  * - `dominant`: Object containing most dominant sRGB colour based on a 4096-bin 3D histogram.
+ * - `samplingFactor`: When `approximate`, the ratio of input pixels to the pixels sampled, `1` when no reduction was possible.
  *
  * **Note**: Statistics are derived from the original input image. Any operations performed on the image must first be
  * written to a buffer in order to run `stats` on the result (see third example).
@@ -438,10 +466,40 @@ function metadata (callback) {
  * // create new instance to obtain statistics of extracted region
  * const stats = await sharp(part).stats();
  *
+ * @example
+ * // Entropy, sharpness, opacity and dominant colour of a reduced version of a large JPEG
+ * const { entropy, dominant, samplingFactor } = await sharp(input).stats({ approximate: true });
+ *
+ * @param {Object} [options]
+ * @param {boolean} [options.approximate=false] - derive statistics from a reduced version of the image,
+ *   using shrink-on-load for JPEG, WebP, SVG and PDF input and subsampling otherwise.
+ *   Channel sums describe the sampled pixels and positions are mapped back to the input.
+ * @param {number} [options.maxPixels=1048576] - when `approximate`, the number of pixels to reduce towards,
+ *   an integer between 1 and 2147483647. Shrink-on-load matches that of a resize with `fastShrinkOnLoad`.
  * @param {Function} [callback] - called with the arguments `(err, stats)`
  * @returns {Promise<Object>}
+ * @throws {Error} Invalid parameters
  */
-function stats (callback) {
+function stats (options, callback) {
+  if (is.object(options)) {
+    if (is.defined(options.approximate)) {
+      this._setBooleanOption('statsApproximate', options.approximate);
+    } else {
+      this.options.statsApproximate = false;
+    }
+    if (is.defined(options.maxPixels)) {
+      if (is.integer(options.maxPixels) && is.inRange(options.maxPixels, 1, 2147483647)) {
+        this.options.statsMaxPixels = options.maxPixels;
+      } else {
+        throw is.invalidParameterError('maxPixels', 'integer between 1 and 2147483647', options.maxPixels);
+      }
+    }
+  } else {
+    this.options.statsApproximate = false;
+  }
+  if (is.fn(options)) {
+    callback = options;
+  }
   if (is.fn(callback)) {
     if (this._isStreamInput()) {
       this.on('finish', () => {
@@ -480,6 +538,82 @@ function stats (callback) {
   }
 }
 
+/**
+ * Fast access to the basic metadata of many images in a single call.
+ *
+ * All inputs are read by a pool of native threads within one task,
+ * rather than queuing a task per image as `metadata` does.
+ * Results are returned by column, where element `i` of each typed array relates to `inputs[i]`.
+ *
+ * - `length`: Number of inputs
+ * - `formats`: Array of format names, indexed by the values in `format`, e.g. `jpeg`, `png`, `unknown`, `missing`
+ * - `format`: Uint8Array of format ids
+ * - `width`: Uint32Array of widths in pixels
+ * - `height`: Uint32Array of heights in pixels
+ * - `channels`: Uint8Array of the number of bands
+ * - `pages`: Uint32Array of the number of pages/frames
+ * - `hasAlpha`: Uint8Array, `1` where the image has an alpha channel
+ * - `orientation`: Uint8Array of EXIF Orientation values, `0` when absent
+ * - `errors`: Array of `{ index, message }` for each input that could not be read, whose other values are `0`
+ *
+ * @example
+ * const { length, formats, format, width, height, errors } = await sharp.metadataMany(files, { concurrency: 8 });
+ * for (let i = 0; i < length; i++) {
+ *   console.log(files[i], formats[format[i]], width[i], height[i]);
+ * }
+ *
+ * @param {Array<(Buffer|string)>} inputs - Buffers containing image data or paths to image files.
+ * @param {Object} [options] - input options, such as `failOnError` and `limitInputPixels`, apply to every input.
+ * @param {number} [options.concurrency] - number of threads, defaults to the number of CPU cores.
+ * @param {boolean} [options.headerOnly=false] - parse headers alone, see `metadata`.
+ * @returns {Promise<Object>}
+ * @throws {Error} Invalid parameters
+ */
+function metadataMany (inputs, options) {
+  if (!Array.isArray(inputs)) {
+    throw is.invalidParameterError('inputs', 'Array of Buffer or string', inputs);
+  }
+  const manyOptions = {
+    concurrency: os.cpus().length,
+    headerOnly: false,
+    debuglog: util.debuglog('sharp')
+  };
+  let inputOptions = {};
+  if (is.object(options)) {
+    const { concurrency, headerOnly, ...rest } = options;
+    if (is.defined(concurrency)) {
+      if (is.integer(concurrency) && is.inRange(concurrency, 1, 1024)) {
+        manyOptions.concurrency = concurrency;
+      } else {
+        throw is.invalidParameterError('concurrency', 'integer between 1 and 1024', concurrency);
+      }
+    }
+    if (is.defined(headerOnly)) {
+      if (is.bool(headerOnly)) {
+        manyOptions.headerOnly = headerOnly;
+      } else {
+        throw is.invalidParameterError('headerOnly', 'boolean', headerOnly);
+      }
+    }
+    inputOptions = rest;
+  }
+  const descriptors = inputs.map(function (input) {
+    if (!is.buffer(input) && !is.string(input)) {
+      throw is.invalidParameterError('input', 'Buffer or string', input);
+    }
+    return _createInputDescriptor(input, inputOptions);
+  });
+  return new Promise((resolve, reject) => {
+    sharp.metadataMany(descriptors, manyOptions, (err, metadata) => {
+      if (err) {
+        reject(err);
+      } else {
+        resolve(metadata);
+      }
+    });
+  });
+}
+
 /**
  * Decorate the Sharp prototype with input-related functions.
  * @private
@@ -496,4 +630,5 @@ module.exports = function (Sharp) {
     metadata,
     stats
   });
+  Sharp.metadataMany = metadataMany;
 };
@@ -1,6 +1,8 @@
 'use strict';
 
+const os = require('os');
 const path = require('path');
+const stream = require('stream');
 const is = require('./is');
 const sharp = require('./sharp');
 
@@ -143,6 +145,217 @@ function toBuffer (options, callback) {
   return this._pipeline(is.fn(options) ? options : callback);
 }
 
+/**
+ * Write several outputs of the same input to Buffers, for example a responsive image set.
+ *
+ * The input is decoded, rotated and converted to the processing colour space once,
+ * using shrink-on-load for the largest output where possible.
+ * Each smaller output is then resized from a larger one when that still leaves
+ * at least a factor of two, and all outputs are encoded in parallel.
+ *
+ * Every output inherits the operations already set on this instance.
+ * Each can then set its own `resize` options, as accepted by {@link /api-resize#resize|resize},
+ * and its own `format`, with `options`, as accepted by {@link #toformat|toFormat}.
+ *
+ * Resolves with an Array, in the order of `outputs`, of Objects containing `data` and `info` properties.
+ * If any output fails, the Promise is rejected with the first error.
+ *
+ * @example
+ * const [large, medium, small] = await sharp('input.jpg')
+ *   .rotate()
+ *   .toBuffers([
+ *     { resize: { width: 1600 }, format: 'jpeg', options: { quality: 80 } },
+ *     { resize: { width: 800 }, format: 'webp' },
+ *     { resize: { width: 400 }, format: 'webp' }
+ *   ]);
+ *
+ * @param {Array<Object>} outputs
+ * @param {Object} [outputs[].resize] - resize options for this output.
+ * @param {string} [outputs[].format] - output format for this output, defaults to matching the input.
+ * @param {Object} [outputs[].options] - output format options for this output.
+ * @returns {Promise<Array<Object>>}
+ * @throws {Error} Invalid parameters
+ */
+function toBuffers (outputs) {
+  if (!Array.isArray(outputs) || outputs.length === 0) {
+    throw is.invalidParameterError('outputs', 'non-empty Array', outputs);
+  }
+  outputs.forEach((output, i) => {
+    if (!is.object(output)) {
+      throw is.invalidParameterError(`outputs[${i}]`, 'object', output);
+    }
+  });
+  this.options.fileOut = '';
+  const run = () => {
+    // Each output is a view of this instance with its own copy of the options
+    const options = outputs.map((output) => {
+      const view = Object.create(this);
+      view.options = Object.assign({}, this.options);
+      if (is.defined(output.resize)) {
+        view.resize(output.resize);
+      }
+      if (is.defined(output.format)) {
+        view.toFormat(output.format, output.options);
+      }
+      return view.options;
+    });
+    return new Promise((resolve, reject) => {
+      sharp.pipelineMany(options, (err, results) => {
+        if (err) {
+          reject(err);
+        } else {
+          resolve(results);
+        }
+      });
+    });
+  };
+  if (this._isStreamInput()) {
+    return new Promise((resolve, reject) => {
+      this.once('finish', () => {
+        this._flattenBufferIn();
+        try {
+          run().then(resolve, reject);
+        } catch (err) {
+          reject(err);
+        }
+      });
+    });
+  }
+  return run();
+}
+
+/**
+ * Compile the operations and output options of a Sharp instance into a reusable template.
+ *
+ * The options are validated and marshalled into a native baton prototype once,
+ * so applying the template to an input only needs to describe that input.
+ * The instance used to build the template can not reference other inputs,
+ * as `composite`, `joinChannel` and `boolean` do, and its own input is ignored.
+ *
+ * The template has a `toBuffer(input, options)` method, accepting the same
+ * `input` and `options` as the constructor, which returns a Promise
+ * that resolves with an Object containing `data` and `info` properties.
+ *
+ * @example
+ * const thumbnail = sharp.compile(
+ *   sharp().rotate().resize(320, 240).webp({ quality: 70 })
+ * );
+ * const { data, info } = await thumbnail.toBuffer('input.jpg');
+ *
+ * @param {Sharp} pipeline - the instance to compile.
+ * @returns {Object}
+ * @throws {Error} Invalid parameters
+ */
+function compile (pipeline) {
+  if (!is.object(pipeline) || !is.object(pipeline.options) || !is.fn(pipeline._createInputDescriptor)) {
+    throw is.invalidParameterError('pipeline', 'Sharp instance', pipeline);
+  }
+  const options = Object.assign({}, pipeline.options, { fileOut: '' });
+  if (options.composite.length > 0 || options.joinChannelIn.length > 0 || is.defined(options.boolean)) {
+    throw new Error('Compiled pipelines can not reference other inputs');
+  }
+  delete options.input;
+  const template = sharp.compile(options);
+  return {
+    _template: template,
+    _options: options,
+    _createInputDescriptor: (input, inputOptions) => pipeline._createInputDescriptor(input, inputOptions),
+    toBuffer: function (input, inputOptions) {
+      const descriptor = this._createInputDescriptor(input, inputOptions);
+      return new Promise((resolve, reject) => {
+        sharp.pipelineFromTemplate(template, options, descriptor, (err, data, info) => {
+          if (err) {
+            reject(err);
+          } else {
+            resolve({ data, info });
+          }
+        });
+      });
+    }
+  };
+}
+
+/**
+ * Run many inputs through a template created by {@link #compile|compile}, within one asynchronous operation.
+ *
+ * Inputs are processed by a pool of native threads, avoiding the per-request overhead
+ * of queuing a task for each, which dominates when the images are small.
+ *
+ * Returns an object mode Readable stream of results, in order of completion.
+ * Each result is an Object containing the `index` of its input and either
+ * `data` and `info` properties, as resolved by `toBuffer`, or an `error`.
+ * No more than `concurrency` inputs are in flight, and further inputs wait while results are not being read.
+ * The stream ends once every input has been processed. Destroying it stops further inputs from being started.
+ *
+ * @example
+ * const thumbnail = sharp.compile(sharp().resize(160, 120).jpeg());
+ * for await (const { index, data, info, error } of sharp.batch(files, thumbnail, { concurrency: 4 })) {
+ *   ...
+ * }
+ *
+ * @param {Array<(Buffer|string)>} inputs - Buffers containing image data or paths to image files.
+ * @param {Object} template - a template returned by `compile`.
+ * @param {Object} [options] - input options, such as `failOnError` and `limitInputPixels`, apply to every input.
+ * @param {number} [options.concurrency] - number of threads, defaults to the number of CPU cores.
+ * @returns {Stream}
+ * @throws {Error} Invalid parameters
+ */
+function batch (inputs, template, options) {
+  if (!Array.isArray(inputs)) {
+    throw is.invalidParameterError('inputs', 'Array of Buffer or string', inputs);
+  }
+  if (!is.object(template) || !is.defined(template._template)) {
+    throw is.invalidParameterError('template', 'template returned by compile', template);
+  }
+  let concurrency = os.cpus().length;
+  let inputOptions = {};
+  if (is.object(options)) {
+    const { concurrency: threads, ...rest } = options;
+    if (is.defined(threads)) {
+      if (is.integer(threads) && is.inRange(threads, 1, 1024)) {
+        concurrency = threads;
+      } else {
+        throw is.invalidParameterError('concurrency', 'integer between 1 and 1024', threads);
+      }
+    }
+    inputOptions = rest;
+  }
+  const descriptors = inputs.map(function (input) {
+    if (!is.buffer(input) && !is.string(input)) {
+      throw is.invalidParameterError('input', 'Buffer or string', input);
+    }
+    return template._createInputDescriptor(input, inputOptions);
+  });
+  // Further inputs are prepared only as results are read, and none once the stream is destroyed
+  let pending = null;
+  const results = new stream.Readable({
+    objectMode: true,
+    read () {
+      if (pending !== null) {
+        sharp.pipelineBatchResume(pending, false);
+      }
+    },
+    destroy (err, callback) {
+      if (pending !== null) {
+        sharp.pipelineBatchResume(pending, true);
+      }
+      callback(err);
+    }
+  });
+  if (descriptors.length === 0) {
+    results.push(null);
+  } else {
+    pending = sharp.pipelineBatch(template._template, template._options, descriptors, concurrency,
+      (err, index, data, info) => results.push(err ? { index, error: err } : { index, data, info }),
+      () => {
+        pending = null;
+        results.push(null);
+      }
+    );
+  }
+  return results;
+}
+
 /**
  * Include all metadata (EXIF, XMP, IPTC) from the input image in the output image.
  * This will also convert to and add a web-friendly sRGB ICC profile unless a custom
@@ -1109,6 +1322,9 @@ function _read () {
  * @private
  */
 function _pipeline (callback) {
+  if (this.listenerCount('plan') > 0) {
+    this.options.debugPlan = true;
+  }
   if (typeof callback === 'function') {
     // output=file/buffer
     if (this._isStreamInput()) {
@@ -1204,6 +1420,7 @@ module.exports = function (Sharp) {
     // Public
     toFile,
     toBuffer,
+    toBuffers,
     withMetadata,
     toFormat,
     jpeg,
@@ -1223,4 +1440,6 @@ module.exports = function (Sharp) {
     _read,
     _pipeline
   });
+  Sharp.compile = compile;
+  Sharp.batch = batch;
 };
@@ -215,7 +215,8 @@ function isRotationExpected (options) {
  * @param {String} [options.kernel='lanczos3'] - the kernel to use for image reduction.
  * @param {Boolean} [options.withoutEnlargement=false] - do not enlarge if the width *or* height are already less than the specified dimensions, equivalent to GraphicsMagick's `>` geometry option.
  * @param {Boolean} [options.withoutReduction=false] - do not reduce if the width *or* height are already greater than the specified dimensions, equivalent to GraphicsMagick's `<` geometry option.
- * @param {Boolean} [options.fastShrinkOnLoad=true] - take greater advantage of the JPEG and WebP shrink-on-load feature, which can lead to a slight moiré pattern on some images.
+ * @param {Boolean} [options.fastShrinkOnLoad=true] - take greater advantage of the JPEG and WebP shrink-on-load feature, and of the reduced levels of TIFF pyramids, OpenSlide slides and HEIF thumbnails, which can lead to a slight moiré pattern on some images.
+ * @param {number} [options.reorderTolerance=0] - worst-case difference, in 8-bit levels, allowed when running point-wise operations such as `negate` and colour profile conversion after a reduction rather than before it, where they touch fewer pixels. The default keeps the order of the pipeline; 1 allows only rounding differences, which covers `negate`, and profile conversion needs 56 or more. `greyscale` of a colour image always runs before, leaving the reduction a single channel. The chosen order is emitted as a `plan` event and reported via `NODE_DEBUG=sharp`.
  * @returns {Sharp}
  * @throws {Error} Invalid parameters
  */
@@ -299,6 +300,14 @@ function resize (width, height, options) {
     if (is.defined(options.fastShrinkOnLoad)) {
       this._setBooleanOption('fastShrinkOnLoad', options.fastShrinkOnLoad);
     }
+    // Point-wise operations after reduction
+    if (is.defined(options.reorderTolerance)) {
+      if (is.number(options.reorderTolerance) && is.inRange(options.reorderTolerance, 0, 255)) {
+        this.options.reorderTolerance = options.reorderTolerance;
+      } else {
+        throw is.invalidParameterError('reorderTolerance', 'number between 0 and 255', options.reorderTolerance);
+      }
+    }
   }
   return this;
 }
@@ -72,29 +72,35 @@ try {
  * This method always returns cache statistics,
  * useful for determining how much working memory is required for a particular task.
  *
+ * Embedded ICC profiles that cannot be transformed are remembered by digest across requests,
+ * so each is parsed only once. The `icc` statistics report how many are remembered
+ * and how many transforms were `skipped` because their profile was already known to fail.
+ *
  * @example
  * const stats = sharp.cache();
  * @example
  * sharp.cache( { items: 200 } );
  * sharp.cache( { files: 0 } );
+ * sharp.cache( { icc: 16 } );
  * sharp.cache(false);
  *
  * @param {Object|boolean} [options=true] - Object with the following attributes, or boolean where true uses default cache settings and false removes all caching
  * @param {number} [options.memory=50] - is the maximum memory in MB to use for this cache
  * @param {number} [options.files=20] - is the maximum number of files to hold open
  * @param {number} [options.items=100] - is the maximum number of operations to cache
+ * @param {number} [options.icc=64] - is the maximum number of rejected embedded ICC profiles to remember
  * @returns {Object}
  */
 function cache (options) {
   if (is.bool(options)) {
     if (options) {
-      // Default cache settings of 50MB, 20 files, 100 items
-      return sharp.cache(50, 20, 100);
+      // Default cache settings of 50MB, 20 files, 100 items, 64 profiles
+      return sharp.cache(50, 20, 100, 64);
     } else {
-      return sharp.cache(0, 0, 0);
+      return sharp.cache(0, 0, 0, 0);
     }
   } else if (is.object(options)) {
-    return sharp.cache(options.memory, options.files, options.items);
+    return sharp.cache(options.memory, options.files, options.items, options.icc);
   } else {
     return sharp.cache();
   }
@@ -127,6 +133,171 @@ cache(true);
 function concurrency (concurrency) {
   return sharp.concurrency(is.integer(concurrency) ? concurrency : null);
 }
+
+/**
+ * Gets or, when a size is provided, sets
+ * the number of sandboxes _libvips_ runs in.
+ *
+ * Each queued image leases one sandbox until it completes,
+ * so images only share a sandbox once every sandbox in the pool is in use.
+ *
+ * The default value is libuv's `UV_THREADPOOL_SIZE`, or `4` when unset,
+ * which allows every worker thread to run in its own sandbox.
+ *
+ * A value of `0` will reset this to the default.
+ *
+ * This method always returns the current pool size.
+ *
+ * @example
+ * const pool = sharp.sandboxes(); // 4
+ * sharp.sandboxes(8); // 8
+ * sharp.sandboxes(0); // 4
+ *
+ * @param {number} [sandboxes]
+ * @returns {number} sandboxes
+ */
+function sandboxes (sandboxes) {
+  return sharp.sandboxes(is.integer(sandboxes) && sandboxes >= 0 ? sandboxes : null);
+}
+
+/**
+ * Gets or, when options are provided, sets the policy for recycling sandboxes.
+ *
+ * Fragmentation from images of varying size can cause a long-lived sandbox to hold on to memory.
+ * A sandbox can be retired after a number of requests,
+ * or once the _libvips_ memory high-water mark has grown by a number of megabytes while it was in use.
+ * Images already queued on a retired sandbox complete there,
+ * after which it is destroyed, and a replacement sandbox is created by the next request that needs one.
+ *
+ * With the noop sandbox, which is the only backend currently built, every sandbox shares
+ * the memory of the process: destroying a retired sandbox does not return _libvips'_ heap,
+ * so recycling does not bound resident memory. The high-water mark is also process-wide and never falls,
+ * so the `memory` limit stops retiring sandboxes once the peak for the workload has been reached.
+ *
+ * A value of `0` disables that limit, which is the default for both.
+ *
+ * @example
+ * sharp.recycle({ requests: 1000, memory: 512 });
+ * // { requests: 1000, memory: 512, recycled: 0 }
+ *
+ * @param {Object} [options]
+ * @param {number} [options.requests=0] - retire a sandbox after this many requests.
+ * @param {number} [options.memory=0] - retire a sandbox once its memory high-water mark has grown by this many megabytes.
+ * @returns {Object} the current policy and the number of sandboxes recycled so far.
+ * @throws {Error} Invalid parameters
+ */
+function recycle (options) {
+  if (is.object(options)) {
+    const requests = is.defined(options.requests) ? options.requests : 0;
+    const memory = is.defined(options.memory) ? options.memory : 0;
+    if (!is.integer(requests) || !is.inRange(requests, 0, 4294967295)) {
+      throw is.invalidParameterError('requests', 'integer between 0 and 4294967295', requests);
+    }
+    if (!is.integer(memory) || !is.inRange(memory, 0, 4294967295)) {
+      throw is.invalidParameterError('memory', 'integer between 0 and 4294967295', memory);
+    }
+    return sharp.recycle(requests, memory);
+  }
+  return sharp.recycle();
+}
+
+/**
+ * Filename suffixes of the formats that can be warmed up.
+ * @private
+ */
+const warmupFormats = {
+  jpeg: '.jpg',
+  png: '.png',
+  webp: '.webp',
+  tiff: '.tif',
+  gif: '.gif',
+  avif: '.avif',
+  heif: '.heic',
+  jp2: '.jp2'
+};
+
+/**
+ * Creates sandboxes ahead of the first image being processed,
+ * then encodes and decodes a tiny image of each of the given formats in every one of them.
+ *
+ * This moves the cost of sandbox creation and of loading format support
+ * out of the first requests, at the expense of blocking while it runs.
+ *
+ * The same can be achieved at module load by setting the `SHARP_WARMUP` environment variable
+ * to a comma-separated list of formats, e.g. `SHARP_WARMUP=jpeg,png,webp`,
+ * or to `true` to only create sandboxes.
+ *
+ * @example
+ * sharp.warmup({ formats: ['jpeg', 'webp'] });
+ * // { sandboxes: 4, formats: ['jpeg', 'webp'] }
+ *
+ * @param {Object} [options]
+ * @param {number} [options.sandboxes] - number of sandboxes to create, defaults to and is limited by `sharp.sandboxes()`.
+ * @param {Array<string>} [options.formats=[]] - any of `jpeg`, `png`, `webp`, `tiff`, `gif`, `avif`, `heif` and `jp2`.
+ * @returns {Object} number of sandboxes created and the formats that were successfully warmed up.
+ * @throws {Error} Invalid parameters
+ */
+function warmup (options) {
+  let count = 0;
+  let formats = [];
+  if (is.object(options)) {
+    if (is.defined(options.sandboxes)) {
+      if (is.integer(options.sandboxes) && options.sandboxes > 0) {
+        count = options.sandboxes;
+      } else {
+        throw is.invalidParameterError('sandboxes', 'positive integer', options.sandboxes);
+      }
+    }
+    if (is.defined(options.formats)) {
+      if (Array.isArray(options.formats) && options.formats.every(format => is.inArray(format, Object.keys(warmupFormats)))) {
+        formats = options.formats;
+      } else {
+        throw is.invalidParameterError('formats', `array containing any of: ${Object.keys(warmupFormats).join(', ')}`, options.formats);
+      }
+    }
+  }
+  const warmed = sharp.warmup(count, formats.map(format => warmupFormats[format]));
+  return {
+    sandboxes: warmed.sandboxes,
+    formats: formats.filter(format => warmed.formats.includes(warmupFormats[format]))
+  };
+}
+
+/* istanbul ignore next */
+if (process.env.SHARP_WARMUP) {
+  const formats = process.env.SHARP_WARMUP.split(',')
+    .map(format => format.trim().toLowerCase())
+    .filter(format => is.inArray(format, Object.keys(warmupFormats)));
+  warmup({ formats });
+}
+
+/**
+ * Allocates a Buffer in memory the image decoders can read directly.
+ *
+ * Filling such a Buffer, for example from a network response or `fs.read`,
+ * and then using it as input avoids any copy of the compressed image
+ * on its way to _libvips_.
+ * Output Buffers from `toBuffer` are allocated in the same way
+ * and can also be used as input without a copy.
+ *
+ * Any other Buffer can still be used as input.
+ *
+ * @example
+ * const input = sharp.allocInputBuffer(size);
+ * await fs.promises.read(fd, input, 0, size, 0);
+ * const output = await sharp(input).resize(320).toBuffer();
+ *
+ * @param {number} size - number of bytes, between 1 and 2147483647
+ * @returns {Buffer} uninitialised Buffer of `size` bytes
+ * @throws {Error} Invalid parameters
+ */
+function allocInputBuffer (size) {
+  if (!is.integer(size) || !is.inRange(size, 1, 2147483647)) {
+    throw is.invalidParameterError('size', 'integer between 1 and 2147483647', size);
+  }
+  return sharp.allocInputBuffer(size);
+}
+
 /* istanbul ignore next */
 if (detectLibc.familySync() === detectLibc.GLIBC && !sharp._isUsingJemalloc()) {
   // Reduce default concurrency to 1 when using glibc memory allocator
@@ -149,6 +320,9 @@ const queue = new events.EventEmitter();
  * Provides access to internal task counters.
  * - queue is the number of tasks this module has queued waiting for _libuv_ to provide a worker thread from its pool.
  * - process is the number of resize tasks currently being processed.
+ * - transitions, only when built with `--sharp_profile_transitions=true`, reports calls into the sandbox
+ *   as `symbols` (calls and cumulative time in milliseconds per function)
+ *   plus the `bytesIn` and `bytesOut` copied across the sandbox boundary.
  *
  * @example
  * const counters = sharp.counters(); // { queue: 2, process: 4 }
@@ -188,6 +362,10 @@ simd(true);
 module.exports = function (Sharp) {
   Sharp.cache = cache;
   Sharp.concurrency = concurrency;
+  Sharp.sandboxes = sandboxes;
+  Sharp.recycle = recycle;
+  Sharp.warmup = warmup;
+  Sharp.allocInputBuffer = allocInputBuffer;
   Sharp.counters = counters;
   Sharp.simd = simd;
   Sharp.format = format;
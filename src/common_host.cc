@@ -12,12 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cstdlib>
 #include <string>
 #include <string.h>
 #include <vector>
 #include <queue>
 #include <map>
+#include <new>
+#include <utility>
 #include <mutex>  // NOLINT(build/c++11)
 
 #include <napi.h>
@@ -75,6 +78,18 @@ namespace sharp {
     return vector;
   }
 
+  // Lease a sandbox for a task, preferring the one that holds its input buffer
+  rlbox_sandbox_vips* AcquireSandboxForInput(Napi::Object input) {
+    if (HasAttr(input, "buffer")) {
+      Napi::Buffer<char> buffer = input.Get("buffer").As<Napi::Buffer<char>>();
+      rlbox_sandbox_vips* holder = SandboxHoldingBuffer(buffer.Data(), buffer.Length());
+      if (holder != nullptr) {
+        return AcquireVipsSandbox(holder);
+      }
+    }
+    return AcquireVipsSandbox();
+  }
+
   // Create an InputDescriptor instance from a Napi::Object describing an input image
   tainted_vips<InputDescriptor*> CreateInputDescriptor(rlbox_sandbox_vips* sandbox, Napi::Object input) {
     tainted_vips<InputDescriptor*> t_descriptor = sandbox->invoke_sandbox_function(CreateEmptyInputDescriptor);
@@ -82,6 +97,8 @@ namespace sharp {
     if (HasAttr(input, "file")) {
       InputDescriptor_SetFile(descriptor, AttrAsStr(input, "file").c_str());
     } else if (HasAttr(input, "buffer")) {
+      // Buffers from allocInputBuffer, or earlier output, are already in sandbox memory;
+      // any other Buffer is only readable because the noop sandbox shares the host address space
       Napi::Buffer<char> buffer = input.Get("buffer").As<Napi::Buffer<char>>();
       InputDescriptor_SetBufferLength(descriptor, buffer.Length());
       InputDescriptor_SetBuffer(descriptor, buffer.Data());
@@ -95,8 +112,7 @@ namespace sharp {
     // Raw pixel input
     if (HasAttr(input, "rawChannels")) {
       InputDescriptor_SetRawDepth(descriptor,
-        vips_enum_from_nick(nullptr, VIPS_TYPE_BAND_FORMAT,
-        AttrAsStr(input, "rawDepth").data()));
+        EnumFromNick(VIPS_TYPE_BAND_FORMAT, AttrAsStr(input, "rawDepth")));
       InputDescriptor_SetRawChannels(descriptor, AttrAsUint32(input, "rawChannels"));
       InputDescriptor_SetRawWidth(descriptor, AttrAsUint32(input, "rawWidth"));
       InputDescriptor_SetRawHeight(descriptor, AttrAsUint32(input, "rawHeight"));
@@ -157,6 +173,45 @@ namespace sharp {
     delete data;
   };
 
+  struct SandboxBufferHint {
+    rlbox_sandbox_vips* sandbox;
+    tainted_vips<char*> t_data;
+  };
+
+  /*
+    Live Buffers backed by sandbox memory, keyed by start address, only accessed from the JS thread
+  */
+  std::map<char const*, std::pair<size_t, rlbox_sandbox_vips*>> sandboxBuffers;
+
+  Napi::Buffer<char> NewBufferFromSandbox(Napi::Env env, rlbox_sandbox_vips* sandbox,
+    tainted_vips<char*> t_data, size_t length) {
+    // Checks that the whole range lies within sandbox memory; the content is opaque encoded output
+    char* data = t_data.unverified_safe_pointer_because(length, "Output bytes are passed to JS as-is");
+    // The sandbox must outlive the Buffer, as it owns the memory
+    PinVipsSandbox(sandbox);
+    sandboxBuffers[data] = std::make_pair(length, sandbox);
+    return Napi::Buffer<char>::New(env, data, length, [](Napi::Env, char* data, SandboxBufferHint* hint) {
+      sandboxBuffers.erase(data);
+      hint->sandbox->free_in_sandbox(hint->t_data);
+      UnpinVipsSandbox(hint->sandbox);
+      delete hint;
+    }, new SandboxBufferHint{ sandbox, t_data });
+  }
+
+  rlbox_sandbox_vips* SandboxHoldingBuffer(char const* data, size_t length) {
+    auto it = sandboxBuffers.upper_bound(data);
+    if (it == sandboxBuffers.begin()) {
+      return nullptr;
+    }
+    --it;
+    char const* start = it->first;
+    size_t const size = it->second.first;
+    if (data + length > start + size) {
+      return nullptr;
+    }
+    return it->second.second;
+  }
+
   /*
     Temporary buffer of warnings
   */
@@ -184,39 +239,120 @@ namespace sharp {
     return warning;
   }
 
-  tainted_vips<const char*> CopyStringToSandbox(rlbox_sandbox_vips* sandbox, const char* str) {
+  // Blocks are at least this large, enough for the options of a typical request
+  static size_t const sandboxArenaBlockSize = 16384;
+
+  void SandboxArena::NewBlock(size_t minimum) {
+    size_t const size = std::max(minimum, sandboxArenaBlockSize);
+    tainted_vips<char*> t_block = sandbox->malloc_in_sandbox<char>(size);
+    if (t_block == nullptr) {
+      throw std::bad_alloc();
+    }
+    blocks.push_back(t_block);
+    used = 0;
+    capacity = size;
+  }
+
+  void SandboxArena::Release() {
+    for (auto const &t_block : blocks) {
+      sandbox->free_in_sandbox(t_block);
+    }
+    blocks.clear();
+    used = 0;
+    capacity = 0;
+  }
+
+  tainted_vips<const char*> CopyStringToSandbox(SandboxArena &arena, const char* str) {
     if (!str) {
       return nullptr;
     }
 
     const uint32_t lenString = strnlen(str, std::numeric_limits<uint32_t>::max() - 1);
     const uint32_t len = lenString + 1;
-    tainted_vips<char*> t_str = sandbox->malloc_in_sandbox<char>(len);
+    tainted_vips<char*> t_str = arena.Alloc<char>(len);
     strncpy(t_str.unverified_safe_pointer_because(len, "String copy"), str, len);
+    profile::CountBytesIn(len);
     return rlbox::sandbox_const_cast<const char*>(t_str);
   }
 
-  tainted_vips<int> SandboxVipsEnumFromNick(rlbox_sandbox_vips* sandbox, const char *domain, GType type, const char *str) {
-    tainted_vips<const char*> t_domain = CopyStringToSandbox(sandbox, domain);
-    tainted_vips<const char*> t_str = CopyStringToSandbox(sandbox, str);
-
-    tainted_vips<int> ret = sandbox->invoke_sandbox_function(vips_enum_from_nick, t_domain, type, t_str);
+  /*
+    Nick/value pairs of each enum, written once by InitEnumTables and read-only afterwards.
+    Each table has at most a few dozen entries, so a linear scan is cheaper than hashing.
+  */
+  typedef std::vector<std::pair<std::string, int>> EnumTable;
+  static std::vector<std::pair<GType, EnumTable>> enumTables;
 
-    if (t_domain) {
-      sandbox->free_in_sandbox(t_domain);
-    }
-    if (t_str) {
-      sandbox->free_in_sandbox(t_str);
+  static EnumTable const *FindEnumTable(GType type) {
+    for (auto const &table : enumTables) {
+      if (table.first == type) {
+        return &table.second;
+      }
     }
-    return ret;
+    return nullptr;
   }
 
-  std::string SandboxVipsEnumNick(rlbox_sandbox_vips* sandbox, GType enm, tainted_vips<int> value) {
-    tainted_vips<const char*> t_ret = sandbox->invoke_sandbox_function(vips_enum_nick, enm, value);
-    std::string ret = t_ret.copy_and_verify_string([](std::string val) {
-      return val;
+  void InitEnumTables(rlbox_sandbox_vips* sandbox) {
+    static std::once_flag enumTablesOnce;
+    std::call_once(enumTablesOnce, [sandbox]() {
+      GType const types[] = {
+        VIPS_TYPE_BAND_FORMAT,
+        VIPS_TYPE_BLEND_MODE,
+        VIPS_TYPE_FOREIGN_TIFF_COMPRESSION,
+        VIPS_TYPE_FOREIGN_TIFF_PREDICTOR,
+        VIPS_TYPE_FOREIGN_TIFF_RESUNIT,
+        VIPS_TYPE_FOREIGN_HEIF_COMPRESSION,
+        VIPS_TYPE_FOREIGN_DZ_CONTAINER,
+        VIPS_TYPE_FOREIGN_DZ_LAYOUT,
+        VIPS_TYPE_FOREIGN_DZ_DEPTH
+      };
+      for (GType const type : types) {
+        EnumTable table;
+        int const count = sandbox->invoke_sandbox_function(Enum_GetCount, type)
+          .copy_and_verify([](int val) {
+            // Enums with more values than this do not exist in libvips
+            return val >= 0 && val <= 256 ? val : 0;
+          });
+        for (int i = 0; i < count; i++) {
+          std::string nick = sandbox->invoke_sandbox_function(Enum_GetNick, type, i)
+            .copy_and_verify_string([](std::string val) {
+              // An invalid nick can only fail to match an option
+              return val;
+            });
+          if (nick.empty()) {
+            continue;
+          }
+          // Any value is as good as the one vips_enum_from_nick would have returned
+          int const value = sandbox->invoke_sandbox_function(Enum_GetValue, type, i)
+            .unverified_safe_because("Enum values are only passed back into the sandbox");
+          table.emplace_back(nick, value);
+        }
+        enumTables.emplace_back(type, std::move(table));
+      }
     });
-    return ret;
+  }
+
+  int EnumFromNick(GType type, std::string const &nick) {
+    EnumTable const *table = FindEnumTable(type);
+    if (table != nullptr) {
+      for (auto const &entry : *table) {
+        if (entry.first == nick) {
+          return entry.second;
+        }
+      }
+    }
+    return -1;
+  }
+
+  std::string EnumNick(GType type, int value) {
+    EnumTable const *table = FindEnumTable(type);
+    if (table != nullptr) {
+      for (auto const &entry : *table) {
+        if (entry.second == value) {
+          return entry.first;
+        }
+      }
+    }
+    return "";
   }
 
 }
\ No newline at end of file
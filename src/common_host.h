@@ -16,6 +16,7 @@
 #define SRC_COMMON_HOST_H_
 
 #include <string>
+#include <vector>
 
 #include <napi.h>
 
@@ -38,6 +39,9 @@ namespace sharp {
   std::vector<double> AttrAsVectorOfDouble(Napi::Object obj, std::string attr);
   std::vector<int32_t> AttrAsInt32Vector(Napi::Object obj, std::string attr);
 
+  // Lease a sandbox for a task, preferring the one that holds its input buffer
+  rlbox_sandbox_vips* AcquireSandboxForInput(Napi::Object input);
+
   // Create an InputDescriptor instance from a Napi::Object describing an input image
   tainted_vips<InputDescriptor*> CreateInputDescriptor(rlbox_sandbox_vips* sandbox, Napi::Object input);
 
@@ -54,6 +58,18 @@ namespace sharp {
   extern std::function<void(void*, char*)> FreeCallback;
   extern std::function<void(void*, char*)> DeleteCallback;
 
+  /*
+    Wrap memory allocated in the sandbox as a Buffer without copying it.
+    Only the bounds are verified; the memory is freed in the sandbox when the Buffer undergoes GC.
+  */
+  Napi::Buffer<char> NewBufferFromSandbox(Napi::Env env, rlbox_sandbox_vips* sandbox,
+    tainted_vips<char*> t_data, size_t length);
+
+  /*
+    Find the sandbox holding a Buffer created by NewBufferFromSandbox, or a view into one
+  */
+  rlbox_sandbox_vips* SandboxHoldingBuffer(char const* data, size_t length);
+
   /*
     Called with warnings from the glib-registered "VIPS" domain
   */
@@ -65,33 +81,75 @@ namespace sharp {
   std::string VipsWarningPop();
 
   /*
-    Copy string to the given sandbox
+    Bump allocator over blocks of sandbox memory for the transient allocations of one request.
+    Nothing is freed individually; every block is released together once the baton is destroyed.
+  */
+  class SandboxArena {
+   public:
+    explicit SandboxArena(rlbox_sandbox_vips* sandbox) : sandbox(sandbox), used(0), capacity(0) {}
+    ~SandboxArena() { Release(); }
+    SandboxArena(SandboxArena const &) = delete;
+    SandboxArena& operator=(SandboxArena const &) = delete;
+
+    template<typename T>
+    tainted_vips<T*> Alloc(size_t count = 1) {
+      size_t const bytes = (count == 0 ? 1 : count) * sizeof(T);
+      size_t offset = (used + alignof(T) - 1) & ~(alignof(T) - 1);
+      if (blocks.empty() || offset + bytes > capacity) {
+        NewBlock(bytes);
+        offset = 0;
+      }
+      used = offset + bytes;
+      return rlbox::sandbox_reinterpret_cast<T*>(blocks.back() + offset);
+    }
+
+    // Free every block in the sandbox
+    void Release();
+
+    rlbox_sandbox_vips* Sandbox() const { return sandbox; }
+
+   private:
+    void NewBlock(size_t minimum);
+
+    rlbox_sandbox_vips* sandbox;
+    std::vector<tainted_vips<char*>> blocks;
+    size_t used;
+    size_t capacity;
+  };
+
+  /*
+    Copy string to the sandbox of the given arena
   */
-  tainted_vips<const char*> CopyStringToSandbox(rlbox_sandbox_vips* sandbox, const char* str);
+  tainted_vips<const char*> CopyStringToSandbox(SandboxArena &arena, const char* str);
 
   /*
-    Copy vector to the given sandbox
+    Copy vector to the sandbox of the given arena
   */
   template<typename T>
-  tainted_vips<T*> CopyVectorToSandbox(rlbox_sandbox_vips* sandbox, std::vector<T> vec) {
+  tainted_vips<T*> CopyVectorToSandbox(SandboxArena &arena, std::vector<T> vec) {
     size_t size = vec.size();
-    size_t non_zero_size = size == 0? 1 : size;
-    tainted_vips<T*> t_buffer = sandbox->malloc_in_sandbox<T>(non_zero_size);
+    tainted_vips<T*> t_buffer = arena.Alloc<T>(size);
     for(size_t i = 0; i < size; i++) {
       t_buffer[i] = vec[i];
     }
+    profile::CountBytesIn(size * sizeof(T));
     return t_buffer;
   }
 
   /*
-    Call vips_enum_from_nick in the given sandbox
+    Snapshot the nick/value tables of the enums used by options from the given sandbox, once
+  */
+  void InitEnumTables(rlbox_sandbox_vips* sandbox);
+
+  /*
+    Host-side equivalent of vips_enum_from_nick, returns -1 when the nick is unknown
   */
-  tainted_vips<int> SandboxVipsEnumFromNick(rlbox_sandbox_vips* sandbox, const char *domain, GType type, const char *str);
+  int EnumFromNick(GType type, std::string const &nick);
 
   /*
-    call vips_enum_nick in the given sandbox
+    Host-side equivalent of vips_enum_nick, returns an empty string when the value is unknown
   */
-  std::string SandboxVipsEnumNick(rlbox_sandbox_vips* sandbox, GType enm, tainted_vips<int> value);
+  std::string EnumNick(GType type, int value);
 
 
 }
@@ -12,13 +12,19 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
 #include <string>
 #include <string.h>
 #include <vector>
 #include <queue>
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>  // NOLINT(build/c++11)
+#include <unordered_map>
+#include <utility>
 
 #include <vips/vips8>
 
@@ -26,6 +32,26 @@
 
 using vips::VImage;
 
+/*
+  Least recently used embedded profiles that lcms rejected, shared by every request in this sandbox,
+  so each is parsed once rather than once per request.
+*/
+static struct {
+  std::mutex lock;
+  std::list<std::string> entries;
+  std::unordered_map<std::string, std::list<std::string>::iterator> index;
+  size_t max = 64;
+  // Transforms not attempted because the profile was known to be rejected
+  size_t skipped = 0;
+} iccCache;
+
+static void IccCacheTrim() {
+  while (iccCache.entries.size() > iccCache.max) {
+    iccCache.index.erase(iccCache.entries.back());
+    iccCache.entries.pop_back();
+  }
+}
+
 extern "C" {
 
   InputDescriptor* CreateEmptyInputDescriptor() { return new InputDescriptor(); }
@@ -83,6 +109,52 @@ extern "C" {
   void InputDescriptor_SetCreateNoiseMean(InputDescriptor* input, double val) { input->createNoiseMean = val; }
   double InputDescriptor_GetCreateNoiseSigma(InputDescriptor* input) { return input->createNoiseSigma; }
   void InputDescriptor_SetCreateNoiseSigma(InputDescriptor* input, double val) { input->createNoiseSigma = val; }
+
+  size_t GetTrackedMemHighwater() { return vips_tracked_get_mem_highwater(); }
+
+  bool WarmupFormat(const char* suffix) {
+    try {
+      VImage image = VImage::black(8, 8, VImage::option()->set("bands", 3));
+      void *buffer = nullptr;
+      size_t length = 0;
+      image.write_to_buffer(suffix, &buffer, &length);
+      std::unique_ptr<void, void(*)(gpointer)> owned(buffer, g_free);
+      VImage decoded = VImage::new_from_buffer(buffer, length, "");
+      decoded.resize(0.5).avg();
+      return true;
+    } catch (vips::VError const &err) {
+      vips_error_clear();
+      return false;
+    }
+  }
+
+  // The first class reference is kept, so nicks remain valid for the lifetime of the sandbox,
+  // and later lookups peek at it rather than adding another
+  static GEnumClass* EnumClass(GType type) {
+    if (!G_TYPE_IS_ENUM(type)) {
+      return nullptr;
+    }
+    gpointer enumClass = g_type_class_peek(type);
+    if (enumClass == nullptr) {
+      enumClass = g_type_class_ref(type);
+    }
+    return G_ENUM_CLASS(enumClass);
+  }
+  int Enum_GetCount(GType type) {
+    GEnumClass *enumClass = EnumClass(type);
+    return enumClass != nullptr ? static_cast<int>(enumClass->n_values) : 0;
+  }
+  int Enum_GetValue(GType type, int index) { return EnumClass(type)->values[index].value; }
+  const char* Enum_GetNick(GType type, int index) { return EnumClass(type)->values[index].value_nick; }
+
+  void IccCache_SetMax(size_t max) {
+    std::lock_guard<std::mutex> lock(iccCache.lock);
+    iccCache.max = max;
+    IccCacheTrim();
+  }
+  size_t IccCache_GetMax() { std::lock_guard<std::mutex> lock(iccCache.lock); return iccCache.max; }
+  size_t IccCache_GetSize() { std::lock_guard<std::mutex> lock(iccCache.lock); return iccCache.entries.size(); }
+  size_t IccCache_GetSkipped() { std::lock_guard<std::mutex> lock(iccCache.lock); return iccCache.skipped; }
 }
 
 namespace sharp {
@@ -198,37 +270,65 @@ namespace sharp {
   };
 
   /*
-    Determine image format of a buffer.
+    Map the name of the loader found by sniffing to an image format.
   */
-  ImageType DetermineImageType(void *buffer, size_t const length) {
-    ImageType imageType = ImageType::UNKNOWN;
-    char const *load = vips_foreign_find_load_buffer(buffer, length);
+  static ImageType LoaderImageType(char const *load) {
     if (load != nullptr) {
       auto it = loaderToType.find(load);
       if (it != loaderToType.end()) {
-        imageType = it->second;
+        return it->second;
       }
     }
-    return imageType;
+    return ImageType::UNKNOWN;
+  }
+
+  /*
+    Determine image format of a buffer.
+  */
+  ImageType DetermineImageType(void *buffer, size_t const length) {
+    return LoaderImageType(vips_foreign_find_load_buffer(buffer, length));
   }
 
   /*
     Determine image format, reads the first few bytes of the file
   */
   ImageType DetermineImageType(char const *file) {
-    ImageType imageType = ImageType::UNKNOWN;
     char const *load = vips_foreign_find_load(file);
-    if (load != nullptr) {
-      auto it = loaderToType.find(load);
-      if (it != loaderToType.end()) {
-        imageType = it->second;
-      }
+    if (load == nullptr && EndsWith(vips::VError().what(), " does not exist\n")) {
+      return ImageType::MISSING;
+    }
+    return LoaderImageType(load);
+  }
+
+  /*
+    Call the given loader by name on the buffer or file of the descriptor. The loader found
+    while sniffing is called directly, as new_from_file and new_from_buffer would sniff again.
+  */
+  static VImage LoadWith(char const *load, InputDescriptor *descriptor, vips::VOption *option) {
+    VImage image;
+    char const *operation = vips_nickname_find(g_type_from_name(load));
+    if (descriptor->isBuffer) {
+      VipsBlob *blob = vips_blob_new(nullptr, descriptor->buffer, descriptor->bufferLength);
+      option->set("buffer", blob);
+      vips_area_unref(VIPS_AREA(blob));
+      VImage::call(operation, option->set("out", &image));
     } else {
-      if (EndsWith(vips::VError().what(), " does not exist\n")) {
-        imageType = ImageType::MISSING;
+      // As new_from_file, any "[options]" suffix of the filename is passed to the loader
+      char *filename = vips_filename_get_filename(descriptor->file.data());
+      char *optionString = vips_filename_get_options(descriptor->file.data());
+      try {
+        VImage::call_option_string(operation, optionString, option
+          ->set("filename", filename)
+          ->set("out", &image));
+      } catch (...) {
+        g_free(filename);
+        g_free(optionString);
+        throw;
       }
+      g_free(filename);
+      g_free(optionString);
     }
-    return imageType;
+    return image;
   }
 
   /*
@@ -266,8 +366,9 @@ namespace sharp {
         }
         imageType = ImageType::RAW;
       } else {
-        // Compressed data
-        imageType = DetermineImageType(descriptor->buffer, descriptor->bufferLength);
+        // Compressed data, sniffed once to find its loader
+        char const *load = vips_foreign_find_load_buffer(descriptor->buffer, descriptor->bufferLength);
+        imageType = LoaderImageType(load);
         if (imageType != ImageType::UNKNOWN) {
           try {
             vips::VOption *option = VImage::option()
@@ -292,7 +393,7 @@ namespace sharp {
             if (imageType == ImageType::TIFF) {
               option->set("subifd", descriptor->subifd);
             }
-            image = VImage::new_from_buffer(descriptor->buffer, descriptor->bufferLength, nullptr, option);
+            image = LoadWith(load, descriptor, option);
             if (imageType == ImageType::SVG || imageType == ImageType::PDF || imageType == ImageType::MAGICK) {
               image = SetDensity(image, descriptor->density);
             }
@@ -338,8 +439,11 @@ namespace sharp {
         image.get_image()->Type = VIPS_INTERPRETATION_sRGB;
         imageType = ImageType::RAW;
       } else {
-        // From filesystem
-        imageType = DetermineImageType(descriptor->file.data());
+        // From filesystem, sniffed once to find its loader
+        char const *load = vips_foreign_find_load(descriptor->file.data());
+        imageType = load == nullptr && EndsWith(vips::VError().what(), " does not exist\n")
+          ? ImageType::MISSING
+          : LoaderImageType(load);
         if (imageType == ImageType::MISSING) {
           if (descriptor->file.find("<svg") != std::string::npos) {
             throw vips::VError("Input file is missing, did you mean "
@@ -371,7 +475,7 @@ namespace sharp {
             if (imageType == ImageType::TIFF) {
               option->set("subifd", descriptor->subifd);
             }
-            image = VImage::new_from_file(descriptor->file.data(), option);
+            image = LoadWith(load, descriptor, option);
             if (imageType == ImageType::SVG || imageType == ImageType::PDF || imageType == ImageType::MAGICK) {
               image = SetDensity(image, descriptor->density);
             }
@@ -391,6 +495,202 @@ namespace sharp {
     return std::make_tuple(image, imageType);
   }
 
+  /*
+    Does the loader for this image type decode pixels while reading the header?
+  */
+  static bool ImageTypeHeaderNeedsPixels(ImageType imageType) {
+    return imageType == ImageType::MAGICK;
+  }
+
+  /*
+    Did a loader fail because the buffer ends too soon, rather than because the header is invalid?
+    Buffers shorter than the fixed part of the header always are, otherwise the loader must report
+    running out of data.
+  */
+  static bool IsShortRead(ImageType imageType, size_t const length, std::string const &message) {
+    size_t const minimum =
+      imageType == ImageType::PNG ? 33 :  // Signature and IHDR chunk
+      imageType == ImageType::WEBP ? 30 :  // RIFF header and first chunk header with dimensions
+      imageType == ImageType::GIF ? 13 :  // Header and logical screen descriptor
+      0;
+    if (length < minimum) {
+      return true;
+    }
+    std::string lower(message);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    for (char const *phrase : {
+      "premature end", "unexpected end", "end of file", "end of data", "end of input", "end of stream",
+      "truncated", "not enough data", "short read", "out of data"
+    }) {
+      if (lower.find(phrase) != std::string::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /*
+    Parse only the header of an encoded image, accepting a truncated buffer
+  */
+  std::tuple<VImage, ImageType, bool> OpenInputHeader(InputDescriptor *descriptor) {
+    if (descriptor->rawChannels > 0 || descriptor->createChannels > 0) {
+      throw vips::VError("Header-only metadata requires encoded input");
+    }
+    // Sniff once and call the loader that matched directly, rather than have libvips sniff again
+    char const *load = descriptor->isBuffer
+      ? vips_foreign_find_load_buffer(descriptor->buffer, descriptor->bufferLength)
+      : vips_foreign_find_load(descriptor->file.data());
+    if (load == nullptr && !descriptor->isBuffer && EndsWith(vips::VError().what(), " does not exist\n")) {
+      throw vips::VError("Input file is missing");
+    }
+    ImageType imageType = LoaderImageType(load);
+    if (imageType == ImageType::UNKNOWN) {
+      throw vips::VError(descriptor->isBuffer
+        ? "Input buffer contains unsupported image format"
+        : "Input file contains unsupported image format");
+    }
+    if (ImageTypeHeaderNeedsPixels(imageType)) {
+      throw vips::VError("Input " + ImageTypeId(imageType) + " image requires a pixel read to parse its header");
+    }
+    VImage image;
+    try {
+      // Leave page, level and subifd selection alone: the first image is all the header describes,
+      // and failOnError only applies to pixel data
+      vips::VOption *option = VImage::option()
+        ->set("access", VIPS_ACCESS_SEQUENTIAL)
+        ->set("fail", FALSE);
+      if (descriptor->unlimited && (imageType == ImageType::SVG || imageType == ImageType::PNG)) {
+        option->set("unlimited", TRUE);
+      }
+      if (imageType == ImageType::SVG || imageType == ImageType::PDF) {
+        option->set("dpi", descriptor->density);
+      }
+      image = LoadWith(load, descriptor, option);
+      if (imageType == ImageType::SVG || imageType == ImageType::PDF) {
+        image = SetDensity(image, descriptor->density);
+      }
+    } catch (vips::VError const &err) {
+      if (descriptor->isBuffer) {
+        if (IsShortRead(imageType, descriptor->bufferLength, err.what())) {
+          // The signature matched and the loader ran out of data, so the prefix ends before the header does
+          vips_error_clear();
+          return std::make_tuple(VImage(), imageType, false);
+        }
+        throw vips::VError(std::string("Input buffer has corrupt header: ") + err.what());
+      }
+      throw vips::VError(std::string("Input file has corrupt header: ") + err.what());
+    }
+    if (descriptor->limitInputPixels > 0 &&
+      static_cast<uint64_t>(image.width()) * static_cast<uint64_t>(image.height()) >
+        static_cast<uint64_t>(descriptor->limitInputPixels)) {
+      throw vips::VError("Input image exceeds pixel limit");
+    }
+    return std::make_tuple(image, imageType, true);
+  }
+
+  /*
+    Calculate the shrink-on-load to apply for the given overall shrink: an integer
+    factor for jpegload*, a double scale factor for webpload*, pdfload* and svgload*.
+  */
+  std::pair<int, double> ShrinkOnLoadFactors(ImageType const inputImageType, double const shrink, bool const fastShrinkOnLoad) {
+    int jpegShrinkOnLoad = 1;
+    double scale = 1.0;
+    if (inputImageType == ImageType::JPEG) {
+      // Leave at least a factor of two for the final resize step, when fastShrinkOnLoad: false
+      // for more consistent results and to avoid extra sharpness to the image
+      int factor = fastShrinkOnLoad ? 1 : 2;
+      if (shrink >= 8 * factor) {
+        jpegShrinkOnLoad = 8;
+      } else if (shrink >= 4 * factor) {
+        jpegShrinkOnLoad = 4;
+      } else if (shrink >= 2 * factor) {
+        jpegShrinkOnLoad = 2;
+      }
+      // Lower shrink-on-load for known libjpeg rounding errors
+      if (jpegShrinkOnLoad > 1 && static_cast<int>(shrink) == jpegShrinkOnLoad) {
+        jpegShrinkOnLoad /= 2;
+      }
+    } else if (inputImageType == ImageType::WEBP ||
+               inputImageType == ImageType::SVG ||
+               inputImageType == ImageType::PDF) {
+      scale = 1.0 / shrink;
+    }
+    return std::make_pair(jpegShrinkOnLoad, scale);
+  }
+
+  /*
+    Reload input using shrink-on-load, returns the given image when there is nothing to do.
+  */
+  VImage ShrinkOnLoad(VImage image, InputDescriptor *input, ImageType const inputImageType,
+    int const jpegShrinkOnLoad, double const scale) {
+    if (jpegShrinkOnLoad > 1) {
+      vips::VOption *option = VImage::option()
+        ->set("access", input->access)
+        ->set("shrink", jpegShrinkOnLoad)
+        ->set("fail", input->failOnError);
+      if (input->buffer != nullptr) {
+        // Reload JPEG buffer
+        VipsBlob *blob = vips_blob_new(nullptr, input->buffer, input->bufferLength);
+        image = VImage::jpegload_buffer(blob, option);
+        vips_area_unref(reinterpret_cast<VipsArea*>(blob));
+      } else {
+        // Reload JPEG file
+        image = VImage::jpegload(const_cast<char*>(input->file.data()), option);
+      }
+    } else if (scale != 1.0) {
+      vips::VOption *option = VImage::option()
+        ->set("access", input->access)
+        ->set("scale", scale)
+        ->set("fail", input->failOnError);
+      if (inputImageType == ImageType::WEBP) {
+        option->set("n", input->pages);
+        option->set("page", input->page);
+
+        if (input->buffer != nullptr) {
+          // Reload WebP buffer
+          VipsBlob *blob = vips_blob_new(nullptr, input->buffer, input->bufferLength);
+          image = VImage::webpload_buffer(blob, option);
+          vips_area_unref(reinterpret_cast<VipsArea*>(blob));
+        } else {
+          // Reload WebP file
+          image = VImage::webpload(const_cast<char*>(input->file.data()), option);
+        }
+      } else if (inputImageType == ImageType::SVG) {
+        option->set("unlimited", input->unlimited);
+        option->set("dpi", input->density);
+
+        if (input->buffer != nullptr) {
+          // Reload SVG buffer
+          VipsBlob *blob = vips_blob_new(nullptr, input->buffer, input->bufferLength);
+          image = VImage::svgload_buffer(blob, option);
+          vips_area_unref(reinterpret_cast<VipsArea*>(blob));
+        } else {
+          // Reload SVG file
+          image = VImage::svgload(const_cast<char*>(input->file.data()), option);
+        }
+
+        SetDensity(image, input->density);
+      } else if (inputImageType == ImageType::PDF) {
+        option->set("n", input->pages);
+        option->set("page", input->page);
+        option->set("dpi", input->density);
+
+        if (input->buffer != nullptr) {
+          // Reload PDF buffer
+          VipsBlob *blob = vips_blob_new(nullptr, input->buffer, input->bufferLength);
+          image = VImage::pdfload_buffer(blob, option);
+          vips_area_unref(reinterpret_cast<VipsArea*>(blob));
+        } else {
+          // Reload PDF file
+          image = VImage::pdfload(const_cast<char*>(input->file.data()), option);
+        }
+
+        SetDensity(image, input->density);
+      }
+    }
+    return image;
+  }
+
   /*
     Does this image have an embedded profile?
   */
@@ -398,6 +698,60 @@ namespace sharp {
     return (image.get_typeof(VIPS_META_ICC_NAME) != 0) ? TRUE : FALSE;
   }
 
+  /*
+    Is this profile key known to be rejected by lcms? Marks it most recently used.
+  */
+  static bool IccCacheIsRejected(std::string const &key) {
+    std::lock_guard<std::mutex> lock(iccCache.lock);
+    auto const found = iccCache.index.find(key);
+    if (found == iccCache.index.end()) {
+      return false;
+    }
+    iccCache.skipped++;
+    iccCache.entries.splice(iccCache.entries.begin(), iccCache.entries, found->second);
+    return true;
+  }
+
+  static void IccCacheReject(std::string const &key) {
+    std::lock_guard<std::mutex> lock(iccCache.lock);
+    if (iccCache.max == 0 || iccCache.index.count(key) != 0) {
+      return;
+    }
+    iccCache.entries.emplace_front(key);
+    iccCache.index[key] = iccCache.entries.begin();
+    IccCacheTrim();
+  }
+
+  /*
+    Transform from the embedded profile to the given profile.
+    A profile that lcms rejects is remembered by digest, target and image type, so it is not parsed again.
+  */
+  VImage EmbeddedProfileTransform(VImage image, char const *profile, int const depth, VipsIntent const intent) {
+    size_t length;
+    uint8_t const *blob = static_cast<uint8_t const *>(image.get_blob(VIPS_META_ICC_NAME, &length));
+    // 64-bit FNV-1a
+    uint64_t digest = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+      digest = (digest ^ blob[i]) * 0x100000001b3ULL;
+    }
+    std::string const key = std::to_string(digest) + ":" + std::to_string(length) + ":" + profile + ":" +
+      std::to_string(depth) + ":" + std::to_string(static_cast<int>(intent)) + ":" +
+      std::to_string(static_cast<int>(image.interpretation())) + ":" + (image.has_alpha() ? "alpha" : "opaque");
+
+    if (IccCacheIsRejected(key)) {
+      throw vips::VError("Embedded profile cannot be transformed");
+    }
+    try {
+      return image.icc_transform(profile, VImage::option()
+        ->set("embedded", TRUE)
+        ->set("depth", depth)
+        ->set("intent", intent));
+    } catch (vips::VError const &) {
+      IccCacheReject(key);
+      throw;
+    }
+  }
+
   /*
     Does this image have an alpha channel?
     Uses colour space interpretation with number of channels to guess this.
@@ -430,6 +784,9 @@ namespace sharp {
     Remove EXIF Orientation from image.
   */
   VImage RemoveExifOrientation(VImage image) {
+    if (image.get_typeof(VIPS_META_ORIENTATION) == 0) {
+      return image;
+    }
     VImage copy = image.copy();
     copy.remove(VIPS_META_ORIENTATION);
     return copy;
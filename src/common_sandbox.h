@@ -155,6 +155,23 @@ extern "C" {
   void InputDescriptor_SetCreateNoiseMean(InputDescriptor* input, double val);
   double InputDescriptor_GetCreateNoiseSigma(InputDescriptor* input);
   void InputDescriptor_SetCreateNoiseSigma(InputDescriptor* input, double val);
+
+  // Memory high-water mark of libvips in this sandbox
+  size_t GetTrackedMemHighwater();
+
+  // Encode and decode a tiny image with the given filename suffix, loading its saver/loader and priming the cache
+  bool WarmupFormat(const char* suffix);
+
+  // Enumerate the values of an enum type, so the host can snapshot its nick/value table
+  int Enum_GetCount(GType type);
+  int Enum_GetValue(GType type, int index);
+  const char* Enum_GetNick(GType type, int index);
+
+  // Cache of the embedded profiles that lcms rejected
+  void IccCache_SetMax(size_t max);
+  size_t IccCache_GetMax();
+  size_t IccCache_GetSize();
+  size_t IccCache_GetSkipped();
 }
 
 namespace sharp {
@@ -218,11 +235,36 @@ namespace sharp {
   */
   std::tuple<VImage, ImageType> OpenInput(InputDescriptor *descriptor);
 
+  /*
+    Parse only the header of an encoded image from the given InputDescriptor, never reading pixel data.
+    A buffer may be a truncated prefix, in which case the returned flag is false when the header did not fit.
+  */
+  std::tuple<VImage, ImageType, bool> OpenInputHeader(InputDescriptor *descriptor);
+
+  /*
+    Calculate the shrink-on-load to apply for the given overall shrink: an integer
+    factor for jpegload*, a double scale factor for webpload*, pdfload* and svgload*.
+  */
+  std::pair<int, double> ShrinkOnLoadFactors(ImageType const inputImageType, double const shrink,
+    bool const fastShrinkOnLoad);
+
+  /*
+    Reload input using shrink-on-load, returns the given image when there is nothing to do.
+  */
+  VImage ShrinkOnLoad(VImage image, InputDescriptor *input, ImageType const inputImageType,
+    int const jpegShrinkOnLoad, double const scale);
+
   /*
     Does this image have an embedded profile?
   */
   bool HasProfile(VImage image);
 
+  /*
+    Transform from the embedded profile to the given profile, failing straight away
+    when a previous request found lcms rejects this profile.
+  */
+  VImage EmbeddedProfileTransform(VImage image, char const *profile, int const depth, VipsIntent const intent);
+
   /*
     Does this image have an alpha channel?
     Uses colour space interpretation with number of channels to guess this.
@@ -12,7 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
 #include <numeric>
+#include <thread>
 #include <vector>
 
 #include <napi.h>
@@ -28,9 +33,13 @@ rlbox_load_structs_from_library(vips);
 
 class MetadataWorker : public Napi::AsyncWorker {
  public:
-  MetadataWorker(Napi::Function callback, tainted_vips<MetadataBaton*> t_baton, Napi::Function debuglog, rlbox_sandbox_vips* sandbox) :
-    Napi::AsyncWorker(callback), t_baton(t_baton), debuglog(Napi::Persistent(debuglog)), sandbox(sandbox) {}
-  ~MetadataWorker() {}
+  MetadataWorker(Napi::Function callback, tainted_vips<MetadataBaton*> t_baton, Napi::Function debuglog, rlbox_sandbox_vips* sandbox,
+    bool headerOnly) :
+    Napi::AsyncWorker(callback), t_baton(t_baton), debuglog(Napi::Persistent(debuglog)), sandbox(sandbox),
+    headerOnly(headerOnly) {}
+  ~MetadataWorker() {
+    ReleaseVipsSandbox(sandbox);
+  }
 
   void Execute() {
     // Decrement queued task counter
@@ -50,224 +59,176 @@ class MetadataWorker : public Napi::AsyncWorker {
       warning = sharp::VipsWarningPop();
     }
 
-    std::string errString = sandbox->invoke_sandbox_function(MetadataBaton_GetErr, t_baton).copy_and_verify_string([](std::string val) {
-      // Worst case, the library says there is an error when there isn't
-      return val;
-    });
+    // Attributes are read through a single result struct, everything of variable length
+    // from the blob region it references, which is copied out of the sandbox in one go
+    tainted_vips<MetadataResult*> t_result = sandbox->invoke_sandbox_function(MetadataBaton_GetResult, t_baton);
 
     const char image_attrib_reason[] = "Reading attributes of the image for the first and only time.";
 
-    if (errString == std::string("")) {
-      Napi::Object info = Napi::Object::New(env);
-      auto formatString = sandbox->invoke_sandbox_function(MetadataBaton_GetFormat, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-      info.Set("format", formatString.c_str());
-      tainted_vips<InputDescriptor*> input = sandbox->invoke_sandbox_function(MetadataBaton_GetInput, t_baton);
-      size_t bufferLength = sandbox->invoke_sandbox_function(InputDescriptor_GetBufferLength, input).unverified_safe_because(image_attrib_reason);
+    size_t const blobLength = t_result->blobLength.unverified_safe_because("Bounds of the copy below");
+    std::shared_ptr<char> blob(rlbox::sandbox_static_cast<char*>(t_result->blob).copy_and_verify_range(
+      [](std::unique_ptr<char[]> val) {
+      return val.release();
+    }, blobLength == 0 ? 1 : blobLength), std::default_delete<char[]>());
+    sharp::profile::CountBytesOut(blobLength);
+
+    // Offsets are verified against the host copy, so a bad one yields an empty value
+    auto inBlob = [blobLength](unsigned int offset, size_t length) {
+      return offset <= blobLength && length <= blobLength - offset;
+    };
+    auto stringAt = [&blob, blobLength](unsigned int offset) {
+      if (offset >= blobLength) {
+        return std::string();
+      }
+      char const *start = blob.get() + offset;
+      char const *end = static_cast<char const*>(memchr(start, '\0', blobLength - offset));
+      return end != nullptr ? std::string(start, end) : std::string();
+    };
+    // Metadata blobs are views into the host copy, which lives as long as any of them
+    auto bufferAt = [&env, &blob, &inBlob](unsigned int offset, unsigned int length) {
+      if (!inBlob(offset, length)) {
+        return Napi::Buffer<char>::New(env, 0);
+      }
+      return Napi::Buffer<char>::New(env, blob.get() + offset, length,
+        [](Napi::Env, char*, std::shared_ptr<char>* hint) {
+        delete hint;
+      }, new std::shared_ptr<char>(blob));
+    };
 
-      if (bufferLength > 0) {
-        info.Set("size", bufferLength);
+    std::string errString = stringAt(t_result->err.unverified_safe_because(image_attrib_reason));
+    bool const headerComplete = t_result->headerComplete.unverified_safe_because(image_attrib_reason);
+
+    if (errString.empty() && !headerComplete) {
+      // Header-only parse of a prefix that ended too soon, all that is known is the format
+      Napi::Object info = Napi::Object::New(env);
+      info.Set("format", stringAt(t_result->format.unverified_safe_because(image_attrib_reason)));
+      info.Set("headerComplete", false);
+      Callback().MakeCallback(Receiver().Value(), { env.Null(), info });
+    } else if (errString.empty()) {
+      Napi::Object info = Napi::Object::New(env);
+      info.Set("format", stringAt(t_result->format.unverified_safe_because(image_attrib_reason)));
+      size_t const size = t_result->size.unverified_safe_because(image_attrib_reason);
+      if (size > 0) {
+        info.Set("size", size);
       }
-      info.Set("width", sandbox->invoke_sandbox_function(MetadataBaton_GetWidth, t_baton).unverified_safe_because(image_attrib_reason));
-      info.Set("height", sandbox->invoke_sandbox_function(MetadataBaton_GetHeight, t_baton).unverified_safe_because(image_attrib_reason));
-      auto spaceString = sandbox->invoke_sandbox_function(MetadataBaton_GetSpace, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-      info.Set("space", spaceString.c_str());
-      info.Set("channels", sandbox->invoke_sandbox_function(MetadataBaton_GetChannels, t_baton).unverified_safe_because(image_attrib_reason));
-      auto depthString = sandbox->invoke_sandbox_function(MetadataBaton_GetDepth, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-      info.Set("depth", depthString.c_str());
-      int density = sandbox->invoke_sandbox_function(MetadataBaton_GetDensity, t_baton).unverified_safe_because(image_attrib_reason);
+      info.Set("width", t_result->width.unverified_safe_because(image_attrib_reason));
+      info.Set("height", t_result->height.unverified_safe_because(image_attrib_reason));
+      info.Set("space", stringAt(t_result->space.unverified_safe_because(image_attrib_reason)));
+      info.Set("channels", t_result->channels.unverified_safe_because(image_attrib_reason));
+      info.Set("depth", stringAt(t_result->depth.unverified_safe_because(image_attrib_reason)));
+      int density = t_result->density.unverified_safe_because(image_attrib_reason);
       if (density > 0) {
         info.Set("density", density);
       }
-      auto chromaString = sandbox->invoke_sandbox_function(MetadataBaton_GetChromaSubsampling, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-      if (chromaString != std::string("")) {
+      std::string chromaString = stringAt(t_result->chromaSubsampling.unverified_safe_because(image_attrib_reason));
+      if (!chromaString.empty()) {
         info.Set("chromaSubsampling", chromaString);
       }
-      info.Set("isProgressive", sandbox->invoke_sandbox_function(MetadataBaton_GetIsProgressive, t_baton).unverified_safe_because(image_attrib_reason));
-      int paletteBitDepth = sandbox->invoke_sandbox_function(MetadataBaton_GetPaletteBitDepth, t_baton).unverified_safe_because(image_attrib_reason);
+      info.Set("isProgressive", t_result->isProgressive.unverified_safe_because(image_attrib_reason));
+      int paletteBitDepth = t_result->paletteBitDepth.unverified_safe_because(image_attrib_reason);
       if (paletteBitDepth > 0) {
         info.Set("paletteBitDepth", paletteBitDepth);
       }
-      int pages = sandbox->invoke_sandbox_function(MetadataBaton_GetPages, t_baton).unverified_safe_because(image_attrib_reason);
+      int pages = t_result->pages.unverified_safe_because(image_attrib_reason);
       if (pages > 0) {
         info.Set("pages", pages);
       }
-      int pageHeight = sandbox->invoke_sandbox_function(MetadataBaton_GetPageHeight, t_baton).unverified_safe_because(image_attrib_reason);
+      int pageHeight = t_result->pageHeight.unverified_safe_because(image_attrib_reason);
       if (pageHeight > 0) {
         info.Set("pageHeight", pageHeight);
       }
-      int loop = sandbox->invoke_sandbox_function(MetadataBaton_GetLoop, t_baton).unverified_safe_because(image_attrib_reason);
+      int loop = t_result->loop.unverified_safe_because(image_attrib_reason);
       if (loop >= 0) {
         info.Set("loop", loop);
       }
-      size_t baton_delay_size = sandbox->invoke_sandbox_function(MetadataBaton_GetDelay_Size, t_baton).unverified_safe_because(image_attrib_reason);
-      if (baton_delay_size != 0) {
-        tainted_vips<int*> baton_delay = sandbox->invoke_sandbox_function(MetadataBaton_GetDelay, t_baton);
-        Napi::Array delay = Napi::Array::New(env, static_cast<size_t>(baton_delay_size));
-        for (size_t i = 0; i < baton_delay_size; i++) {
-          int const d = baton_delay[i].unverified_safe_because(image_attrib_reason);
+      unsigned int const delayOffset = t_result->delay.unverified_safe_because(image_attrib_reason);
+      size_t const delayCount = t_result->delayCount.unverified_safe_because(image_attrib_reason);
+      if (delayCount != 0 && inBlob(delayOffset, delayCount * sizeof(int))) {
+        Napi::Array delay = Napi::Array::New(env, delayCount);
+        for (size_t i = 0; i < delayCount; i++) {
+          int d;
+          memcpy(&d, blob.get() + delayOffset + i * sizeof(int), sizeof(int));
           delay.Set(i, d);
         }
         info.Set("delay", delay);
       }
-      int pagePrimary = sandbox->invoke_sandbox_function(MetadataBaton_GetPagePrimary, t_baton).unverified_safe_because(image_attrib_reason);
+      int pagePrimary = t_result->pagePrimary.unverified_safe_because(image_attrib_reason);
       if (pagePrimary > -1) {
         info.Set("pagePrimary", pagePrimary);
       }
-      auto compressionString = sandbox->invoke_sandbox_function(MetadataBaton_GetCompression, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-      if (compressionString != std::string("")) {
+      std::string compressionString = stringAt(t_result->compression.unverified_safe_because(image_attrib_reason));
+      if (!compressionString.empty()) {
         info.Set("compression", compressionString);
       }
-      auto resolutionUnitString = sandbox->invoke_sandbox_function(MetadataBaton_GetResolutionUnit, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-      if (resolutionUnitString != std::string("")) {
+      std::string resolutionUnitString = stringAt(t_result->resolutionUnit.unverified_safe_because(image_attrib_reason));
+      if (!resolutionUnitString.empty()) {
         info.Set("resolutionUnit", resolutionUnitString == std::string("in") ? std::string("inch") : resolutionUnitString);
       }
-      size_t baton_levels_size = sandbox->invoke_sandbox_function(MetadataBaton_GetLevels_Size, t_baton).unverified_safe_because(image_attrib_reason);
-      if (baton_levels_size != 0) {
-        tainted_vips<MetadataDimension*> baton_levels = sandbox->invoke_sandbox_function(MetadataBaton_GetLevels, t_baton);
-        Napi::Array levels = Napi::Array::New(env, static_cast<size_t>(baton_levels_size));
-        for (size_t i = 0; i < baton_levels_size; i++) {
+      unsigned int const levelsOffset = t_result->levels.unverified_safe_because(image_attrib_reason);
+      size_t const levelsCount = t_result->levelsCount.unverified_safe_because(image_attrib_reason);
+      if (levelsCount != 0 && inBlob(levelsOffset, levelsCount * sizeof(MetadataDimension))) {
+        Napi::Array levels = Napi::Array::New(env, levelsCount);
+        for (size_t i = 0; i < levelsCount; i++) {
+          MetadataDimension dimension;
+          memcpy(&dimension, blob.get() + levelsOffset + i * sizeof(MetadataDimension), sizeof(MetadataDimension));
           Napi::Object level = Napi::Object::New(env);
-          level.Set("width", baton_levels[i].width.unverified_safe_because(image_attrib_reason));
-          level.Set("height", baton_levels[i].height.unverified_safe_because(image_attrib_reason));
+          level.Set("width", dimension.width);
+          level.Set("height", dimension.height);
           levels.Set(i, level);
         }
         info.Set("levels", levels);
       }
-      int subifds = sandbox->invoke_sandbox_function(MetadataBaton_GetSubifds, t_baton).unverified_safe_because(image_attrib_reason);
+      int subifds = t_result->subifds.unverified_safe_because(image_attrib_reason);
       if (subifds > 0) {
         info.Set("subifds", subifds);
       }
-      size_t backgroundSize = sandbox->invoke_sandbox_function(MetadataBaton_GetBackground_Size, t_baton).unverified_safe_because(image_attrib_reason);
-      if (backgroundSize != 0) {
-        tainted_vips<double*> baton_background = sandbox->invoke_sandbox_function(MetadataBaton_GetBackground, t_baton);
-        if (backgroundSize == 3) {
+      unsigned int const backgroundOffset = t_result->background.unverified_safe_because(image_attrib_reason);
+      size_t const backgroundCount = t_result->backgroundCount.unverified_safe_because(image_attrib_reason);
+      if (backgroundCount != 0 && inBlob(backgroundOffset, backgroundCount * sizeof(double))) {
+        double values[3] = { 0.0, 0.0, 0.0 };
+        memcpy(values, blob.get() + backgroundOffset, std::min(backgroundCount, size_t(3)) * sizeof(double));
+        if (backgroundCount == 3) {
           Napi::Object background = Napi::Object::New(env);
-          background.Set("r", baton_background[0].unverified_safe_because(image_attrib_reason));
-          background.Set("g", baton_background[1].unverified_safe_because(image_attrib_reason));
-          background.Set("b", baton_background[2].unverified_safe_because(image_attrib_reason));
+          background.Set("r", values[0]);
+          background.Set("g", values[1]);
+          background.Set("b", values[2]);
           info.Set("background", background);
         } else {
-          info.Set("background", baton_background[0].unverified_safe_because(image_attrib_reason));
+          info.Set("background", values[0]);
         }
       }
-      info.Set("hasProfile", sandbox->invoke_sandbox_function(MetadataBaton_GetHasProfile, t_baton).unverified_safe_because(image_attrib_reason));
-      info.Set("hasAlpha", sandbox->invoke_sandbox_function(MetadataBaton_GetHasAlpha, t_baton).unverified_safe_because(image_attrib_reason));
-      int orientation = sandbox->invoke_sandbox_function(MetadataBaton_GetOrientation, t_baton).unverified_safe_because(image_attrib_reason);
+      info.Set("hasProfile", t_result->hasProfile.unverified_safe_because(image_attrib_reason));
+      info.Set("hasAlpha", t_result->hasAlpha.unverified_safe_because(image_attrib_reason));
+      int orientation = t_result->orientation.unverified_safe_because(image_attrib_reason);
       if (orientation > 0) {
         info.Set("orientation", orientation);
       }
-
-      {
-        uint32_t exifLength = static_cast<uint32_t>(sandbox->invoke_sandbox_function(MetadataBaton_GetExifLength, t_baton).unverified_safe_because(image_attrib_reason));
-        if (exifLength > 0) {
-          tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(sandbox->invoke_sandbox_function(MetadataBaton_GetExif, t_baton));
-          char* buffer_ref = t_buffer_ref.copy_and_verify_range(
-            [](std::unique_ptr<char[]> val) {
-            return val.release();
-          }, exifLength);
-          sandbox->free_in_sandbox(t_buffer_ref);
-
-          Napi::Buffer<char> data = Napi::Buffer<char>::New(env, buffer_ref,
-            exifLength, sharp::DeleteCallback);
-
-          info.Set("exif", data);
-        }
+      unsigned int const exifLength = t_result->exifLength.unverified_safe_because(image_attrib_reason);
+      if (exifLength > 0) {
+        info.Set("exif", bufferAt(t_result->exif.unverified_safe_because(image_attrib_reason), exifLength));
       }
-      {
-        uint32_t iccLength = static_cast<uint32_t>(sandbox->invoke_sandbox_function(MetadataBaton_GetIccLength, t_baton).unverified_safe_because(image_attrib_reason));
-        if (iccLength > 0) {
-          tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(sandbox->invoke_sandbox_function(MetadataBaton_GetIcc, t_baton));
-          char* buffer_ref = t_buffer_ref.copy_and_verify_range(
-            [](std::unique_ptr<char[]> val) {
-            return val.release();
-          }, iccLength);
-          sandbox->free_in_sandbox(t_buffer_ref);
-
-          Napi::Buffer<char> data = Napi::Buffer<char>::New(env, buffer_ref,
-            iccLength, sharp::DeleteCallback);
-
-          info.Set("icc", data);
-        }
+      unsigned int const iccLength = t_result->iccLength.unverified_safe_because(image_attrib_reason);
+      if (iccLength > 0) {
+        info.Set("icc", bufferAt(t_result->icc.unverified_safe_because(image_attrib_reason), iccLength));
       }
-      {
-        uint32_t iptcLength = static_cast<uint32_t>(sandbox->invoke_sandbox_function(MetadataBaton_GetIptcLength, t_baton).unverified_safe_because(image_attrib_reason));
-        if (iptcLength > 0) {
-          tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(sandbox->invoke_sandbox_function(MetadataBaton_GetIptc, t_baton));
-          char* buffer_ref = t_buffer_ref.copy_and_verify_range(
-            [](std::unique_ptr<char[]> val) {
-            return val.release();
-          }, iptcLength);
-          sandbox->free_in_sandbox(t_buffer_ref);
-
-          Napi::Buffer<char> data = Napi::Buffer<char>::New(env, buffer_ref,
-            iptcLength, sharp::DeleteCallback);
-
-          info.Set("iptc", data);
-        }
+      unsigned int const iptcLength = t_result->iptcLength.unverified_safe_because(image_attrib_reason);
+      if (iptcLength > 0) {
+        info.Set("iptc", bufferAt(t_result->iptc.unverified_safe_because(image_attrib_reason), iptcLength));
       }
-      {
-        uint32_t xmpLength = static_cast<uint32_t>(sandbox->invoke_sandbox_function(MetadataBaton_GetXmpLength, t_baton).unverified_safe_because(image_attrib_reason));
-        if (xmpLength > 0) {
-          tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(sandbox->invoke_sandbox_function(MetadataBaton_GetXmp, t_baton));
-          char* buffer_ref = t_buffer_ref.copy_and_verify_range(
-            [](std::unique_ptr<char[]> val) {
-            return val.release();
-          }, xmpLength);
-          sandbox->free_in_sandbox(t_buffer_ref);
-
-          Napi::Buffer<char> data = Napi::Buffer<char>::New(env, buffer_ref,
-            xmpLength, sharp::DeleteCallback);
-
-          info.Set("xmp", data);
-        }
+      unsigned int const xmpLength = t_result->xmpLength.unverified_safe_because(image_attrib_reason);
+      if (xmpLength > 0) {
+        info.Set("xmp", bufferAt(t_result->xmp.unverified_safe_because(image_attrib_reason), xmpLength));
       }
-      {
-        uint32_t tifftagPhotoshopLength = static_cast<uint32_t>(sandbox->invoke_sandbox_function(MetadataBaton_GetTifftagPhotoshopLength, t_baton).unverified_safe_because(image_attrib_reason));
-        if (tifftagPhotoshopLength > 0) {
-          tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(sandbox->invoke_sandbox_function(MetadataBaton_GetTifftagPhotoshop, t_baton));
-          char* buffer_ref = t_buffer_ref.copy_and_verify_range(
-            [](std::unique_ptr<char[]> val) {
-            return val.release();
-          }, tifftagPhotoshopLength);
-          sandbox->free_in_sandbox(t_buffer_ref);
-
-          Napi::Buffer<char> data = Napi::Buffer<char>::New(env, buffer_ref,
-            tifftagPhotoshopLength, sharp::DeleteCallback);
-
-          info.Set("tifftagPhotoshop", data);
-        }
+      unsigned int const tifftagPhotoshopLength = t_result->tifftagPhotoshopLength.unverified_safe_because(image_attrib_reason);
+      if (tifftagPhotoshopLength > 0) {
+        info.Set("tifftagPhotoshop", bufferAt(t_result->tifftagPhotoshop.unverified_safe_because(image_attrib_reason),
+          tifftagPhotoshopLength));
+      }
+      if (headerOnly) {
+        info.Set("headerComplete", true);
       }
       Callback().MakeCallback(Receiver().Value(), { env.Null(), info });
     } else {
-      auto errString = sandbox->invoke_sandbox_function(MetadataBaton_GetErr, t_baton)
-      .copy_and_verify_string([](std::string val) {
-        // Worst case you'd get a bad error message
-        return val;
-      });
       Callback().MakeCallback(Receiver().Value(), { Napi::Error::New(env, errString.c_str()).Value() });
     }
 
@@ -278,29 +239,202 @@ class MetadataWorker : public Napi::AsyncWorker {
   tainted_vips<MetadataBaton*> t_baton;
   Napi::FunctionReference debuglog;
   rlbox_sandbox_vips* sandbox;
+  bool headerOnly;
 };
 
 /*
   metadata(options, callback)
 */
 Napi::Value metadata(const Napi::CallbackInfo& info) {
-  rlbox_sandbox_vips* sandbox = GetVipsSandbox();
+  Napi::Object options = info[0].As<Napi::Object>();
+  rlbox_sandbox_vips* sandbox = sharp::AcquireSandboxForInput(options.Get("input").As<Napi::Object>());
 
   // V8 objects are converted to non-V8 types held in the baton struct
   tainted_vips<MetadataBaton*> t_baton = sandbox->invoke_sandbox_function(CreateMetadataBaton);
-  Napi::Object options = info[0].As<Napi::Object>();
 
   // Input
   tainted_vips<InputDescriptor*> inputdesc = sharp::CreateInputDescriptor(sandbox, options.Get("input").As<Napi::Object>());
   sandbox->invoke_sandbox_function(MetadataBaton_SetInput, t_baton, inputdesc);
+  bool const headerOnly = sharp::AttrAsBool(options, "metadataHeaderOnly");
+  sandbox->invoke_sandbox_function(MetadataBaton_SetHeaderOnly, t_baton, headerOnly);
 
   // Function to notify of libvips warnings
   Napi::Function debuglog = options.Get("debuglog").As<Napi::Function>();
 
   // Join queue for worker thread
   Napi::Function callback = info[1].As<Napi::Function>();
-  MetadataWorker *worker = new MetadataWorker(callback, t_baton, debuglog, sandbox);
+  MetadataWorker *worker = new MetadataWorker(callback, t_baton, debuglog, sandbox, headerOnly);
+  worker->Receiver().Set("options", options);
+  worker->Queue();
+
+  // Increment queued task counter
+  g_atomic_int_inc(&sharp::counterQueue);
+
+  return info.Env().Undefined();
+}
+
+class MetadataManyWorker : public Napi::AsyncWorker {
+ public:
+  MetadataManyWorker(Napi::Function callback, tainted_vips<MetadataManyBaton*> t_baton, Napi::Function debuglog,
+    rlbox_sandbox_vips* sandbox, size_t count, size_t concurrency) :
+    Napi::AsyncWorker(callback), t_baton(t_baton), debuglog(Napi::Persistent(debuglog)), sandbox(sandbox),
+    count(count), concurrency(concurrency) {}
+  ~MetadataManyWorker() {
+    ReleaseVipsSandbox(sandbox);
+  }
+
+  void Execute() {
+    // Decrement queued task counter
+    g_atomic_int_dec_and_test(&sharp::counterQueue);
+
+    sandbox->invoke_sandbox_function(MetadataManyOpen, t_baton);
+    // Each sandbox call reads one input, with at most concurrency threads taking them in turn
+    std::atomic<size_t> next(0);
+    auto run = [this, &next]() {
+      for (size_t i = next++; i < count; i = next++) {
+        sandbox->invoke_sandbox_function(MetadataManyExecute, t_baton, i);
+      }
+    };
+    size_t const threads = std::max(std::min(concurrency, count), static_cast<size_t>(1));
+    std::vector<std::thread> helpers;
+    helpers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++) {
+      helpers.emplace_back(run);
+    }
+    run();
+    for (std::thread &helper : helpers) {
+      helper.join();
+    }
+  }
+
+  void OnOK() {
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+
+    // Handle warnings
+    std::string warning = sharp::VipsWarningPop();
+    while (!warning.empty()) {
+      debuglog.Call({ Napi::String::New(env, warning) });
+      warning = sharp::VipsWarningPop();
+    }
+
+    // The host knows how many inputs it added, so the sandbox's count is only checked against it
+    bool const complete = sandbox->invoke_sandbox_function(MetadataManyBaton_GetCount, t_baton)
+      .copy_and_verify([this](size_t val) {
+        return val == count;
+      });
+    if (!complete) {
+      sandbox->invoke_sandbox_function(DestroyMetadataManyBaton, t_baton);
+      Callback().MakeCallback(Receiver().Value(), { Napi::Error::New(env, "Unexpected metadata count").Value() });
+      return;
+    }
+
+    // Each column is copied straight into a typed array
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("length", count);
+    Napi::TypedArrayOf<uint8_t> format = CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetFormat, t_baton), count);
+    result.Set("format", format);
+    result.Set("width", CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetWidth, t_baton), count));
+    result.Set("height", CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetHeight, t_baton), count));
+    result.Set("channels", CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetChannels, t_baton), count));
+    result.Set("pages", CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetPages, t_baton), count));
+    result.Set("hasAlpha", CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetHasAlpha, t_baton), count));
+    result.Set("orientation",
+      CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetOrientation, t_baton), count));
+
+    // Names of the format ids, which the ids are checked against
+    int const formatCount = sandbox->invoke_sandbox_function(MetadataMany_GetFormatCount)
+      .unverified_safe_because("Only used to bound the loop below");
+    Napi::Array formats = Napi::Array::New(env);
+    for (int i = 0; i < formatCount; i++) {
+      formats.Set(i, sandbox->invoke_sandbox_function(MetadataMany_GetFormatId, i)
+        .copy_and_verify_string([](std::string val) {
+          sharp::profile::CountBytesOut(val.size());
+          // Worst case, a format is misnamed
+          return val;
+        }));
+    }
+    result.Set("formats", formats);
+    for (size_t i = 0; i < count; i++) {
+      if (format[i] >= formats.Length()) {
+        format[i] = 0;
+      }
+    }
+
+    // Errors are sparse, so are only copied for the inputs that failed
+    Napi::TypedArrayOf<uint8_t> failed =
+      CopyColumn(env, sandbox->invoke_sandbox_function(MetadataManyBaton_GetFailed, t_baton), count);
+    Napi::Array errors = Napi::Array::New(env);
+    for (size_t i = 0; i < count; i++) {
+      if (failed[i]) {
+        Napi::Object error = Napi::Object::New(env);
+        error.Set("index", i);
+        error.Set("message", sandbox->invoke_sandbox_function(MetadataManyBaton_GetErr, t_baton, i)
+          .copy_and_verify_string([](std::string val) {
+            sharp::profile::CountBytesOut(val.size());
+            // Worst case, the wrong reason is given for a failure
+            return val;
+          }));
+        errors.Set(errors.Length(), error);
+      }
+    }
+    result.Set("errors", errors);
+
+    sandbox->invoke_sandbox_function(DestroyMetadataManyBaton, t_baton);
+
+    Callback().MakeCallback(Receiver().Value(), { env.Null(), result });
+  }
+
+ private:
+  tainted_vips<MetadataManyBaton*> t_baton;
+  Napi::FunctionReference debuglog;
+  rlbox_sandbox_vips* sandbox;
+  size_t const count;
+  size_t const concurrency;
+
+  template <typename T>
+  static Napi::TypedArrayOf<T> CopyColumn(Napi::Env env, tainted_vips<T*> t_column, size_t count) {
+    Napi::TypedArrayOf<T> column = Napi::TypedArrayOf<T>::New(env, count);
+    if (count > 0) {
+      t_column.copy_and_verify_range([&column, count](std::unique_ptr<T[]> val) {
+        memcpy(column.Data(), val.get(), count * sizeof(T));
+        return true;
+      }, count);
+      sharp::profile::CountBytesOut(count * sizeof(T));
+    }
+    return column;
+  }
+};
+
+/*
+  metadataMany(inputs, options, callback)
+*/
+Napi::Value metadataMany(const Napi::CallbackInfo& info) {
+  Napi::Array inputs = info[0].As<Napi::Array>();
+  Napi::Object options = info[1].As<Napi::Object>();
+  // Prefer the sandbox holding the first input, which is likely where the rest were allocated
+  rlbox_sandbox_vips* sandbox = inputs.Length() > 0
+    ? sharp::AcquireSandboxForInput(inputs.Get(0u).As<Napi::Object>())
+    : AcquireVipsSandbox();
+
+  tainted_vips<MetadataManyBaton*> t_baton = sandbox->invoke_sandbox_function(CreateMetadataManyBaton);
+  for (uint32_t i = 0; i < inputs.Length(); i++) {
+    tainted_vips<InputDescriptor*> inputdesc = sharp::CreateInputDescriptor(sandbox, inputs.Get(i).As<Napi::Object>());
+    sandbox->invoke_sandbox_function(MetadataManyBaton_AddInput, t_baton, inputdesc);
+  }
+  sandbox->invoke_sandbox_function(MetadataManyBaton_SetHeaderOnly, t_baton,
+    sharp::AttrAsBool(options, "headerOnly"));
+
+  // Function to notify of libvips warnings
+  Napi::Function debuglog = options.Get("debuglog").As<Napi::Function>();
+
+  // Join queue for worker thread, as a single task however many inputs there are
+  Napi::Function callback = info[2].As<Napi::Function>();
+  MetadataManyWorker *worker = new MetadataManyWorker(callback, t_baton, debuglog, sandbox, inputs.Length(),
+    static_cast<size_t>(std::max(sharp::AttrAsInt32(options, "concurrency"), 1)));
   worker->Receiver().Set("options", options);
+  // Keep input Buffers alive until the worker completes
+  worker->Receiver().Set("inputs", inputs);
   worker->Queue();
 
   // Increment queued task counter
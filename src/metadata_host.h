@@ -18,5 +18,6 @@
 #include <napi.h>
 
 Napi::Value metadata(const Napi::CallbackInfo& info);
+Napi::Value metadataMany(const Napi::CallbackInfo& info);
 
 #endif  // SRC_METADATA_HOST_H_
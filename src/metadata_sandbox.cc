@@ -1,19 +1,94 @@
 #include "metadata_sandbox.h"
 #include "common_sandbox.h"
 
-#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <utility>
 
-void MetadataWorkerExecute(MetadataBaton* baton) {
+/*
+  Append bytes to the blob region at the given alignment, returning their offset
+*/
+static unsigned int AppendToBlob(MetadataBaton *baton, void const *data, size_t length, size_t alignment = 1) {
+  size_t const offset = (baton->blob.size() + alignment - 1) / alignment * alignment;
+  baton->blob.resize(offset + length);
+  if (length > 0) {
+    memcpy(baton->blob.data() + offset, data, length);
+  }
+  return static_cast<unsigned int>(offset);
+}
+
+static unsigned int AppendString(MetadataBaton *baton, std::string const &str) {
+  return AppendToBlob(baton, str.c_str(), str.size() + 1);
+}
+
+static std::pair<unsigned int, unsigned int> AppendBlob(MetadataBaton *baton, vips::VImage image, char const *name) {
+  if (image.get_typeof(name) != VIPS_TYPE_BLOB) {
+    return std::make_pair(0u, 0u);
+  }
+  size_t length;
+  void const *data = image.get_blob(name, &length);
+  return std::make_pair(AppendToBlob(baton, data, length), static_cast<unsigned int>(length));
+}
+
+/*
+  Pack everything the host reads into the result and its blob region
+*/
+static void FillMetadataResult(MetadataBaton *baton) {
+  MetadataResult &result = baton->result;
+  result.err = AppendString(baton, baton->err);
+  result.format = AppendString(baton, baton->format);
+  result.size = baton->input != nullptr ? baton->input->bufferLength : 0;
+  result.width = baton->width;
+  result.height = baton->height;
+  result.space = AppendString(baton, baton->space);
+  result.channels = baton->channels;
+  result.depth = AppendString(baton, baton->depth);
+  result.density = baton->density;
+  result.chromaSubsampling = AppendString(baton, baton->chromaSubsampling);
+  result.isProgressive = baton->isProgressive;
+  result.paletteBitDepth = baton->paletteBitDepth;
+  result.pages = baton->pages;
+  result.pageHeight = baton->pageHeight;
+  result.loop = baton->loop;
+  result.delay = AppendToBlob(baton, baton->delay.data(), baton->delay.size() * sizeof(int), alignof(int));
+  result.delayCount = static_cast<unsigned int>(baton->delay.size());
+  result.pagePrimary = baton->pagePrimary;
+  result.compression = AppendString(baton, baton->compression);
+  result.resolutionUnit = AppendString(baton, baton->resolutionUnit);
+  result.levels = AppendToBlob(baton, baton->levels.data(), baton->levels.size() * sizeof(MetadataDimension),
+    alignof(MetadataDimension));
+  result.levelsCount = static_cast<unsigned int>(baton->levels.size());
+  result.subifds = baton->subifds;
+  result.background = AppendToBlob(baton, baton->background.data(), baton->background.size() * sizeof(double),
+    alignof(double));
+  result.backgroundCount = static_cast<unsigned int>(baton->background.size());
+  result.hasProfile = baton->hasProfile;
+  result.hasAlpha = baton->hasAlpha;
+  result.orientation = baton->orientation;
+  result.headerComplete = baton->headerComplete;
+  result.blob = baton->blob.data();
+  result.blobLength = baton->blob.size();
+}
+
+static sharp::ImageType RunMetadata(MetadataBaton* baton) {
   vips::VImage image;
   sharp::ImageType imageType = sharp::ImageType::UNKNOWN;
   try {
-    std::tie(image, imageType) = sharp::OpenInput(baton->input);
+    if (baton->headerOnly) {
+      std::tie(image, imageType, baton->headerComplete) = sharp::OpenInputHeader(baton->input);
+    } else {
+      std::tie(image, imageType) = sharp::OpenInput(baton->input);
+      baton->headerComplete = true;
+    }
   } catch (vips::VError const &err) {
     (baton->err).append(err.what());
   }
   if (imageType != sharp::ImageType::UNKNOWN) {
     // Image type
     baton->format = sharp::ImageTypeId(imageType);
+  }
+  if (imageType != sharp::ImageType::UNKNOWN && baton->headerComplete) {
     // VipsImage attributes
     baton->width = image.width();
     baton->height = image.height();
@@ -73,51 +148,61 @@ void MetadataWorkerExecute(MetadataBaton* baton) {
     // Derived attributes
     baton->hasAlpha = sharp::HasAlpha(image);
     baton->orientation = sharp::ExifOrientation(image);
-    // EXIF
-    if (image.get_typeof(VIPS_META_EXIF_NAME) == VIPS_TYPE_BLOB) {
-      size_t exifLength;
-      void const *exif = image.get_blob(VIPS_META_EXIF_NAME, &exifLength);
-      baton->exif = static_cast<char*>(g_malloc(exifLength));
-      memcpy(baton->exif, exif, exifLength);
-      baton->exifLength = exifLength;
-    }
-    // ICC profile
-    if (image.get_typeof(VIPS_META_ICC_NAME) == VIPS_TYPE_BLOB) {
-      size_t iccLength;
-      void const *icc = image.get_blob(VIPS_META_ICC_NAME, &iccLength);
-      baton->icc = static_cast<char*>(g_malloc(iccLength));
-      memcpy(baton->icc, icc, iccLength);
-      baton->iccLength = iccLength;
-    }
-    // IPTC
-    if (image.get_typeof(VIPS_META_IPTC_NAME) == VIPS_TYPE_BLOB) {
-      size_t iptcLength;
-      void const *iptc = image.get_blob(VIPS_META_IPTC_NAME, &iptcLength);
-      baton->iptc = static_cast<char *>(g_malloc(iptcLength));
-      memcpy(baton->iptc, iptc, iptcLength);
-      baton->iptcLength = iptcLength;
-    }
-    // XMP
-    if (image.get_typeof(VIPS_META_XMP_NAME) == VIPS_TYPE_BLOB) {
-      size_t xmpLength;
-      void const *xmp = image.get_blob(VIPS_META_XMP_NAME, &xmpLength);
-      baton->xmp = static_cast<char *>(g_malloc(xmpLength));
-      memcpy(baton->xmp, xmp, xmpLength);
-      baton->xmpLength = xmpLength;
-    }
-    // TIFFTAG_PHOTOSHOP
-    if (image.get_typeof(VIPS_META_PHOTOSHOP_NAME) == VIPS_TYPE_BLOB) {
-      size_t tifftagPhotoshopLength;
-      void const *tifftagPhotoshop = image.get_blob(VIPS_META_PHOTOSHOP_NAME, &tifftagPhotoshopLength);
-      baton->tifftagPhotoshop = static_cast<char *>(g_malloc(tifftagPhotoshopLength));
-      memcpy(baton->tifftagPhotoshop, tifftagPhotoshop, tifftagPhotoshopLength);
-      baton->tifftagPhotoshopLength = tifftagPhotoshopLength;
-    }
+    // EXIF, ICC profile, IPTC, XMP and TIFFTAG_PHOTOSHOP
+    std::tie(baton->result.exif, baton->result.exifLength) = AppendBlob(baton, image, VIPS_META_EXIF_NAME);
+    std::tie(baton->result.icc, baton->result.iccLength) = AppendBlob(baton, image, VIPS_META_ICC_NAME);
+    std::tie(baton->result.iptc, baton->result.iptcLength) = AppendBlob(baton, image, VIPS_META_IPTC_NAME);
+    std::tie(baton->result.xmp, baton->result.xmpLength) = AppendBlob(baton, image, VIPS_META_XMP_NAME);
+    std::tie(baton->result.tifftagPhotoshop, baton->result.tifftagPhotoshopLength) =
+      AppendBlob(baton, image, VIPS_META_PHOTOSHOP_NAME);
   }
 
   // Clean up
   vips_error_clear();
   vips_thread_shutdown();
+  return imageType;
+}
+
+void MetadataWorkerExecute(MetadataBaton* baton) {
+  RunMetadata(baton);
+  FillMetadataResult(baton);
+}
+
+void MetadataManyOpen(MetadataManyBaton* baton) {
+  size_t const count = baton->inputs.size();
+  baton->format.assign(count, static_cast<uint8_t>(sharp::ImageType::UNKNOWN));
+  baton->width.assign(count, 0);
+  baton->height.assign(count, 0);
+  baton->channels.assign(count, 0);
+  baton->pages.assign(count, 0);
+  baton->hasAlpha.assign(count, 0);
+  baton->orientation.assign(count, 0);
+  baton->failed.assign(count, 0);
+  baton->err.assign(count, std::string());
+}
+
+void MetadataManyExecute(MetadataManyBaton* baton, size_t index) {
+  if (index >= baton->failed.size()) {
+    return;
+  }
+  // Writes only to its own row of every column, so calls for different inputs may run concurrently
+  MetadataBaton item;
+  item.input = baton->inputs[index];
+  item.headerOnly = baton->headerOnly;
+  sharp::ImageType const imageType = RunMetadata(&item);
+  item.input = nullptr;
+  baton->format[index] = static_cast<uint8_t>(imageType);
+  if (!item.err.empty() || !item.headerComplete) {
+    baton->failed[index] = 1;
+    baton->err[index] = item.err.empty() ? "Input buffer ends before the end of its header" : item.err;
+    return;
+  }
+  baton->width[index] = item.width;
+  baton->height[index] = item.height;
+  baton->channels[index] = item.channels;
+  baton->pages[index] = std::max(item.pages, 1);
+  baton->hasAlpha[index] = item.hasAlpha;
+  baton->orientation[index] = item.orientation;
 }
 
 MetadataBaton* CreateMetadataBaton() {
@@ -129,80 +214,43 @@ void DestroyMetadataBaton(MetadataBaton* baton) {
   delete baton;
 }
 
-InputDescriptor* MetadataBaton_GetInput(MetadataBaton* baton) { return baton->input; }
 void MetadataBaton_SetInput(MetadataBaton* baton, InputDescriptor* val) { baton->input = val; }
-const char* MetadataBaton_GetFormat(MetadataBaton* baton) { return baton->format.c_str(); }
-void MetadataBaton_SetFormat(MetadataBaton* baton, const char* val) { baton->format = val; }
-int MetadataBaton_GetWidth(MetadataBaton* baton) { return baton->width; }
-void MetadataBaton_SetWidth(MetadataBaton* baton, int val) { baton->width = val; }
-int MetadataBaton_GetHeight(MetadataBaton* baton) { return baton->height; }
-void MetadataBaton_SetHeight(MetadataBaton* baton, int val) { baton->height = val; }
-const char* MetadataBaton_GetSpace(MetadataBaton* baton) { return baton->space.c_str(); }
-void MetadataBaton_SetSpace(MetadataBaton* baton, const char* val) { baton->space = val; }
-int MetadataBaton_GetChannels(MetadataBaton* baton) { return baton->channels; }
-void MetadataBaton_SetChannels(MetadataBaton* baton, int val) { baton->channels = val; }
-const char* MetadataBaton_GetDepth(MetadataBaton* baton) { return baton->depth.c_str(); }
-void MetadataBaton_SetDepth(MetadataBaton* baton, const char* val) { baton->depth = val; }
-int MetadataBaton_GetDensity(MetadataBaton* baton) { return baton->density; }
-void MetadataBaton_SetDensity(MetadataBaton* baton, int val) { baton->density = val; }
-const char* MetadataBaton_GetChromaSubsampling(MetadataBaton* baton) { return baton->chromaSubsampling.c_str(); }
-void MetadataBaton_SetChromaSubsampling(MetadataBaton* baton, const char* val) { baton->chromaSubsampling = val; }
-bool MetadataBaton_GetIsProgressive(MetadataBaton* baton) { return baton->isProgressive; }
-void MetadataBaton_SetIsProgressive(MetadataBaton* baton, bool val) { baton->isProgressive = val; }
-int MetadataBaton_GetPaletteBitDepth(MetadataBaton* baton) { return baton->paletteBitDepth; }
-void MetadataBaton_SetPaletteBitDepth(MetadataBaton* baton, int val) { baton->paletteBitDepth = val; }
-int MetadataBaton_GetPages(MetadataBaton* baton) { return baton->pages; }
-void MetadataBaton_SetPages(MetadataBaton* baton, int val) { baton->pages = val; }
-int MetadataBaton_GetPageHeight(MetadataBaton* baton) { return baton->pageHeight; }
-void MetadataBaton_SetPageHeight(MetadataBaton* baton, int val) { baton->pageHeight = val; }
-int MetadataBaton_GetLoop(MetadataBaton* baton) { return baton->loop; }
-void MetadataBaton_SetLoop(MetadataBaton* baton, int val) { baton->loop = val; }
-int* MetadataBaton_GetDelay(MetadataBaton* baton) { return baton->delay.data(); }
-void MetadataBaton_SetDelay(MetadataBaton* baton, std::vector<int> val) { baton->delay = val; }
-int MetadataBaton_GetPagePrimary(MetadataBaton* baton) { return baton->pagePrimary; }
-void MetadataBaton_SetPagePrimary(MetadataBaton* baton, int val) { baton->pagePrimary = val; }
-const char* MetadataBaton_GetCompression(MetadataBaton* baton) { return baton->compression.c_str(); }
-void MetadataBaton_SetCompression(MetadataBaton* baton, const char* val) { baton->compression = val; }
-const char* MetadataBaton_GetResolutionUnit(MetadataBaton* baton) { return baton->resolutionUnit.c_str(); }
-void MetadataBaton_SetResolutionUnit(MetadataBaton* baton, const char* val) { baton->resolutionUnit = val; }
-MetadataDimension* MetadataBaton_GetLevels(MetadataBaton* baton) { return baton->levels.data(); }
-void MetadataBaton_SetLevels(MetadataBaton* baton, std::vector<MetadataDimension> val) { baton->levels = val; }
-int MetadataBaton_GetSubifds(MetadataBaton* baton) { return baton->subifds; }
-void MetadataBaton_SetSubifds(MetadataBaton* baton, int val) { baton->subifds = val; }
-double* MetadataBaton_GetBackground(MetadataBaton* baton) { return baton->background.data(); }
-void MetadataBaton_SetBackground(MetadataBaton* baton, std::vector<double> val) { baton->background = val; }
-bool MetadataBaton_GetHasProfile(MetadataBaton* baton) { return baton->hasProfile; }
-void MetadataBaton_SetHasProfile(MetadataBaton* baton, bool val) { baton->hasProfile = val; }
-bool MetadataBaton_GetHasAlpha(MetadataBaton* baton) { return baton->hasAlpha; }
-void MetadataBaton_SetHasAlpha(MetadataBaton* baton, bool val) { baton->hasAlpha = val; }
-int MetadataBaton_GetOrientation(MetadataBaton* baton) { return baton->orientation; }
-void MetadataBaton_SetOrientation(MetadataBaton* baton, int val) { baton->orientation = val; }
-char* MetadataBaton_GetExif(MetadataBaton* baton) { return baton->exif; }
-void MetadataBaton_SetExif(MetadataBaton* baton, char* val) { baton->exif = val; }
-size_t MetadataBaton_GetExifLength(MetadataBaton* baton) { return baton->exifLength; }
-void MetadataBaton_SetExifLength(MetadataBaton* baton, size_t val) { baton->exifLength = val; }
-char* MetadataBaton_GetIcc(MetadataBaton* baton) { return baton->icc; }
-void MetadataBaton_SetIcc(MetadataBaton* baton, char* val) { baton->icc = val; }
-size_t MetadataBaton_GetIccLength(MetadataBaton* baton) { return baton->iccLength; }
-void MetadataBaton_SetIccLength(MetadataBaton* baton, size_t val) { baton->iccLength = val; }
-char* MetadataBaton_GetIptc(MetadataBaton* baton) { return baton->iptc; }
-void MetadataBaton_SetIptc(MetadataBaton* baton, char* val) { baton->iptc = val; }
-size_t MetadataBaton_GetIptcLength(MetadataBaton* baton) { return baton->iptcLength; }
-void MetadataBaton_SetIptcLength(MetadataBaton* baton, size_t val) { baton->iptcLength = val; }
-char* MetadataBaton_GetXmp(MetadataBaton* baton) { return baton->xmp; }
-void MetadataBaton_SetXmp(MetadataBaton* baton, char* val) { baton->xmp = val; }
-size_t MetadataBaton_GetXmpLength(MetadataBaton* baton) { return baton->xmpLength; }
-void MetadataBaton_SetXmpLength(MetadataBaton* baton, size_t val) { baton->xmpLength = val; }
-char* MetadataBaton_GetTifftagPhotoshop(MetadataBaton* baton) { return baton->tifftagPhotoshop; }
-void MetadataBaton_SetTifftagPhotoshop(MetadataBaton* baton, char* val) { baton->tifftagPhotoshop = val; }
-size_t MetadataBaton_GetTifftagPhotoshopLength(MetadataBaton* baton) { return baton->tifftagPhotoshopLength; }
-void MetadataBaton_SetTifftagPhotoshopLength(MetadataBaton* baton, size_t val) { baton->tifftagPhotoshopLength = val; }
-const char* MetadataBaton_GetErr(MetadataBaton* baton) { return baton->err.c_str(); }
-void MetadataBaton_SetErr(MetadataBaton* baton, const char* val) { baton->err = val; }
-
-size_t MetadataBaton_GetDelay_Size(MetadataBaton* baton) { return baton->delay.size(); }
-bool MetadataBaton_GetDelay_Empty(MetadataBaton* baton) { return baton->delay.empty(); }
-size_t MetadataBaton_GetLevels_Size(MetadataBaton* baton) { return baton->levels.size(); }
-bool MetadataBaton_GetLevels_Empty(MetadataBaton* baton) { return baton->levels.empty(); }
-size_t MetadataBaton_GetBackground_Size(MetadataBaton* baton) { return baton->background.size(); }
-bool MetadataBaton_GetBackground_Empty(MetadataBaton* baton) { return baton->background.empty(); }
+void MetadataBaton_SetHeaderOnly(MetadataBaton* baton, bool val) { baton->headerOnly = val; }
+MetadataResult* MetadataBaton_GetResult(MetadataBaton* baton) { return &baton->result; }
+
+MetadataManyBaton* CreateMetadataManyBaton() {
+  return new MetadataManyBaton;
+}
+
+void DestroyMetadataManyBaton(MetadataManyBaton* baton) {
+  for (InputDescriptor *input : baton->inputs) {
+    delete input;
+  }
+  delete baton;
+}
+
+void MetadataManyBaton_AddInput(MetadataManyBaton* baton, InputDescriptor* val) { baton->inputs.push_back(val); }
+void MetadataManyBaton_SetHeaderOnly(MetadataManyBaton* baton, bool val) { baton->headerOnly = val; }
+size_t MetadataManyBaton_GetCount(MetadataManyBaton* baton) { return baton->failed.size(); }
+uint8_t* MetadataManyBaton_GetFormat(MetadataManyBaton* baton) { return baton->format.data(); }
+uint32_t* MetadataManyBaton_GetWidth(MetadataManyBaton* baton) { return baton->width.data(); }
+uint32_t* MetadataManyBaton_GetHeight(MetadataManyBaton* baton) { return baton->height.data(); }
+uint8_t* MetadataManyBaton_GetChannels(MetadataManyBaton* baton) { return baton->channels.data(); }
+uint32_t* MetadataManyBaton_GetPages(MetadataManyBaton* baton) { return baton->pages.data(); }
+uint8_t* MetadataManyBaton_GetHasAlpha(MetadataManyBaton* baton) { return baton->hasAlpha.data(); }
+uint8_t* MetadataManyBaton_GetOrientation(MetadataManyBaton* baton) { return baton->orientation.data(); }
+uint8_t* MetadataManyBaton_GetFailed(MetadataManyBaton* baton) { return baton->failed.data(); }
+const char* MetadataManyBaton_GetErr(MetadataManyBaton* baton, size_t index) {
+  return index < baton->err.size() ? baton->err[index].c_str() : "";
+}
+int MetadataMany_GetFormatCount() { return static_cast<int>(sharp::ImageType::MISSING) + 1; }
+const char* MetadataMany_GetFormatId(int format) {
+  static std::vector<std::string> const ids = []() {
+    std::vector<std::string> ids;
+    for (int i = 0; i < MetadataMany_GetFormatCount(); i++) {
+      ids.push_back(sharp::ImageTypeId(static_cast<sharp::ImageType>(i)));
+    }
+    return ids;
+  }();
+  return format >= 0 && format < static_cast<int>(ids.size()) ? ids[format].c_str() : "";
+}
@@ -1,6 +1,7 @@
 #ifndef SRC_METADATA_SANDBOX_H_
 #define SRC_METADATA_SANDBOX_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -10,9 +11,63 @@ struct MetadataDimension {
     int width;
     int height;
 };
+/*
+  Everything the host needs from a metadata request, filled at the end of MetadataWorkerExecute.
+  Strings, arrays and metadata blobs are packed into one blob region and referenced by offset,
+  so the host can copy them all out at once. Strings are NUL-terminated.
+*/
+struct MetadataResult {
+  unsigned int err;
+  unsigned int format;
+  size_t size;
+  int width;
+  int height;
+  unsigned int space;
+  int channels;
+  unsigned int depth;
+  int density;
+  unsigned int chromaSubsampling;
+  bool isProgressive;
+  int paletteBitDepth;
+  int pages;
+  int pageHeight;
+  int loop;
+  // int[delayCount]
+  unsigned int delay;
+  unsigned int delayCount;
+  int pagePrimary;
+  unsigned int compression;
+  unsigned int resolutionUnit;
+  // MetadataDimension[levelsCount]
+  unsigned int levels;
+  unsigned int levelsCount;
+  int subifds;
+  // double[backgroundCount]
+  unsigned int background;
+  unsigned int backgroundCount;
+  bool hasProfile;
+  bool hasAlpha;
+  int orientation;
+  unsigned int exif;
+  unsigned int exifLength;
+  unsigned int icc;
+  unsigned int iccLength;
+  unsigned int iptc;
+  unsigned int iptcLength;
+  unsigned int xmp;
+  unsigned int xmpLength;
+  unsigned int tifftagPhotoshop;
+  unsigned int tifftagPhotoshopLength;
+  bool headerComplete;
+  // The blob region
+  char *blob;
+  size_t blobLength;
+};
+
 struct MetadataBaton {
   // Input
   InputDescriptor *input;
+  bool headerOnly;
   // Output
   std::string format;
   int width;
@@ -37,20 +92,15 @@ struct MetadataBaton {
   bool hasProfile;
   bool hasAlpha;
   int orientation;
-  char *exif;
-  size_t exifLength;
-  char *icc;
-  size_t iccLength;
-  char *iptc;
-  size_t iptcLength;
-  char *xmp;
-  size_t xmpLength;
-  char *tifftagPhotoshop;
-  size_t tifftagPhotoshopLength;
+  bool headerComplete;
+  // Metadata blobs, packed straight into the blob region
+  std::vector<char> blob;
   std::string err;
+  MetadataResult result;
 
   MetadataBaton():
     input(nullptr),
+    headerOnly(false),
     width(0),
     height(0),
     channels(0),
@@ -65,101 +115,62 @@ struct MetadataBaton {
     hasProfile(false),
     hasAlpha(false),
     orientation(0),
-    exif(nullptr),
-    exifLength(0),
-    icc(nullptr),
-    iccLength(0),
-    iptc(nullptr),
-    iptcLength(0),
-    xmp(nullptr),
-    xmpLength(0),
-    tifftagPhotoshop(nullptr),
-    tifftagPhotoshopLength(0) {}
+    headerComplete(false),
+    result() {}
+};
+
+/*
+  Metadata of many inputs, gathered one input per call from a pool of host threads and stored by column.
+  A format is the numeric image type, see MetadataMany_GetFormatId.
+*/
+struct MetadataManyBaton {
+  // Input
+  std::vector<InputDescriptor*> inputs;
+  bool headerOnly;
+  // Output, one entry per input
+  std::vector<uint8_t> format;
+  std::vector<uint32_t> width;
+  std::vector<uint32_t> height;
+  std::vector<uint8_t> channels;
+  std::vector<uint32_t> pages;
+  std::vector<uint8_t> hasAlpha;
+  std::vector<uint8_t> orientation;
+  std::vector<uint8_t> failed;
+  std::vector<std::string> err;
+
+  MetadataManyBaton():
+    headerOnly(false) {}
 };
 
 extern "C" {
   void MetadataWorkerExecute(MetadataBaton* baton);
+  // Sizes the output columns once all inputs are added, before any call to MetadataManyExecute.
+  void MetadataManyOpen(MetadataManyBaton* baton);
+  void MetadataManyExecute(MetadataManyBaton* baton, size_t index);
 
   MetadataBaton* CreateMetadataBaton();
   void DestroyMetadataBaton(MetadataBaton* baton);
 
-  InputDescriptor* MetadataBaton_GetInput(MetadataBaton* baton);
   void MetadataBaton_SetInput(MetadataBaton* baton, InputDescriptor* val);
-  const char* MetadataBaton_GetFormat(MetadataBaton* baton);
-  void MetadataBaton_SetFormat(MetadataBaton* baton, const char* val);
-  int MetadataBaton_GetWidth(MetadataBaton* baton);
-  void MetadataBaton_SetWidth(MetadataBaton* baton, int val);
-  int MetadataBaton_GetHeight(MetadataBaton* baton);
-  void MetadataBaton_SetHeight(MetadataBaton* baton, int val);
-  const char* MetadataBaton_GetSpace(MetadataBaton* baton);
-  void MetadataBaton_SetSpace(MetadataBaton* baton, const char* val);
-  int MetadataBaton_GetChannels(MetadataBaton* baton);
-  void MetadataBaton_SetChannels(MetadataBaton* baton, int val);
-  const char* MetadataBaton_GetDepth(MetadataBaton* baton);
-  void MetadataBaton_SetDepth(MetadataBaton* baton, const char* val);
-  int MetadataBaton_GetDensity(MetadataBaton* baton);
-  void MetadataBaton_SetDensity(MetadataBaton* baton, int val);
-  const char* MetadataBaton_GetChromaSubsampling(MetadataBaton* baton);
-  void MetadataBaton_SetChromaSubsampling(MetadataBaton* baton, const char* val);
-  bool MetadataBaton_GetIsProgressive(MetadataBaton* baton);
-  void MetadataBaton_SetIsProgressive(MetadataBaton* baton, bool val);
-  int MetadataBaton_GetPaletteBitDepth(MetadataBaton* baton);
-  void MetadataBaton_SetPaletteBitDepth(MetadataBaton* baton, int val);
-  int MetadataBaton_GetPages(MetadataBaton* baton);
-  void MetadataBaton_SetPages(MetadataBaton* baton, int val);
-  int MetadataBaton_GetPageHeight(MetadataBaton* baton);
-  void MetadataBaton_SetPageHeight(MetadataBaton* baton, int val);
-  int MetadataBaton_GetLoop(MetadataBaton* baton);
-  void MetadataBaton_SetLoop(MetadataBaton* baton, int val);
-  int* MetadataBaton_GetDelay(MetadataBaton* baton);
-  void MetadataBaton_SetDelay(MetadataBaton* baton, std::vector<int> val);
-  int MetadataBaton_GetPagePrimary(MetadataBaton* baton);
-  void MetadataBaton_SetPagePrimary(MetadataBaton* baton, int val);
-  const char* MetadataBaton_GetCompression(MetadataBaton* baton);
-  void MetadataBaton_SetCompression(MetadataBaton* baton, const char* val);
-  const char* MetadataBaton_GetResolutionUnit(MetadataBaton* baton);
-  void MetadataBaton_SetResolutionUnit(MetadataBaton* baton, const char* val);
-  MetadataDimension* MetadataBaton_GetLevels(MetadataBaton* baton);
-  void MetadataBaton_SetLevels(MetadataBaton* baton, std::vector<MetadataDimension> val);
-  int MetadataBaton_GetSubifds(MetadataBaton* baton);
-  void MetadataBaton_SetSubifds(MetadataBaton* baton, int val);
-  double* MetadataBaton_GetBackground(MetadataBaton* baton);
-  void MetadataBaton_SetBackground(MetadataBaton* baton, std::vector<double> val);
-  bool MetadataBaton_GetHasProfile(MetadataBaton* baton);
-  void MetadataBaton_SetHasProfile(MetadataBaton* baton, bool val);
-  bool MetadataBaton_GetHasAlpha(MetadataBaton* baton);
-  void MetadataBaton_SetHasAlpha(MetadataBaton* baton, bool val);
-  int MetadataBaton_GetOrientation(MetadataBaton* baton);
-  void MetadataBaton_SetOrientation(MetadataBaton* baton, int val);
-  char* MetadataBaton_GetExif(MetadataBaton* baton);
-  void MetadataBaton_SetExif(MetadataBaton* baton, char* val);
-  size_t MetadataBaton_GetExifLength(MetadataBaton* baton);
-  void MetadataBaton_SetExifLength(MetadataBaton* baton, size_t val);
-  char* MetadataBaton_GetIcc(MetadataBaton* baton);
-  void MetadataBaton_SetIcc(MetadataBaton* baton, char* val);
-  size_t MetadataBaton_GetIccLength(MetadataBaton* baton);
-  void MetadataBaton_SetIccLength(MetadataBaton* baton, size_t val);
-  char* MetadataBaton_GetIptc(MetadataBaton* baton);
-  void MetadataBaton_SetIptc(MetadataBaton* baton, char* val);
-  size_t MetadataBaton_GetIptcLength(MetadataBaton* baton);
-  void MetadataBaton_SetIptcLength(MetadataBaton* baton, size_t val);
-  char* MetadataBaton_GetXmp(MetadataBaton* baton);
-  void MetadataBaton_SetXmp(MetadataBaton* baton, char* val);
-  size_t MetadataBaton_GetXmpLength(MetadataBaton* baton);
-  void MetadataBaton_SetXmpLength(MetadataBaton* baton, size_t val);
-  char* MetadataBaton_GetTifftagPhotoshop(MetadataBaton* baton);
-  void MetadataBaton_SetTifftagPhotoshop(MetadataBaton* baton, char* val);
-  size_t MetadataBaton_GetTifftagPhotoshopLength(MetadataBaton* baton);
-  void MetadataBaton_SetTifftagPhotoshopLength(MetadataBaton* baton, size_t val);
-  const char* MetadataBaton_GetErr(MetadataBaton* baton);
-  void MetadataBaton_SetErr(MetadataBaton* baton, const char* val);
+  void MetadataBaton_SetHeaderOnly(MetadataBaton* baton, bool val);
+  MetadataResult* MetadataBaton_GetResult(MetadataBaton* baton);
 
-  size_t MetadataBaton_GetDelay_Size(MetadataBaton* baton);
-  bool MetadataBaton_GetDelay_Empty(MetadataBaton* baton);
-  size_t MetadataBaton_GetLevels_Size(MetadataBaton* baton);
-  bool MetadataBaton_GetLevels_Empty(MetadataBaton* baton);
-  size_t MetadataBaton_GetBackground_Size(MetadataBaton* baton);
-  bool MetadataBaton_GetBackground_Empty(MetadataBaton* baton);
+  MetadataManyBaton* CreateMetadataManyBaton();
+  void DestroyMetadataManyBaton(MetadataManyBaton* baton);
+  void MetadataManyBaton_AddInput(MetadataManyBaton* baton, InputDescriptor* val);
+  void MetadataManyBaton_SetHeaderOnly(MetadataManyBaton* baton, bool val);
+  size_t MetadataManyBaton_GetCount(MetadataManyBaton* baton);
+  uint8_t* MetadataManyBaton_GetFormat(MetadataManyBaton* baton);
+  uint32_t* MetadataManyBaton_GetWidth(MetadataManyBaton* baton);
+  uint32_t* MetadataManyBaton_GetHeight(MetadataManyBaton* baton);
+  uint8_t* MetadataManyBaton_GetChannels(MetadataManyBaton* baton);
+  uint32_t* MetadataManyBaton_GetPages(MetadataManyBaton* baton);
+  uint8_t* MetadataManyBaton_GetHasAlpha(MetadataManyBaton* baton);
+  uint8_t* MetadataManyBaton_GetOrientation(MetadataManyBaton* baton);
+  uint8_t* MetadataManyBaton_GetFailed(MetadataManyBaton* baton);
+  const char* MetadataManyBaton_GetErr(MetadataManyBaton* baton, size_t index);
+  int MetadataMany_GetFormatCount();
+  const char* MetadataMany_GetFormatId(int format);
 }
 
 #endif  // SRC_METADATA_SANDBOX_H_
\ No newline at end of file
@@ -148,10 +148,10 @@ namespace sharp {
    */
   VImage Convolve(VImage image, int const width, int const height,
     double const scale, double const offset,
-    std::unique_ptr<double[]> const &kernel_v
+    std::vector<double> const &kernel_v
   ) {
     VImage kernel = VImage::new_from_memory(
-      kernel_v.get(),
+      const_cast<double*>(kernel_v.data()),
       width * height * sizeof(double),
       width,
       height,
@@ -167,8 +167,8 @@ namespace sharp {
    * Recomb with a Matrix of the given bands/channel size.
    * Eg. RGB will be a 3x3 matrix.
    */
-  VImage Recomb(VImage image, std::unique_ptr<double[]> const &matrix) {
-    double *m = matrix.get();
+  VImage Recomb(VImage image, std::vector<double> const &matrix) {
+    double *m = const_cast<double*>(matrix.data());
     image = image.colourspace(VIPS_INTERPRETATION_sRGB);
     return image
       .recomb(image.bands() == 3
@@ -291,17 +291,163 @@ namespace sharp {
     return image.extract_area(left, top, width, height);
   }
 
+  BandTransform::BandTransform(VImage const &image) :
+    inputBands(image.bands()),
+    inputInterpretation(image.interpretation()),
+    interpretation(image.interpretation()),
+    hasAlpha(sharp::HasAlpha(image)) {
+    for (int i = 0; i < inputBands; i++) {
+      std::vector<double> row(inputBands + 1, 0.0);
+      row[i] = 1.0;
+      rows.push_back(row);
+    }
+  }
+
+  bool BandTransform::CanRecomb() const {
+    return interpretation == VIPS_INTERPRETATION_sRGB && (Bands() == 3 || Bands() == 4);
+  }
+
   /*
-   * Calculate (a * in + b)
+   * As Recomb, on an image that is already sRGB: the matrix mixes the first three bands.
    */
-  VImage Linear(VImage image, double const a, double const b) {
-    if (HasAlpha(image)) {
-      // Separate alpha channel
-      VImage alpha = image[image.bands() - 1];
-      return RemoveAlpha(image).linear(a, b).bandjoin(alpha);
+  BandTransform &BandTransform::Recomb(std::vector<double> const &matrix) {
+    std::vector<std::vector<double>> mixed(rows);
+    for (int out = 0; out < 3; out++) {
+      for (size_t column = 0; column < mixed[out].size(); column++) {
+        mixed[out][column] = 0.0;
+        for (int in = 0; in < 3; in++) {
+          mixed[out][column] += matrix[out * 3 + in] * rows[in][column];
+        }
+      }
+    }
+    rows = mixed;
+    return *this;
+  }
+
+  /*
+   * As Linear: every band but alpha.
+   */
+  BandTransform &BandTransform::Linear(double const a, double const b) {
+    int const colourBands = Bands() - (hasAlpha ? 1 : 0);
+    for (int i = 0; i < colourBands; i++) {
+      for (double &weight : rows[i]) {
+        weight *= a;
+      }
+      rows[i].back() += b;
+    }
+    return *this;
+  }
+
+  /*
+   * As extract_band, with the single-channel interpretation the pipeline gives the result.
+   */
+  BandTransform &BandTransform::ExtractBand(int const band) {
+    rows = { rows[band] };
+    interpretation = Is16Bit(interpretation) ? VIPS_INTERPRETATION_GREY16 : VIPS_INTERPRETATION_B_W;
+    hasAlpha = false;
+    return *this;
+  }
+
+  BandTransform &BandTransform::RemoveAlpha() {
+    if (hasAlpha) {
+      rows.pop_back();
+      hasAlpha = false;
+    }
+    return *this;
+  }
+
+  BandTransform &BandTransform::EnsureAlpha(double const value) {
+    if (!hasAlpha) {
+      std::vector<double> row(inputBands + 1, 0.0);
+      row.back() = value * MaximumImageAlpha(interpretation);
+      rows.push_back(row);
+      hasAlpha = true;
+    }
+    return *this;
+  }
+
+  bool BandTransform::IsConstant(size_t const row) const {
+    return std::all_of(rows[row].begin(), rows[row].end() - 1, [](double weight) { return weight == 0.0; });
+  }
+
+  /*
+   * The input band a row copies unchanged, or -1 when it computes a new value.
+   */
+  int BandTransform::SelectedBand(size_t const row) const {
+    int selected = -1;
+    for (int i = 0; i <= inputBands; i++) {
+      double const weight = rows[row][i];
+      if (weight == 1.0 && i < inputBands && selected == -1) {
+        selected = i;
+      } else if (weight != 0.0) {
+        return -1;
+      }
+    }
+    return selected;
+  }
+
+  VImage BandTransform::Apply(VImage image) const {
+    // Trailing constant bands, such as an added alpha channel, are joined last
+    size_t computed = rows.size();
+    while (computed > 1 && IsConstant(computed - 1)) {
+      computed--;
+    }
+    std::vector<int> selected;
+    bool diagonal = computed == static_cast<size_t>(inputBands);
+    for (size_t row = 0; row < computed; row++) {
+      selected.push_back(SelectedBand(row));
+      for (int i = 0; i < inputBands; i++) {
+        diagonal = diagonal && (rows[row][i] == 0.0 || i == static_cast<int>(row));
+      }
+    }
+    if (std::find(selected.begin(), selected.end(), -1) == selected.end()) {
+      // Whole bands are copied, a contiguous run of them with a single extract_band
+      bool const contiguous = std::adjacent_find(selected.begin(), selected.end(),
+        [](int a, int b) { return b != a + 1; }) == selected.end();
+      if (contiguous && selected.front() == 0 && selected.size() == static_cast<size_t>(inputBands)) {
+        // Nothing to do
+      } else if (contiguous) {
+        image = image.extract_band(selected.front(), VImage::option()->set("n", static_cast<int>(selected.size())));
+      } else {
+        std::vector<VImage> bands;
+        for (int band : selected) {
+          bands.push_back(image[band]);
+        }
+        image = VImage::bandjoin(bands);
+      }
+    } else if (diagonal) {
+      // Each band is scaled and offset independently
+      std::vector<double> a;
+      std::vector<double> b;
+      for (size_t row = 0; row < computed; row++) {
+        a.push_back(rows[row][row]);
+        b.push_back(rows[row].back());
+      }
+      image = image.linear(a, b);
     } else {
-      return image.linear(a, b);
+      std::vector<double> matrix;
+      std::vector<double> offsets;
+      for (size_t row = 0; row < computed; row++) {
+        matrix.insert(matrix.end(), rows[row].begin(), rows[row].end() - 1);
+        offsets.push_back(rows[row].back());
+      }
+      image = image.recomb(VImage::new_matrix_from_array(inputBands, static_cast<int>(computed),
+        matrix.data(), static_cast<int>(matrix.size())));
+      if (std::any_of(offsets.begin(), offsets.end(), [](double offset) { return offset != 0.0; })) {
+        image = image.linear(std::vector<double>(offsets.size(), 1.0), offsets);
+      }
+    }
+    if (computed < rows.size()) {
+      std::vector<double> constants;
+      for (size_t row = computed; row < rows.size(); row++) {
+        constants.push_back(rows[row].back());
+      }
+      image = image.bandjoin_const(constants);
+    }
+    if (interpretation != inputInterpretation) {
+      image = image.copy(VImage::option()->set("interpretation", interpretation));
     }
+    return image;
   }
 
   /*
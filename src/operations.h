@@ -19,6 +19,7 @@
 #include <functional>
 #include <memory>
 #include <tuple>
+#include <vector>
 #include <vips/vips8>
 
 using vips::VImage;
@@ -59,7 +60,7 @@ namespace sharp {
    * Convolution with a kernel.
    */
   VImage Convolve(VImage image, int const width, int const height,
-    double const scale, double const offset, std::unique_ptr<double[]> const &kernel_v);
+    double const scale, double const offset, std::vector<double> const &kernel_v);
 
   /*
    * Sharpen flat and jagged areas. Use sigma of -1.0 for fast sharpen.
@@ -88,15 +89,47 @@ namespace sharp {
   VImage Trim(VImage image, double const threshold);
 
   /*
-   * Linear adjustment (a * in + b)
+   * Recomb with a Matrix of the given bands/channel size.
+   * Eg. RGB will be a 3x3 matrix.
    */
-  VImage Linear(VImage image, double const a, double const b);
+  VImage Recomb(VImage image, std::vector<double> const &matrix);
 
   /*
-   * Recomb with a Matrix of the given bands/channel size.
-   * Eg. RGB will be a 3x3 matrix.
+   * An affine transform of the bands of an image: each output band is a weighted sum of the
+   * input bands plus an offset. Consecutive recomb, linear, channel extraction and alpha
+   * removal/addition are accumulated and then applied as one operation, or two when a
+   * full matrix also needs offsets, rather than one or more each.
    */
-  VImage Recomb(VImage image, std::unique_ptr<double[]> const &matrix);
+  class BandTransform {
+   public:
+    explicit BandTransform(VImage const &image);
+
+    /*
+     * Whether Recomb can be accumulated, which needs 3 or 4 band sRGB as it would convert otherwise.
+     */
+    bool CanRecomb() const;
+    BandTransform &Recomb(std::vector<double> const &matrix);
+    BandTransform &Linear(double const a, double const b);
+    BandTransform &ExtractBand(int const band);
+    BandTransform &RemoveAlpha();
+    BandTransform &EnsureAlpha(double const value);
+
+    int Bands() const { return static_cast<int>(rows.size()); }
+    bool HasAlpha() const { return hasAlpha; }
+
+    VImage Apply(VImage image) const;
+
+   private:
+    int inputBands;
+    VipsInterpretation inputInterpretation;
+    VipsInterpretation interpretation;
+    bool hasAlpha;
+    // One row per output band: a weight for each input band, then the offset
+    std::vector<std::vector<double>> rows;
+
+    bool IsConstant(size_t const row) const;
+    int SelectedBand(size_t const row) const;
+  };
 
   /*
    * Modulate brightness, saturation, hue and lightness
@@ -13,12 +13,19 @@
 // limitations under the License.
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <cstring>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
 #include <numeric>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include <sys/types.h>
@@ -33,6 +40,7 @@
 #include "pipeline_host.h"
 #include "pipeline_sandbox.h"
 #include "rlbox_mgr.h"
+rlbox_load_structs_from_library(vips);
 
 #if defined(WIN32)
 #define STAT64_STRUCT __stat64
@@ -50,17 +58,72 @@
 
 
 static const char configs_only_reason [] = "condition only controls internal configs";
+static const char image_attrib_reason [] = "Reading attributes of the image for the first and only time.";
+
+/*
+  Build the info object describing an output from the result of its pipeline.
+*/
+static Napi::Object CreateInfo(Napi::Env env, tainted_vips<PipelineResult*> t_result) {
+  Napi::Object info = Napi::Object::New(env);
+  std::string formatString = t_result->formatOut.copy_and_verify_string([](std::string val) {
+    sharp::profile::CountBytesOut(val.size());
+    // UNSAFE --- sanity check?
+    return val;
+  });
+
+  info.Set("format", formatString);
+  info.Set("width", static_cast<uint32_t>(t_result->width.unverified_safe_because(image_attrib_reason)));
+  info.Set("height", static_cast<uint32_t>(t_result->height.unverified_safe_because(image_attrib_reason)));
+  info.Set("channels", static_cast<uint32_t>(t_result->channels.unverified_safe_because(image_attrib_reason)));
+  if (formatString == "raw") {
+    info.Set("depth", sharp::EnumNick(VIPS_TYPE_BAND_FORMAT, t_result->rawDepth.unverified_safe_because(image_attrib_reason)));
+  }
+  info.Set("premultiplied", t_result->premultiplied.unverified_safe_because(image_attrib_reason));
+  if (t_result->hasCropOffset.unverified_safe_because(configs_only_reason)) {
+    info.Set("cropOffsetLeft", static_cast<int32_t>(t_result->cropOffsetLeft.unverified_safe_because(image_attrib_reason)));
+    info.Set("cropOffsetTop", static_cast<int32_t>(t_result->cropOffsetTop.unverified_safe_because(image_attrib_reason)));
+  }
+  if (t_result->hasTrimOffset.unverified_safe_because(configs_only_reason)) {
+    info.Set("trimOffsetLeft", static_cast<int32_t>(t_result->trimOffsetLeft.unverified_safe_because(image_attrib_reason)));
+    info.Set("trimOffsetTop", static_cast<int32_t>(t_result->trimOffsetTop.unverified_safe_because(image_attrib_reason)));
+  }
+  return info;
+}
+
+/*
+  Report the point-wise operations the pipeline ran either side of the resize, if any.
+  The sandbox only describes them when the debugPlan option asks it to.
+*/
+static void LogPlan(Napi::Env env, Napi::FunctionReference const &planlog, tainted_vips<PipelineResult*> t_result) {
+  if (t_result->plan == nullptr) {
+    return;
+  }
+  std::string plan = t_result->plan.copy_and_verify_string([](std::string val) {
+    sharp::profile::CountBytesOut(val.size());
+    // Worst case, the debug output is misleading
+    return val;
+  });
+  if (!plan.empty()) {
+    planlog.Call({ Napi::String::New(env, plan) });
+  }
+}
 
 class PipelineWorker : public Napi::AsyncWorker {
  public:
   PipelineWorker(Napi::Function callback, tainted_vips<PipelineBaton*> t_baton,
-    Napi::Function debuglog, Napi::Function queueListener, rlbox_sandbox_vips* sandbox) :
+    Napi::Function debuglog, Napi::Function planlog, Napi::Function queueListener, rlbox_sandbox_vips* sandbox,
+    std::unique_ptr<sharp::SandboxArena> arena = nullptr) :
     Napi::AsyncWorker(callback),
     t_baton(t_baton),
     debuglog(Napi::Persistent(debuglog)),
+    planlog(Napi::Persistent(planlog)),
     queueListener(Napi::Persistent(queueListener)),
-    sandbox(sandbox) {}
-  ~PipelineWorker() {}
+    sandbox(sandbox),
+    arena(std::move(arena)) {}
+  ~PipelineWorker() {
+    arena.reset();
+    ReleaseVipsSandbox(sandbox);
+  }
 
   // libuv worker
   void Execute() {
@@ -83,88 +146,49 @@ class PipelineWorker : public Napi::AsyncWorker {
       warning = sharp::VipsWarningPop();
     }
 
-    std::string errString = sandbox->invoke_sandbox_function(PipelineBaton_GetErr, t_baton).copy_and_verify_string([](std::string val) {
+    // Everything needed from the baton is read through a single result struct
+    tainted_vips<PipelineResult*> t_result = sandbox->invoke_sandbox_function(PipelineBaton_GetResult, t_baton);
+
+    std::string errString = t_result->err.copy_and_verify_string([](std::string val) {
+      sharp::profile::CountBytesOut(val.size());
       // Worst case, the library says there is an error when there isn't
       return val;
     });
 
-    const char image_attrib_reason[] = "Reading attributes of the image for the first and only time.";
-
-    if (errString == std::string("")) {
-      tainted_vips<int> width = sandbox->invoke_sandbox_function(PipelineBaton_GetWidth, t_baton);
-      tainted_vips<int> height = sandbox->invoke_sandbox_function(PipelineBaton_GetHeight, t_baton);
-      if (sandbox->invoke_sandbox_function(PipelineBaton_GetTopOffsetPre, t_baton).unverified_safe_because(image_attrib_reason) != -1 &&
-            (sandbox->invoke_sandbox_function(PipelineBaton_GetWidth, t_baton).unverified_safe_because(image_attrib_reason) == -1 ||
-            sandbox->invoke_sandbox_function(PipelineBaton_GetHeight, t_baton).unverified_safe_because(image_attrib_reason) == -1))
-      {
-        width = sandbox->invoke_sandbox_function(PipelineBaton_GetWidthPre, t_baton);
-        height = sandbox->invoke_sandbox_function(PipelineBaton_GetHeightPre, t_baton);
-      }
-      if (sandbox->invoke_sandbox_function(PipelineBaton_GetTopOffsetPost, t_baton).unverified_safe_because(image_attrib_reason) != -1) {
-        width = sandbox->invoke_sandbox_function(PipelineBaton_GetWidthPost, t_baton);
-        height = sandbox->invoke_sandbox_function(PipelineBaton_GetHeightPost, t_baton);
-      }
-      // Info Object
-      Napi::Object info = Napi::Object::New(env);
-      auto formatString = sandbox->invoke_sandbox_function(PipelineBaton_GetFormatOut, t_baton)
-        .copy_and_verify_string([](std::string val) {
-          // UNSAFE --- sanity check?
-          return val;
-        });
-
-      info.Set("format", formatString.c_str());
-      info.Set("width", static_cast<uint32_t>(width.unverified_safe_because(image_attrib_reason)));
-      info.Set("height", static_cast<uint32_t>(height.unverified_safe_because(image_attrib_reason)));
-      info.Set("channels", static_cast<uint32_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetChannels, t_baton).unverified_safe_because(image_attrib_reason)));
-      if (sandbox->invoke_sandbox_function(PipelineBaton_GetFormatOut, t_baton).unverified_safe_pointer_because(4, configs_only_reason) == std::string("raw")) {
-        tainted_vips<VipsBandFormat> raw_depth = sandbox->invoke_sandbox_function(PipelineBaton_GetRawDepth, t_baton);
-        info.Set("depth", sharp::SandboxVipsEnumNick(sandbox, VIPS_TYPE_BAND_FORMAT, rlbox::sandbox_static_cast<int>(raw_depth)));
-      }
-      info.Set("premultiplied", sandbox->invoke_sandbox_function(PipelineBaton_GetPremultiplied, t_baton).unverified_safe_because(image_attrib_reason));
-      if (sandbox->invoke_sandbox_function(PipelineBaton_GetHasCropOffset, t_baton).unverified_safe_because(configs_only_reason)) {
-        info.Set("cropOffsetLeft", static_cast<int32_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetCropOffsetLeft, t_baton).unverified_safe_because(image_attrib_reason)));
-        info.Set("cropOffsetTop", static_cast<int32_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetCropOffsetTop, t_baton).unverified_safe_because(image_attrib_reason)));
-      }
-      if (sandbox->invoke_sandbox_function(PipelineBaton_GetTrimThreshold, t_baton).unverified_safe_because(configs_only_reason) > 0.0) {
-        info.Set("trimOffsetLeft", static_cast<int32_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetTrimOffsetLeft, t_baton).unverified_safe_because(image_attrib_reason)));
-        info.Set("trimOffsetTop", static_cast<int32_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetTrimOffsetTop, t_baton).unverified_safe_because(image_attrib_reason)));
-      }
+    if (errString.empty()) {
+      LogPlan(env, planlog, t_result);
+      Napi::Object info = CreateInfo(env, t_result);
 
-      uint32_t outBufferLength = static_cast<uint32_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetBufferOutLength, t_baton).unverified_safe_because(image_attrib_reason));
+      uint32_t outBufferLength = static_cast<uint32_t>(t_result->bufferOutLength.unverified_safe_because(image_attrib_reason));
       if (outBufferLength > 0) {
         // Add buffer size to info
         info.Set("size", outBufferLength);
-        tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(sandbox->invoke_sandbox_function(PipelineBaton_GetBufferOut, t_baton));
-        char* buffer_ref = t_buffer_ref.copy_and_verify_range(
-          [](std::unique_ptr<char[]> val) {
-          return val.release();
-        }, outBufferLength);
-        sandbox->free_in_sandbox(t_buffer_ref);
-
-        // Pass ownership of output data to Buffer instance
-        Napi::Buffer<char> data = Napi::Buffer<char>::New(env, buffer_ref,
-          outBufferLength, sharp::DeleteCallback);
+        // Pass ownership of output data, still in the sandbox, to Buffer instance
+        tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(t_result->bufferOut);
+        Napi::Buffer<char> data = sharp::NewBufferFromSandbox(env, sandbox, t_buffer_ref, outBufferLength);
         Callback().MakeCallback(Receiver().Value(), { env.Null(), data, info });
       } else {
         // Add file size to info
         struct STAT64_STRUCT st;
-        const char* file = sandbox->invoke_sandbox_function(PipelineBaton_GetFileOut, t_baton).UNSAFE_unverified();
-        if (STAT64_FUNCTION(file, &st) == 0) {
+        std::string file = t_result->fileOut.copy_and_verify_string([](std::string val) {
+          sharp::profile::CountBytesOut(val.size());
+          // Worst case, the size of another file is reported
+          return val;
+        });
+        if (STAT64_FUNCTION(file.c_str(), &st) == 0) {
           info.Set("size", static_cast<uint32_t>(st.st_size));
         }
         Callback().MakeCallback(Receiver().Value(), { env.Null(), info });
       }
     } else {
-      auto errString = sandbox->invoke_sandbox_function(PipelineBaton_GetErr, t_baton)
-      .copy_and_verify_string([](std::string val) {
-        // Worst case you'd get a bad error message
-        return val;
-      });
       Callback().MakeCallback(Receiver().Value(), { Napi::Error::New(env, errString.c_str()).Value() });
     }
 
-    // Delete baton
+    // Delete baton, along with any transient allocations made while building it
     sandbox->invoke_sandbox_function(DestroyPipelineBaton, t_baton);
+    if (arena) {
+      arena->Release();
+    }
 
     // Decrement processing task counter
     g_atomic_int_dec_and_test(&sharp::counterProcess);
@@ -175,386 +199,359 @@ class PipelineWorker : public Napi::AsyncWorker {
  private:
   tainted_vips<PipelineBaton*> t_baton;
   Napi::FunctionReference debuglog;
+  Napi::FunctionReference planlog;
   Napi::FunctionReference queueListener;
   rlbox_sandbox_vips* sandbox;
+  // Absent for batons cloned from a compiled pipeline, which need no transient allocations
+  std::unique_ptr<sharp::SandboxArena> arena;
 };
 
 /*
-  pipeline(options, output, callback)
+  Build a baton in the given sandbox from the options of a JavaScript Sharp instance
 */
-Napi::Value pipeline(const Napi::CallbackInfo& info) {
-  rlbox_sandbox_vips* sandbox = GetVipsSandbox();
+static tainted_vips<PipelineBaton*> CreateBaton(rlbox_sandbox_vips* sandbox, sharp::SandboxArena &arena,
+  Napi::Object options, tainted_vips<InputDescriptor*> t_input) {
+  // V8 objects are converted to a flat PipelineOptions record, filled in place in sandbox memory,
+  // from which the sandbox builds the baton struct in a single call
+  tainted_vips<PipelineOptions*> t_options = arena.Alloc<PipelineOptions>();
 
-  // V8 objects are converted to non-V8 types held in the baton struct
-  tainted_vips<PipelineBaton*> t_baton = sandbox->invoke_sandbox_function(CreatePipelineBaton);
-  Napi::Object options = info[0].As<Napi::Object>();
+  // Strings are appended to a NUL-separated table and referenced by offset
+  std::string strings;
+  auto addString = [&strings](std::string const &str) {
+    unsigned int const offset = static_cast<unsigned int>(strings.size());
+    strings.append(str);
+    strings.push_back('\0');
+    return offset;
+  };
 
   // Input
-  tainted_vips<InputDescriptor*> inputdesc = sharp::CreateInputDescriptor(sandbox, options.Get("input").As<Napi::Object>());
-  sandbox->invoke_sandbox_function(PipelineBaton_SetInput, t_baton, inputdesc);
+  t_options->input = t_input;
   // Extract image options
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTopOffsetPre, t_baton, sharp::AttrAsInt32(options, "topOffsetPre"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetLeftOffsetPre, t_baton, sharp::AttrAsInt32(options, "leftOffsetPre"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWidthPre, t_baton, sharp::AttrAsInt32(options, "widthPre"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeightPre, t_baton, sharp::AttrAsInt32(options, "heightPre"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTopOffsetPost, t_baton, sharp::AttrAsInt32(options, "topOffsetPost"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetLeftOffsetPost, t_baton, sharp::AttrAsInt32(options, "leftOffsetPost"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWidthPost, t_baton, sharp::AttrAsInt32(options, "widthPost"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeightPost, t_baton, sharp::AttrAsInt32(options, "heightPost"));
+  t_options->topOffsetPre = sharp::AttrAsInt32(options, "topOffsetPre");
+  t_options->leftOffsetPre = sharp::AttrAsInt32(options, "leftOffsetPre");
+  t_options->widthPre = sharp::AttrAsInt32(options, "widthPre");
+  t_options->heightPre = sharp::AttrAsInt32(options, "heightPre");
+  t_options->topOffsetPost = sharp::AttrAsInt32(options, "topOffsetPost");
+  t_options->leftOffsetPost = sharp::AttrAsInt32(options, "leftOffsetPost");
+  t_options->widthPost = sharp::AttrAsInt32(options, "widthPost");
+  t_options->heightPost = sharp::AttrAsInt32(options, "heightPost");
   // Output image dimensions
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWidth, t_baton, sharp::AttrAsInt32(options, "width"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeight, t_baton, sharp::AttrAsInt32(options, "height"));
+  t_options->width = sharp::AttrAsInt32(options, "width");
+  t_options->height = sharp::AttrAsInt32(options, "height");
   // Canvas option
   std::string canvas = sharp::AttrAsStr(options, "canvas");
-  if (canvas == "crop") {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetCanvas, t_baton, sharp::Canvas::CROP);
-  } else if (canvas == "embed") {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetCanvas, t_baton, sharp::Canvas::EMBED);
+  sharp::Canvas canvasVal = sharp::Canvas::CROP;
+  if (canvas == "embed") {
+    canvasVal = sharp::Canvas::EMBED;
   } else if (canvas == "max") {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetCanvas, t_baton, sharp::Canvas::MAX);
+    canvasVal = sharp::Canvas::MAX;
   } else if (canvas == "min") {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetCanvas, t_baton, sharp::Canvas::MIN);
+    canvasVal = sharp::Canvas::MIN;
   } else if (canvas == "ignore_aspect") {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetCanvas, t_baton, sharp::Canvas::IGNORE_ASPECT);
+    canvasVal = sharp::Canvas::IGNORE_ASPECT;
   }
+  t_options->canvas = static_cast<int>(canvasVal);
   // Tint chroma
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTintA, t_baton, sharp::AttrAsDouble(options, "tintA"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTintB, t_baton, sharp::AttrAsDouble(options, "tintB"));
-  // Composite
-  Napi::Array compositeArray = options.Get("composite").As<Napi::Array>();
-  for (unsigned int i = 0; i < compositeArray.Length(); i++) {
-    Napi::Object compositeObject = compositeArray.Get(i).As<Napi::Object>();
-    tainted_vips<Composite*> composite = sandbox->invoke_sandbox_function(CreateComposite);
-    sandbox->invoke_sandbox_function(Composite_SetInput, composite, sharp::CreateInputDescriptor(sandbox, compositeObject.Get("input").As<Napi::Object>()));
-    sandbox->invoke_sandbox_function(Composite_SetMode, composite, rlbox::sandbox_static_cast<VipsBlendMode>(
-      sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_BLEND_MODE, sharp::AttrAsStr(compositeObject, "blend").data())));
-    sandbox->invoke_sandbox_function(Composite_SetGravity, composite, sharp::AttrAsUint32(compositeObject, "gravity"));
-    sandbox->invoke_sandbox_function(Composite_SetLeft, composite, sharp::AttrAsInt32(compositeObject, "left"));
-    sandbox->invoke_sandbox_function(Composite_SetTop, composite, sharp::AttrAsInt32(compositeObject, "top"));
-    sandbox->invoke_sandbox_function(Composite_SetHasOffset, composite, sharp::AttrAsBool(compositeObject, "hasOffset"));
-    sandbox->invoke_sandbox_function(Composite_SetTile, composite, sharp::AttrAsBool(compositeObject, "tile"));
-    sandbox->invoke_sandbox_function(Composite_SetPremultiplied, composite, sharp::AttrAsBool(compositeObject, "premultiplied"));
-    sandbox->invoke_sandbox_function(PipelineBaton_Composite_PushBack, t_baton, composite);
-  }
+  t_options->tintA = sharp::AttrAsDouble(options, "tintA");
+  t_options->tintB = sharp::AttrAsDouble(options, "tintB");
   // Resize options
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWithoutEnlargement, t_baton, sharp::AttrAsBool(options, "withoutEnlargement"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWithoutReduction, t_baton, sharp::AttrAsBool(options, "withoutReduction"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPosition, t_baton, sharp::AttrAsInt32(options, "position"));
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "resizeBackground");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetResizeBackground, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "kernel").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetKernel, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetFastShrinkOnLoad, t_baton, sharp::AttrAsBool(options, "fastShrinkOnLoad"));
-  // Join Channel Options
-  if (options.Has("joinChannelIn")) {
-    Napi::Array joinChannelArray = options.Get("joinChannelIn").As<Napi::Array>();
-    for (unsigned int i = 0; i < joinChannelArray.Length(); i++) {
-      sandbox->invoke_sandbox_function(PipelineBaton_JoinChannelIn_PushBack, t_baton,
-        sharp::CreateInputDescriptor(sandbox, joinChannelArray.Get(i).As<Napi::Object>()));
-    }
+  t_options->withoutEnlargement = sharp::AttrAsBool(options, "withoutEnlargement");
+  t_options->withoutReduction = sharp::AttrAsBool(options, "withoutReduction");
+  t_options->position = sharp::AttrAsInt32(options, "position");
+  std::vector<double> resizeBackground = sharp::AttrAsVectorOfDouble(options, "resizeBackground");
+  for (size_t i = 0; i < 4; i++) {
+    t_options->resizeBackground[i] = i < resizeBackground.size() ? resizeBackground[i] : 0.0;
   }
+  t_options->kernel = addString(sharp::AttrAsStr(options, "kernel"));
+  t_options->fastShrinkOnLoad = sharp::AttrAsBool(options, "fastShrinkOnLoad");
+  t_options->reorderTolerance = sharp::AttrAsDouble(options, "reorderTolerance");
+  t_options->debugPlan = sharp::AttrAsBool(options, "debugPlan");
   // Operators
-  sandbox->invoke_sandbox_function(PipelineBaton_SetFlatten, t_baton, sharp::AttrAsBool(options, "flatten"));
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "flattenBackground");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetFlattenBackground, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetNegate, t_baton, sharp::AttrAsBool(options, "negate"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetNegateAlpha, t_baton, sharp::AttrAsBool(options, "negateAlpha"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetBlurSigma, t_baton, sharp::AttrAsDouble(options, "blurSigma"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetBrightness, t_baton, sharp::AttrAsDouble(options, "brightness"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSaturation, t_baton, sharp::AttrAsDouble(options, "saturation"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHue, t_baton, sharp::AttrAsInt32(options, "hue"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetLightness, t_baton, sharp::AttrAsDouble(options, "lightness"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetMedianSize, t_baton, sharp::AttrAsUint32(options, "medianSize"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSharpenSigma, t_baton, sharp::AttrAsDouble(options, "sharpenSigma"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSharpenM1, t_baton, sharp::AttrAsDouble(options, "sharpenM1"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSharpenM2, t_baton, sharp::AttrAsDouble(options, "sharpenM2"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSharpenX1, t_baton, sharp::AttrAsDouble(options, "sharpenX1"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSharpenY2, t_baton, sharp::AttrAsDouble(options, "sharpenY2"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetSharpenY3, t_baton, sharp::AttrAsDouble(options, "sharpenY3"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetThreshold, t_baton, sharp::AttrAsInt32(options, "threshold"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetThresholdGrayscale, t_baton, sharp::AttrAsBool(options, "thresholdGrayscale"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTrimThreshold, t_baton, sharp::AttrAsDouble(options, "trimThreshold"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetGamma, t_baton, sharp::AttrAsDouble(options, "gamma"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetGammaOut, t_baton, sharp::AttrAsDouble(options, "gammaOut"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetLinearA, t_baton, sharp::AttrAsDouble(options, "linearA"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetLinearB, t_baton, sharp::AttrAsDouble(options, "linearB"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetGreyscale, t_baton, sharp::AttrAsBool(options, "greyscale"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetNormalise, t_baton, sharp::AttrAsBool(options, "normalise"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetClaheWidth, t_baton, sharp::AttrAsUint32(options, "claheWidth"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetClaheHeight, t_baton, sharp::AttrAsUint32(options, "claheHeight"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetClaheMaxSlope, t_baton, sharp::AttrAsUint32(options, "claheMaxSlope"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetUseExifOrientation, t_baton, sharp::AttrAsBool(options, "useExifOrientation"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetAngle, t_baton, sharp::AttrAsInt32(options, "angle"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetRotationAngle, t_baton, sharp::AttrAsDouble(options, "rotationAngle"));
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "rotationBackground");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetRotationBackground, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetRotateBeforePreExtract, t_baton, sharp::AttrAsBool(options, "rotateBeforePreExtract"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetFlip, t_baton, sharp::AttrAsBool(options, "flip"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetFlop, t_baton, sharp::AttrAsBool(options, "flop"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetExtendTop, t_baton, sharp::AttrAsInt32(options, "extendTop"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetExtendBottom, t_baton, sharp::AttrAsInt32(options, "extendBottom"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetExtendLeft, t_baton, sharp::AttrAsInt32(options, "extendLeft"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetExtendRight, t_baton, sharp::AttrAsInt32(options, "extendRight"));
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "extendBackground");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetExtendBackground, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetExtractChannel, t_baton, sharp::AttrAsInt32(options, "extractChannel"));
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "affineMatrix");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetAffineMatrix, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "affineBackground");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetAffineBackground, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetAffineIdx, t_baton, sharp::AttrAsDouble(options, "affineIdx"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetAffineIdy, t_baton, sharp::AttrAsDouble(options, "affineIdy"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetAffineOdx, t_baton, sharp::AttrAsDouble(options, "affineOdx"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetAffineOdy, t_baton, sharp::AttrAsDouble(options, "affineOdy"));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "affineInterpolator").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetAffineInterpolator, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetRemoveAlpha, t_baton, sharp::AttrAsBool(options, "removeAlpha"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetEnsureAlpha, t_baton, sharp::AttrAsDouble(options, "ensureAlpha"));
+  t_options->flatten = sharp::AttrAsBool(options, "flatten");
+  std::vector<double> flattenBackground = sharp::AttrAsVectorOfDouble(options, "flattenBackground");
+  for (size_t i = 0; i < 3; i++) {
+    t_options->flattenBackground[i] = i < flattenBackground.size() ? flattenBackground[i] : 0.0;
+  }
+  t_options->negate = sharp::AttrAsBool(options, "negate");
+  t_options->negateAlpha = sharp::AttrAsBool(options, "negateAlpha");
+  t_options->blurSigma = sharp::AttrAsDouble(options, "blurSigma");
+  t_options->brightness = sharp::AttrAsDouble(options, "brightness");
+  t_options->saturation = sharp::AttrAsDouble(options, "saturation");
+  t_options->hue = sharp::AttrAsInt32(options, "hue");
+  t_options->lightness = sharp::AttrAsDouble(options, "lightness");
+  t_options->medianSize = sharp::AttrAsUint32(options, "medianSize");
+  t_options->sharpenSigma = sharp::AttrAsDouble(options, "sharpenSigma");
+  t_options->sharpenM1 = sharp::AttrAsDouble(options, "sharpenM1");
+  t_options->sharpenM2 = sharp::AttrAsDouble(options, "sharpenM2");
+  t_options->sharpenX1 = sharp::AttrAsDouble(options, "sharpenX1");
+  t_options->sharpenY2 = sharp::AttrAsDouble(options, "sharpenY2");
+  t_options->sharpenY3 = sharp::AttrAsDouble(options, "sharpenY3");
+  t_options->threshold = sharp::AttrAsInt32(options, "threshold");
+  t_options->thresholdGrayscale = sharp::AttrAsBool(options, "thresholdGrayscale");
+  t_options->trimThreshold = sharp::AttrAsDouble(options, "trimThreshold");
+  t_options->gamma = sharp::AttrAsDouble(options, "gamma");
+  t_options->gammaOut = sharp::AttrAsDouble(options, "gammaOut");
+  t_options->linearA = sharp::AttrAsDouble(options, "linearA");
+  t_options->linearB = sharp::AttrAsDouble(options, "linearB");
+  t_options->greyscale = sharp::AttrAsBool(options, "greyscale");
+  t_options->normalise = sharp::AttrAsBool(options, "normalise");
+  t_options->claheWidth = sharp::AttrAsUint32(options, "claheWidth");
+  t_options->claheHeight = sharp::AttrAsUint32(options, "claheHeight");
+  t_options->claheMaxSlope = sharp::AttrAsUint32(options, "claheMaxSlope");
+  t_options->useExifOrientation = sharp::AttrAsBool(options, "useExifOrientation");
+  t_options->angle = sharp::AttrAsInt32(options, "angle");
+  t_options->rotationAngle = sharp::AttrAsDouble(options, "rotationAngle");
+  std::vector<double> rotationBackground = sharp::AttrAsVectorOfDouble(options, "rotationBackground");
+  for (size_t i = 0; i < 4; i++) {
+    t_options->rotationBackground[i] = i < rotationBackground.size() ? rotationBackground[i] : 0.0;
+  }
+  t_options->rotateBeforePreExtract = sharp::AttrAsBool(options, "rotateBeforePreExtract");
+  t_options->flip = sharp::AttrAsBool(options, "flip");
+  t_options->flop = sharp::AttrAsBool(options, "flop");
+  t_options->extendTop = sharp::AttrAsInt32(options, "extendTop");
+  t_options->extendBottom = sharp::AttrAsInt32(options, "extendBottom");
+  t_options->extendLeft = sharp::AttrAsInt32(options, "extendLeft");
+  t_options->extendRight = sharp::AttrAsInt32(options, "extendRight");
+  std::vector<double> extendBackground = sharp::AttrAsVectorOfDouble(options, "extendBackground");
+  for (size_t i = 0; i < 4; i++) {
+    t_options->extendBackground[i] = i < extendBackground.size() ? extendBackground[i] : 0.0;
+  }
+  t_options->extractChannel = sharp::AttrAsInt32(options, "extractChannel");
+  std::vector<double> affineMatrix = sharp::AttrAsVectorOfDouble(options, "affineMatrix");
+  t_options->affineMatrixSize = static_cast<unsigned int>(std::min(affineMatrix.size(), static_cast<size_t>(4)));
+  for (size_t i = 0; i < 4; i++) {
+    t_options->affineMatrix[i] = i < affineMatrix.size() ? affineMatrix[i] : 0.0;
+  }
+  std::vector<double> affineBackground = sharp::AttrAsVectorOfDouble(options, "affineBackground");
+  for (size_t i = 0; i < 4; i++) {
+    t_options->affineBackground[i] = i < affineBackground.size() ? affineBackground[i] : 0.0;
+  }
+  t_options->affineIdx = sharp::AttrAsDouble(options, "affineIdx");
+  t_options->affineIdy = sharp::AttrAsDouble(options, "affineIdy");
+  t_options->affineOdx = sharp::AttrAsDouble(options, "affineOdx");
+  t_options->affineOdy = sharp::AttrAsDouble(options, "affineOdy");
+  t_options->affineInterpolator = addString(sharp::AttrAsStr(options, "affineInterpolator"));
+  t_options->removeAlpha = sharp::AttrAsBool(options, "removeAlpha");
+  t_options->ensureAlpha = sharp::AttrAsDouble(options, "ensureAlpha");
+  t_options->boolean = nullptr;
+  t_options->booleanOp = static_cast<int>(VIPS_OPERATION_BOOLEAN_LAST);
   if (options.Has("boolean")) {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetBoolean, t_baton, sharp::CreateInputDescriptor(sandbox, options.Get("boolean").As<Napi::Object>()));
-    sandbox->invoke_sandbox_function(PipelineBaton_SetBooleanOp, t_baton, sharp::GetBooleanOperation(sharp::AttrAsStr(options, "booleanOp")));
+    t_options->boolean = sharp::CreateInputDescriptor(sandbox, options.Get("boolean").As<Napi::Object>());
+    t_options->booleanOp = static_cast<int>(sharp::GetBooleanOperation(sharp::AttrAsStr(options, "booleanOp")));
   }
+  t_options->bandBoolOp = static_cast<int>(VIPS_OPERATION_BOOLEAN_LAST);
   if (options.Has("bandBoolOp")) {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetBandBoolOp, t_baton, sharp::GetBooleanOperation(sharp::AttrAsStr(options, "bandBoolOp")));
+    t_options->bandBoolOp = static_cast<int>(sharp::GetBooleanOperation(sharp::AttrAsStr(options, "bandBoolOp")));
   }
+  std::vector<double> convKernel;
+  t_options->convKernelWidth = 0;
+  t_options->convKernelHeight = 0;
+  t_options->convKernelScale = 0.0;
+  t_options->convKernelOffset = 0.0;
   if (options.Has("convKernel")) {
     Napi::Object kernel = options.Get("convKernel").As<Napi::Object>();
-    sandbox->invoke_sandbox_function(PipelineBaton_SetConvKernelWidth, t_baton, sharp::AttrAsUint32(kernel, "width"));
-    sandbox->invoke_sandbox_function(PipelineBaton_SetConvKernelHeight, t_baton, sharp::AttrAsUint32(kernel, "height"));
-    sandbox->invoke_sandbox_function(PipelineBaton_SetConvKernelScale, t_baton, sharp::AttrAsDouble(kernel, "scale"));
-    sandbox->invoke_sandbox_function(PipelineBaton_SetConvKernelOffset, t_baton, sharp::AttrAsDouble(kernel, "offset"));
-    tainted_vips<size_t> kernelSize = rlbox::sandbox_static_cast<size_t>(sandbox->invoke_sandbox_function(PipelineBaton_GetConvKernelWidth, t_baton) * sandbox->invoke_sandbox_function(PipelineBaton_GetConvKernelHeight, t_baton));
-    sandbox->invoke_sandbox_function(PipelineBaton_SetConvKernelSize, t_baton, kernelSize);
+    uint32_t const kernelWidth = sharp::AttrAsUint32(kernel, "width");
+    uint32_t const kernelHeight = sharp::AttrAsUint32(kernel, "height");
+    t_options->convKernelWidth = kernelWidth;
+    t_options->convKernelHeight = kernelHeight;
+    t_options->convKernelScale = sharp::AttrAsDouble(kernel, "scale");
+    t_options->convKernelOffset = sharp::AttrAsDouble(kernel, "offset");
     Napi::Array kdata = kernel.Get("kernel").As<Napi::Array>();
-    for (unsigned int i = 0; i < kernelSize.unverified_safe_because("worst case infinite loop"); i++) {
-      sandbox->invoke_sandbox_function(PipelineBaton_GetConvKernel, t_baton)[i] = sharp::AttrAsDouble(kdata, i);
+    convKernel.resize(kernelWidth * kernelHeight);
+    for (unsigned int i = 0; i < convKernel.size(); i++) {
+      convKernel[i] = sharp::AttrAsDouble(kdata, i);
     }
   }
+  t_options->hasRecombMatrix = options.Has("recombMatrix");
   if (options.Has("recombMatrix")) {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetRecombMatrixSize, t_baton, 9);
     Napi::Array recombMatrix = options.Get("recombMatrix").As<Napi::Array>();
     for (unsigned int i = 0; i < 9; i++) {
-      sandbox->invoke_sandbox_function(PipelineBaton_GetRecombMatrix, t_baton)[i] = sharp::AttrAsDouble(recombMatrix, i);
+      t_options->recombMatrix[i] = sharp::AttrAsDouble(recombMatrix, i);
     }
   }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetColourspaceInput, t_baton, sharp::GetInterpretation(sharp::AttrAsStr(options, "colourspaceInput")));
-  if (sandbox->invoke_sandbox_function(PipelineBaton_GetColourspaceInput, t_baton).unverified_safe_because("error checking") == VIPS_INTERPRETATION_ERROR) {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetColourspaceInput, t_baton, VIPS_INTERPRETATION_LAST);
+  VipsInterpretation colourspaceInput = sharp::GetInterpretation(sharp::AttrAsStr(options, "colourspaceInput"));
+  if (colourspaceInput == VIPS_INTERPRETATION_ERROR) {
+    colourspaceInput = VIPS_INTERPRETATION_LAST;
   }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetColourspace, t_baton, sharp::GetInterpretation(sharp::AttrAsStr(options, "colourspace")));
-  if (sandbox->invoke_sandbox_function(PipelineBaton_GetColourspace, t_baton).unverified_safe_because("error checking") == VIPS_INTERPRETATION_ERROR) {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetColourspace, t_baton, VIPS_INTERPRETATION_sRGB);
+  t_options->colourspaceInput = static_cast<int>(colourspaceInput);
+  VipsInterpretation colourspace = sharp::GetInterpretation(sharp::AttrAsStr(options, "colourspace"));
+  if (colourspace == VIPS_INTERPRETATION_ERROR) {
+    colourspace = VIPS_INTERPRETATION_sRGB;
   }
+  t_options->colourspace = static_cast<int>(colourspace);
+  t_options->reduceEarly = sharp::AttrAsBool(options, "reduceEarly");
   // Output
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "formatOut").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetFormatOut, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "fileOut").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetFileOut, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWithMetadata, t_baton, sharp::AttrAsBool(options, "withMetadata"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWithMetadataOrientation, t_baton, sharp::AttrAsUint32(options, "withMetadataOrientation"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWithMetadataDensity, t_baton, sharp::AttrAsDouble(options, "withMetadataDensity"));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "withMetadataIcc").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetWithMetadataIcc, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
+  t_options->formatOut = addString(sharp::AttrAsStr(options, "formatOut"));
+  t_options->fileOut = addString(sharp::AttrAsStr(options, "fileOut"));
+  t_options->withMetadata = sharp::AttrAsBool(options, "withMetadata");
+  t_options->withMetadataOrientation = sharp::AttrAsUint32(options, "withMetadataOrientation");
+  double const withMetadataDensity = sharp::AttrAsDouble(options, "withMetadataDensity");
+  t_options->withMetadataDensity = withMetadataDensity;
+  t_options->withMetadataIcc = addString(sharp::AttrAsStr(options, "withMetadataIcc"));
   Napi::Object mdStrs = options.Get("withMetadataStrs").As<Napi::Object>();
   Napi::Array mdStrKeys = mdStrs.GetPropertyNames();
+  t_options->withMetadataStrs = static_cast<unsigned int>(strings.size());
+  t_options->withMetadataStrsCount = mdStrKeys.Length();
   for (unsigned int i = 0; i < mdStrKeys.Length(); i++) {
     std::string k = sharp::AttrAsStr(mdStrKeys, i);
-    std::string v = sharp::AttrAsStr(mdStrs, k);
-    auto t_k = sharp::CopyStringToSandbox(sandbox, k.c_str());
-    auto t_v = sharp::CopyStringToSandbox(sandbox, v.c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_WithMetadataStrs_Insert, t_baton, t_k, t_v);
-    sandbox->free_in_sandbox(t_k);
-    sandbox->free_in_sandbox(t_v);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTimeoutSeconds, t_baton, sharp::AttrAsUint32(options, "timeoutSeconds"));
+    addString(k);
+    addString(sharp::AttrAsStr(mdStrs, k));
+  }
+  t_options->timeoutSeconds = sharp::AttrAsUint32(options, "timeoutSeconds");
   // Format-specific
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegQuality, t_baton, sharp::AttrAsUint32(options, "jpegQuality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegProgressive, t_baton, sharp::AttrAsBool(options, "jpegProgressive"));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "jpegChromaSubsampling").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetJpegChromaSubsampling, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegTrellisQuantisation, t_baton, sharp::AttrAsBool(options, "jpegTrellisQuantisation"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegQuantisationTable, t_baton, sharp::AttrAsUint32(options, "jpegQuantisationTable"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegOvershootDeringing, t_baton, sharp::AttrAsBool(options, "jpegOvershootDeringing"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegOptimiseScans, t_baton, sharp::AttrAsBool(options, "jpegOptimiseScans"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJpegOptimiseCoding, t_baton, sharp::AttrAsBool(options, "jpegOptimiseCoding"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngProgressive, t_baton, sharp::AttrAsBool(options, "pngProgressive"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngCompressionLevel, t_baton, sharp::AttrAsUint32(options, "pngCompressionLevel"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngAdaptiveFiltering, t_baton, sharp::AttrAsBool(options, "pngAdaptiveFiltering"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngPalette, t_baton, sharp::AttrAsBool(options, "pngPalette"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngQuality, t_baton, sharp::AttrAsUint32(options, "pngQuality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngEffort, t_baton, sharp::AttrAsUint32(options, "pngEffort"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngBitdepth, t_baton, sharp::AttrAsUint32(options, "pngBitdepth"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetPngDither, t_baton, sharp::AttrAsDouble(options, "pngDither"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJp2Quality, t_baton, sharp::AttrAsUint32(options, "jp2Quality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJp2Lossless, t_baton, sharp::AttrAsBool(options, "jp2Lossless"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJp2TileHeight, t_baton, sharp::AttrAsUint32(options, "jp2TileHeight"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetJp2TileWidth, t_baton, sharp::AttrAsUint32(options, "jp2TileWidth"));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "jp2ChromaSubsampling").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetJp2ChromaSubsampling, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWebpQuality, t_baton, sharp::AttrAsUint32(options, "webpQuality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWebpAlphaQuality, t_baton, sharp::AttrAsUint32(options, "webpAlphaQuality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWebpLossless, t_baton, sharp::AttrAsBool(options, "webpLossless"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWebpNearLossless, t_baton, sharp::AttrAsBool(options, "webpNearLossless"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWebpSmartSubsample, t_baton, sharp::AttrAsBool(options, "webpSmartSubsample"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetWebpEffort, t_baton, sharp::AttrAsUint32(options, "webpEffort"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetGifBitdepth, t_baton, sharp::AttrAsUint32(options, "gifBitdepth"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetGifEffort, t_baton, sharp::AttrAsUint32(options, "gifEffort"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetGifDither, t_baton, sharp::AttrAsDouble(options, "gifDither"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffQuality, t_baton, sharp::AttrAsUint32(options, "tiffQuality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffPyramid, t_baton, sharp::AttrAsBool(options, "tiffPyramid"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffBitdepth, t_baton, sharp::AttrAsUint32(options, "tiffBitdepth"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffTile, t_baton, sharp::AttrAsBool(options, "tiffTile"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffTileWidth, t_baton, sharp::AttrAsUint32(options, "tiffTileWidth"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffTileHeight, t_baton, sharp::AttrAsUint32(options, "tiffTileHeight"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffXres, t_baton, sharp::AttrAsDouble(options, "tiffXres"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffYres, t_baton, sharp::AttrAsDouble(options, "tiffYres"));
-
-  if (sandbox->invoke_sandbox_function(PipelineBaton_GetTiffXres, t_baton).unverified_safe_because(configs_only_reason) == 1.0 &&
-    sandbox->invoke_sandbox_function(PipelineBaton_GetTiffYres, t_baton).unverified_safe_because(configs_only_reason) == 1.0 &&
-    sandbox->invoke_sandbox_function(PipelineBaton_GetWithMetadataDensity, t_baton).unverified_safe_because(configs_only_reason) > 0)
-  {
-    auto val = sandbox->invoke_sandbox_function(PipelineBaton_GetWithMetadataDensity, t_baton) / 25.4;
-    sandbox->invoke_sandbox_function(PipelineBaton_SetTiffXres, t_baton, val);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetTiffYres, t_baton, val);
+  t_options->jpegQuality = sharp::AttrAsUint32(options, "jpegQuality");
+  t_options->jpegProgressive = sharp::AttrAsBool(options, "jpegProgressive");
+  t_options->jpegChromaSubsampling = addString(sharp::AttrAsStr(options, "jpegChromaSubsampling"));
+  t_options->jpegTrellisQuantisation = sharp::AttrAsBool(options, "jpegTrellisQuantisation");
+  t_options->jpegQuantisationTable = sharp::AttrAsUint32(options, "jpegQuantisationTable");
+  t_options->jpegOvershootDeringing = sharp::AttrAsBool(options, "jpegOvershootDeringing");
+  t_options->jpegOptimiseScans = sharp::AttrAsBool(options, "jpegOptimiseScans");
+  t_options->jpegOptimiseCoding = sharp::AttrAsBool(options, "jpegOptimiseCoding");
+  t_options->pngProgressive = sharp::AttrAsBool(options, "pngProgressive");
+  t_options->pngCompressionLevel = sharp::AttrAsUint32(options, "pngCompressionLevel");
+  t_options->pngAdaptiveFiltering = sharp::AttrAsBool(options, "pngAdaptiveFiltering");
+  t_options->pngPalette = sharp::AttrAsBool(options, "pngPalette");
+  t_options->pngQuality = sharp::AttrAsUint32(options, "pngQuality");
+  t_options->pngEffort = sharp::AttrAsUint32(options, "pngEffort");
+  t_options->pngBitdepth = sharp::AttrAsUint32(options, "pngBitdepth");
+  t_options->pngDither = sharp::AttrAsDouble(options, "pngDither");
+  t_options->jp2Quality = sharp::AttrAsUint32(options, "jp2Quality");
+  t_options->jp2Lossless = sharp::AttrAsBool(options, "jp2Lossless");
+  t_options->jp2TileHeight = sharp::AttrAsUint32(options, "jp2TileHeight");
+  t_options->jp2TileWidth = sharp::AttrAsUint32(options, "jp2TileWidth");
+  t_options->jp2ChromaSubsampling = addString(sharp::AttrAsStr(options, "jp2ChromaSubsampling"));
+  t_options->webpQuality = sharp::AttrAsUint32(options, "webpQuality");
+  t_options->webpAlphaQuality = sharp::AttrAsUint32(options, "webpAlphaQuality");
+  t_options->webpLossless = sharp::AttrAsBool(options, "webpLossless");
+  t_options->webpNearLossless = sharp::AttrAsBool(options, "webpNearLossless");
+  t_options->webpSmartSubsample = sharp::AttrAsBool(options, "webpSmartSubsample");
+  t_options->webpEffort = sharp::AttrAsUint32(options, "webpEffort");
+  t_options->gifBitdepth = sharp::AttrAsUint32(options, "gifBitdepth");
+  t_options->gifEffort = sharp::AttrAsUint32(options, "gifEffort");
+  t_options->gifDither = sharp::AttrAsDouble(options, "gifDither");
+  t_options->tiffQuality = sharp::AttrAsUint32(options, "tiffQuality");
+  t_options->tiffPyramid = sharp::AttrAsBool(options, "tiffPyramid");
+  t_options->tiffBitdepth = sharp::AttrAsUint32(options, "tiffBitdepth");
+  t_options->tiffTile = sharp::AttrAsBool(options, "tiffTile");
+  t_options->tiffTileWidth = sharp::AttrAsUint32(options, "tiffTileWidth");
+  t_options->tiffTileHeight = sharp::AttrAsUint32(options, "tiffTileHeight");
+  double tiffXres = sharp::AttrAsDouble(options, "tiffXres");
+  double tiffYres = sharp::AttrAsDouble(options, "tiffYres");
+  if (tiffXres == 1.0 && tiffYres == 1.0 && withMetadataDensity > 0) {
+    tiffXres = tiffYres = withMetadataDensity / 25.4;
   }
+  t_options->tiffXres = tiffXres;
+  t_options->tiffYres = tiffYres;
   // tiff compression options
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffCompression, t_baton, rlbox::sandbox_static_cast<VipsForeignTiffCompression>(
-  sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_TIFF_COMPRESSION,
-    sharp::AttrAsStr(options, "tiffCompression").data())));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffPredictor, t_baton, rlbox::sandbox_static_cast<VipsForeignTiffPredictor>(
-  sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_TIFF_PREDICTOR,
-    sharp::AttrAsStr(options, "tiffPredictor").data())));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTiffResolutionUnit, t_baton, rlbox::sandbox_static_cast<VipsForeignTiffResunit>(
-  sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_TIFF_RESUNIT,
-    sharp::AttrAsStr(options, "tiffResolutionUnit").data())));
-
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeifQuality, t_baton, sharp::AttrAsUint32(options, "heifQuality"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeifLossless, t_baton, sharp::AttrAsBool(options, "heifLossless"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeifCompression, t_baton, rlbox::sandbox_static_cast<VipsForeignHeifCompression>(
-    sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_HEIF_COMPRESSION,
-    sharp::AttrAsStr(options, "heifCompression").data())));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetHeifEffort, t_baton, sharp::AttrAsUint32(options, "heifEffort"));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "heifChromaSubsampling").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetHeifChromaSubsampling, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
+  t_options->tiffCompression = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_TIFF_COMPRESSION,
+    sharp::AttrAsStr(options, "tiffCompression"));
+  t_options->tiffPredictor = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_TIFF_PREDICTOR,
+    sharp::AttrAsStr(options, "tiffPredictor"));
+  t_options->tiffResolutionUnit = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_TIFF_RESUNIT,
+    sharp::AttrAsStr(options, "tiffResolutionUnit"));
+  t_options->heifQuality = sharp::AttrAsUint32(options, "heifQuality");
+  t_options->heifLossless = sharp::AttrAsBool(options, "heifLossless");
+  t_options->heifCompression = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_HEIF_COMPRESSION,
+    sharp::AttrAsStr(options, "heifCompression"));
+  t_options->heifEffort = sharp::AttrAsUint32(options, "heifEffort");
+  t_options->heifChromaSubsampling = addString(sharp::AttrAsStr(options, "heifChromaSubsampling"));
   // Raw output
-  sandbox->invoke_sandbox_function(PipelineBaton_SetRawDepth, t_baton, rlbox::sandbox_static_cast<VipsBandFormat>(
-    sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_BAND_FORMAT,
-    sharp::AttrAsStr(options, "rawDepth").data())));
+  t_options->rawDepth = sharp::EnumFromNick(VIPS_TYPE_BAND_FORMAT,
+    sharp::AttrAsStr(options, "rawDepth"));
   // Animated output properties
-  if (sharp::HasAttr(options, "loop")) {
-    sandbox->invoke_sandbox_function(PipelineBaton_SetLoop, t_baton, sharp::AttrAsUint32(options, "loop"));
+  t_options->loop = sharp::HasAttr(options, "loop") ? static_cast<int>(sharp::AttrAsUint32(options, "loop")) : -1;
+  // Tile output
+  t_options->tileSize = sharp::AttrAsUint32(options, "tileSize");
+  t_options->tileOverlap = sharp::AttrAsUint32(options, "tileOverlap");
+  t_options->tileAngle = sharp::AttrAsInt32(options, "tileAngle");
+  std::vector<double> tileBackground = sharp::AttrAsVectorOfDouble(options, "tileBackground");
+  for (size_t i = 0; i < 4; i++) {
+    t_options->tileBackground[i] = i < tileBackground.size() ? tileBackground[i] : 0.0;
+  }
+  t_options->tileSkipBlanks = sharp::AttrAsInt32(options, "tileSkipBlanks");
+  t_options->tileContainer = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_DZ_CONTAINER,
+    sharp::AttrAsStr(options, "tileContainer"));
+  t_options->tileLayout = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_DZ_LAYOUT,
+    sharp::AttrAsStr(options, "tileLayout"));
+  t_options->tileFormat = addString(sharp::AttrAsStr(options, "tileFormat"));
+  t_options->tileDepth = sharp::EnumFromNick(VIPS_TYPE_FOREIGN_DZ_DEPTH,
+    sharp::AttrAsStr(options, "tileDepth"));
+  t_options->tileCentre = sharp::AttrAsBool(options, "tileCentre");
+  t_options->tileId = addString(sharp::AttrAsStr(options, "tileId"));
+
+  // Copy the string table into the sandbox in one go
+  tainted_vips<char*> t_strings = arena.Alloc<char>(strings.size());
+  memcpy(t_strings.unverified_safe_pointer_because(strings.size(), "String table copy"), strings.data(), strings.size());
+  sharp::profile::CountBytesIn(strings.size());
+
+  // Build the baton, this also forces random access for operations that require it
+  tainted_vips<PipelineBaton*> t_baton = sandbox->invoke_sandbox_function(CreatePipelineBaton,
+    t_options, rlbox::sandbox_const_cast<const char*>(t_strings));
+
+  // Variable-length options
+  if (!convKernel.empty()) {
+    auto t_vec = sharp::CopyVectorToSandbox(arena, convKernel);
+    sandbox->invoke_sandbox_function(PipelineBaton_SetConvKernel, t_baton, t_vec, convKernel.size());
   }
   if (sharp::HasAttr(options, "delay")) {
     auto vec = sharp::AttrAsInt32Vector(options, "delay");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
+    auto t_vec = sharp::CopyVectorToSandbox(arena, vec);
     sandbox->invoke_sandbox_function(PipelineBaton_SetDelay, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
   }
-  // Tile output
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileSize, t_baton, sharp::AttrAsUint32(options, "tileSize"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileOverlap, t_baton, sharp::AttrAsUint32(options, "tileOverlap"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileAngle, t_baton, sharp::AttrAsInt32(options, "tileAngle"));
-  {
-    auto vec = sharp::AttrAsVectorOfDouble(options, "tileBackground");
-    auto t_vec = sharp::CopyVectorToSandbox(sandbox, vec);
-    sandbox->invoke_sandbox_function(PipelineBaton_SetTileBackground, t_baton, t_vec, vec.size());
-    sandbox->free_in_sandbox(t_vec);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileSkipBlanks, t_baton, sharp::AttrAsInt32(options, "tileSkipBlanks"));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileContainer, t_baton, rlbox::sandbox_static_cast<VipsForeignDzContainer>(
-    sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_DZ_CONTAINER,
-    sharp::AttrAsStr(options, "tileContainer").data())));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileLayout, t_baton, rlbox::sandbox_static_cast<VipsForeignDzLayout>(
-    sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_DZ_LAYOUT,
-    sharp::AttrAsStr(options, "tileLayout").data())));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "tileFormat").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetTileFormat, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileDepth, t_baton, rlbox::sandbox_static_cast<VipsForeignDzDepth>(
-    sharp::SandboxVipsEnumFromNick(sandbox, nullptr, VIPS_TYPE_FOREIGN_DZ_DEPTH,
-    sharp::AttrAsStr(options, "tileDepth").data())));
-  sandbox->invoke_sandbox_function(PipelineBaton_SetTileCentre, t_baton, sharp::AttrAsBool(options, "tileCentre"));
-  {
-    auto sbxString = sharp::CopyStringToSandbox(sandbox, sharp::AttrAsStr(options, "tileId").c_str());
-    sandbox->invoke_sandbox_function(PipelineBaton_SetTileId, t_baton, sbxString);
-    sandbox->free_in_sandbox(sbxString);
-  }
-
-  // Force random access for certain operations
-  tainted_vips<InputDescriptor*> input = sandbox->invoke_sandbox_function(PipelineBaton_GetInput, t_baton);
-  if (sandbox->invoke_sandbox_function(InputDescriptor_GetAccess, input).unverified_safe_because(configs_only_reason) == VIPS_ACCESS_SEQUENTIAL) {
-    if (
-      sandbox->invoke_sandbox_function(PipelineBaton_GetTrimThreshold, t_baton).unverified_safe_because(configs_only_reason) > 0.0 ||
-      sandbox->invoke_sandbox_function(PipelineBaton_GetNormalise, t_baton).unverified_safe_because(configs_only_reason) ||
-      sandbox->invoke_sandbox_function(PipelineBaton_GetPosition, t_baton).unverified_safe_because(configs_only_reason) == 16 || sandbox->invoke_sandbox_function(PipelineBaton_GetPosition, t_baton).unverified_safe_because(configs_only_reason) == 17 ||
-      sandbox->invoke_sandbox_function(PipelineBaton_GetAngle, t_baton).unverified_safe_because(configs_only_reason) % 360 != 0 ||
-      fmod(sandbox->invoke_sandbox_function(PipelineBaton_GetRotationAngle, t_baton).unverified_safe_because(configs_only_reason), 360.0) != 0.0 ||
-      sandbox->invoke_sandbox_function(PipelineBaton_GetUseExifOrientation, t_baton).unverified_safe_because(configs_only_reason)
-    ) {
-      sandbox->invoke_sandbox_function(InputDescriptor_SetAccess, input, VIPS_ACCESS_RANDOM);
+  // Composite
+  Napi::Array compositeArray = options.Get("composite").As<Napi::Array>();
+  for (unsigned int i = 0; i < compositeArray.Length(); i++) {
+    Napi::Object compositeObject = compositeArray.Get(i).As<Napi::Object>();
+    tainted_vips<Composite*> composite = sandbox->invoke_sandbox_function(CreateComposite);
+    sandbox->invoke_sandbox_function(Composite_SetInput, composite, sharp::CreateInputDescriptor(sandbox, compositeObject.Get("input").As<Napi::Object>()));
+    sandbox->invoke_sandbox_function(Composite_SetMode, composite, static_cast<VipsBlendMode>(
+      sharp::EnumFromNick(VIPS_TYPE_BLEND_MODE, sharp::AttrAsStr(compositeObject, "blend"))));
+    sandbox->invoke_sandbox_function(Composite_SetGravity, composite, sharp::AttrAsUint32(compositeObject, "gravity"));
+    sandbox->invoke_sandbox_function(Composite_SetLeft, composite, sharp::AttrAsInt32(compositeObject, "left"));
+    sandbox->invoke_sandbox_function(Composite_SetTop, composite, sharp::AttrAsInt32(compositeObject, "top"));
+    sandbox->invoke_sandbox_function(Composite_SetHasOffset, composite, sharp::AttrAsBool(compositeObject, "hasOffset"));
+    sandbox->invoke_sandbox_function(Composite_SetTile, composite, sharp::AttrAsBool(compositeObject, "tile"));
+    sandbox->invoke_sandbox_function(Composite_SetPremultiplied, composite, sharp::AttrAsBool(compositeObject, "premultiplied"));
+    sandbox->invoke_sandbox_function(PipelineBaton_Composite_PushBack, t_baton, composite);
+  }
+  // Join Channel Options
+  if (options.Has("joinChannelIn")) {
+    Napi::Array joinChannelArray = options.Get("joinChannelIn").As<Napi::Array>();
+    for (unsigned int i = 0; i < joinChannelArray.Length(); i++) {
+      sandbox->invoke_sandbox_function(PipelineBaton_JoinChannelIn_PushBack, t_baton,
+        sharp::CreateInputDescriptor(sandbox, joinChannelArray.Get(i).As<Napi::Object>()));
     }
   }
 
+  return t_baton;
+}
+
+/*
+  pipeline(options, output, callback)
+*/
+Napi::Value pipeline(const Napi::CallbackInfo& info) {
+  Napi::Object options = info[0].As<Napi::Object>();
+  rlbox_sandbox_vips* sandbox = sharp::AcquireSandboxForInput(options.Get("input").As<Napi::Object>());
+
+  // Transient sandbox allocations for this request are bump-allocated and released with the baton
+  std::unique_ptr<sharp::SandboxArena> arena(new sharp::SandboxArena(sandbox));
+
+  tainted_vips<PipelineBaton*> t_baton = CreateBaton(sandbox, *arena, options,
+    sharp::CreateInputDescriptor(sandbox, options.Get("input").As<Napi::Object>()));
+
   // Function to notify of libvips warnings
   Napi::Function debuglog = options.Get("debuglog").As<Napi::Function>();
 
+  // Function to notify of the order of point-wise operations
+  Napi::Function planlog = options.Get("planlog").As<Napi::Function>();
+
   // Function to notify of queue length changes
   Napi::Function queueListener = options.Get("queueListener").As<Napi::Function>();
 
   // Join queue for worker thread
   Napi::Function callback = info[1].As<Napi::Function>();
 
-  PipelineWorker *worker = new PipelineWorker(callback, t_baton, debuglog, queueListener, sandbox);
+  PipelineWorker *worker = new PipelineWorker(callback, t_baton, debuglog, planlog, queueListener, sandbox, std::move(arena));
   worker->Receiver().Set("options", options);
   worker->Queue();
 
@@ -565,3 +562,499 @@ Napi::Value pipeline(const Napi::CallbackInfo& info) {
 
   return info.Env().Undefined();
 }
+
+class PipelineManyWorker : public Napi::AsyncWorker {
+ public:
+  PipelineManyWorker(Napi::Function callback, std::vector<tainted_vips<PipelineBaton*>> t_batons,
+    tainted_vips<PipelineBaton**> t_batons_array, Napi::Function debuglog, Napi::Function planlog,
+    Napi::Function queueListener, rlbox_sandbox_vips* sandbox, std::unique_ptr<sharp::SandboxArena> arena) :
+    Napi::AsyncWorker(callback),
+    t_batons(std::move(t_batons)),
+    t_batons_array(t_batons_array),
+    debuglog(Napi::Persistent(debuglog)),
+    planlog(Napi::Persistent(planlog)),
+    queueListener(Napi::Persistent(queueListener)),
+    sandbox(sandbox),
+    arena(std::move(arena)) {}
+  ~PipelineManyWorker() {
+    arena.reset();
+    ReleaseVipsSandbox(sandbox);
+  }
+
+  // libuv worker
+  void Execute() {
+    // Decrement queued task counter
+    g_atomic_int_dec_and_test(&sharp::counterQueue);
+    // Increment processing task counter
+    g_atomic_int_inc(&sharp::counterProcess);
+
+    tainted_vips<PipelineMany*> t_many = sandbox->invoke_sandbox_function(PipelineManyOpen,
+      t_batons_array, t_batons.size());
+    if (t_many == nullptr) {
+      return;
+    }
+    // Each sandbox call processes one output, with at most one thread per core taking them in turn
+    std::atomic<size_t> next(0);
+    auto run = [this, &t_many, &next]() {
+      for (size_t i = next++; i < t_batons.size(); i = next++) {
+        sandbox->invoke_sandbox_function(PipelineManyExecute, t_many, i);
+      }
+      sandbox->invoke_sandbox_function(PipelineThreadShutdown);
+    };
+    size_t const threads = std::max(std::min(static_cast<size_t>(std::thread::hardware_concurrency()),
+      t_batons.size()), static_cast<size_t>(1));
+    std::vector<std::thread> helpers;
+    helpers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++) {
+      helpers.emplace_back(run);
+    }
+    run();
+    for (std::thread &helper : helpers) {
+      helper.join();
+    }
+    sandbox->invoke_sandbox_function(PipelineManyClose, t_many);
+  }
+
+  void OnOK() {
+    Napi::Env env = Env();
+    Napi::HandleScope scope(env);
+
+    // Handle warnings
+    std::string warning = sharp::VipsWarningPop();
+    while (!warning.empty()) {
+      debuglog.Call({ Napi::String::New(env, warning) });
+      warning = sharp::VipsWarningPop();
+    }
+
+    // Outputs are returned in the order they were requested, the first error fails them all
+    std::string errString;
+    std::vector<tainted_vips<PipelineResult*>> t_results;
+    t_results.reserve(t_batons.size());
+    for (tainted_vips<PipelineBaton*> const &t_baton : t_batons) {
+      t_results.push_back(sandbox->invoke_sandbox_function(PipelineBaton_GetResult, t_baton));
+      if (errString.empty()) {
+        errString = t_results.back()->err.copy_and_verify_string([](std::string val) {
+          sharp::profile::CountBytesOut(val.size());
+          // Worst case, the library says there is an error when there isn't
+          return val;
+        });
+      }
+    }
+    // Every output buffer is either passed to a Buffer instance or freed
+    Napi::Array outputs = Napi::Array::New(env, t_batons.size());
+    for (size_t i = 0; i < t_results.size(); i++) {
+      tainted_vips<PipelineResult*> t_result = t_results[i];
+      tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(t_result->bufferOut);
+      if (!errString.empty()) {
+        if (t_buffer_ref != nullptr) {
+          sandbox->free_in_sandbox(t_buffer_ref);
+        }
+        continue;
+      }
+      LogPlan(env, planlog, t_result);
+      Napi::Object info = CreateInfo(env, t_result);
+      uint32_t outBufferLength = static_cast<uint32_t>(t_result->bufferOutLength.unverified_safe_because(image_attrib_reason));
+      info.Set("size", outBufferLength);
+      // Pass ownership of output data, still in the sandbox, to Buffer instance
+      Napi::Object output = Napi::Object::New(env);
+      output.Set("data", sharp::NewBufferFromSandbox(env, sandbox, t_buffer_ref, outBufferLength));
+      output.Set("info", info);
+      outputs.Set(static_cast<uint32_t>(i), output);
+    }
+    if (errString.empty()) {
+      Callback().MakeCallback(Receiver().Value(), { env.Null(), outputs });
+    } else {
+      Callback().MakeCallback(Receiver().Value(), { Napi::Error::New(env, errString.c_str()).Value() });
+    }
+
+    // Delete batons, the input descriptor is owned by the first
+    for (size_t i = 0; i < t_batons.size(); i++) {
+      if (i > 0) {
+        sandbox->invoke_sandbox_function(PipelineBaton_SetInput, t_batons[i], nullptr);
+      }
+      sandbox->invoke_sandbox_function(DestroyPipelineBaton, t_batons[i]);
+    }
+    arena->Release();
+
+    // Decrement processing task counter
+    g_atomic_int_dec_and_test(&sharp::counterProcess);
+    Napi::Number queueLength = Napi::Number::New(env, static_cast<double>(sharp::counterQueue));
+    queueListener.Call(Receiver().Value(), { queueLength });
+  }
+
+ private:
+  std::vector<tainted_vips<PipelineBaton*>> t_batons;
+  tainted_vips<PipelineBaton**> t_batons_array;
+  Napi::FunctionReference debuglog;
+  Napi::FunctionReference planlog;
+  Napi::FunctionReference queueListener;
+  rlbox_sandbox_vips* sandbox;
+  std::unique_ptr<sharp::SandboxArena> arena;
+};
+
+/*
+  pipelineMany(options[], callback)
+
+  Every element of options shares the input of the first, which is decoded once.
+*/
+Napi::Value pipelineMany(const Napi::CallbackInfo& info) {
+  Napi::Array optionsArray = info[0].As<Napi::Array>();
+  Napi::Object first = optionsArray.Get(static_cast<uint32_t>(0)).As<Napi::Object>();
+  rlbox_sandbox_vips* sandbox = sharp::AcquireSandboxForInput(first.Get("input").As<Napi::Object>());
+
+  // Transient sandbox allocations for this request are bump-allocated and released with the batons
+  std::unique_ptr<sharp::SandboxArena> arena(new sharp::SandboxArena(sandbox));
+
+  // The input is copied into the sandbox once and referenced by every baton
+  tainted_vips<InputDescriptor*> t_input = sharp::CreateInputDescriptor(sandbox, first.Get("input").As<Napi::Object>());
+  uint32_t const count = optionsArray.Length();
+  std::vector<tainted_vips<PipelineBaton*>> t_batons;
+  t_batons.reserve(count);
+  tainted_vips<PipelineBaton**> t_batons_array = arena->Alloc<PipelineBaton*>(count);
+  for (uint32_t i = 0; i < count; i++) {
+    t_batons.push_back(CreateBaton(sandbox, *arena, optionsArray.Get(i).As<Napi::Object>(), t_input));
+    t_batons_array[i] = t_batons.back();
+  }
+
+  // Function to notify of libvips warnings
+  Napi::Function debuglog = first.Get("debuglog").As<Napi::Function>();
+
+  // Function to notify of the order of point-wise operations
+  Napi::Function planlog = first.Get("planlog").As<Napi::Function>();
+
+  // Function to notify of queue length changes
+  Napi::Function queueListener = first.Get("queueListener").As<Napi::Function>();
+
+  // Join queue for worker thread
+  Napi::Function callback = info[1].As<Napi::Function>();
+
+  PipelineManyWorker *worker = new PipelineManyWorker(callback, std::move(t_batons), t_batons_array,
+    debuglog, planlog, queueListener, sandbox, std::move(arena));
+  worker->Receiver().Set("options", optionsArray);
+  worker->Queue();
+
+  // Increment queued task counter
+  g_atomic_int_inc(&sharp::counterQueue);
+  Napi::Number queueLength = Napi::Number::New(info.Env(), static_cast<double>(sharp::counterQueue));
+  queueListener.Call(info.This(), { queueLength });
+
+  return info.Env().Undefined();
+}
+
+/*
+  A pipeline compiled once from the options of a JavaScript Sharp instance.
+  The baton prototype is built on first use in each sandbox, which stays pinned until
+  the template is collected or the sandbox is retired.
+*/
+struct PipelineTemplate {
+  std::unordered_map<rlbox_sandbox_vips*, tainted_vips<PipelineBaton*>> prototypes;
+};
+
+static tainted_vips<PipelineBaton*> BuildPrototype(rlbox_sandbox_vips* sandbox, Napi::Object options) {
+  // The baton copies everything it needs out of the arena
+  sharp::SandboxArena arena(sandbox);
+  return CreateBaton(sandbox, arena, options, nullptr);
+}
+
+/*
+  Drop the prototypes held in retired sandboxes, so their pins no longer keep those sandboxes alive.
+*/
+static void DropRetiredPrototypes(PipelineTemplate *pipelineTemplate) {
+  for (auto it = pipelineTemplate->prototypes.begin(); it != pipelineTemplate->prototypes.end();) {
+    if (IsVipsSandboxRetired(it->first)) {
+      it->first->invoke_sandbox_function(DestroyPipelineBaton, it->second);
+      UnpinVipsSandbox(it->first);
+      it = pipelineTemplate->prototypes.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/*
+  Clone a baton for the given input from the prototype in the given sandbox.
+  A retired sandbox, which may still hold the input, gets a prototype for this clone alone.
+*/
+static tainted_vips<PipelineBaton*> CloneFromTemplate(PipelineTemplate *pipelineTemplate,
+  rlbox_sandbox_vips* sandbox, Napi::Object options, tainted_vips<InputDescriptor*> t_input) {
+  DropRetiredPrototypes(pipelineTemplate);
+  auto it = pipelineTemplate->prototypes.find(sandbox);
+  if (it != pipelineTemplate->prototypes.end()) {
+    return sandbox->invoke_sandbox_function(ClonePipelineBaton, it->second, t_input);
+  }
+  tainted_vips<PipelineBaton*> t_prototype = BuildPrototype(sandbox, options);
+  tainted_vips<PipelineBaton*> t_baton = sandbox->invoke_sandbox_function(ClonePipelineBaton, t_prototype, t_input);
+  if (IsVipsSandboxRetired(sandbox)) {
+    sandbox->invoke_sandbox_function(DestroyPipelineBaton, t_prototype);
+  } else {
+    PinVipsSandbox(sandbox);
+    pipelineTemplate->prototypes.emplace(sandbox, t_prototype);
+  }
+  return t_baton;
+}
+
+/*
+  compile(options)
+*/
+Napi::Value compile(const Napi::CallbackInfo& info) {
+  Napi::Object options = info[0].As<Napi::Object>();
+  PipelineTemplate *pipelineTemplate = new PipelineTemplate;
+
+  // Marshal the options once up front, further sandboxes are prepared as they are used
+  rlbox_sandbox_vips* sandbox = AcquireVipsSandbox();
+  PinVipsSandbox(sandbox);
+  pipelineTemplate->prototypes.emplace(sandbox, BuildPrototype(sandbox, options));
+  ReleaseVipsSandbox(sandbox);
+
+  return Napi::External<PipelineTemplate>::New(info.Env(), pipelineTemplate, [](Napi::Env, PipelineTemplate *pipelineTemplate) {
+    for (auto const &prototype : pipelineTemplate->prototypes) {
+      prototype.first->invoke_sandbox_function(DestroyPipelineBaton, prototype.second);
+      UnpinVipsSandbox(prototype.first);
+    }
+    delete pipelineTemplate;
+  });
+}
+
+/*
+  pipelineFromTemplate(template, options, input, callback)
+
+  The options are only read when the template has not yet been used in the chosen sandbox.
+*/
+Napi::Value pipelineFromTemplate(const Napi::CallbackInfo& info) {
+  PipelineTemplate *pipelineTemplate = info[0].As<Napi::External<PipelineTemplate>>().Data();
+  Napi::Object options = info[1].As<Napi::Object>();
+  Napi::Object input = info[2].As<Napi::Object>();
+  rlbox_sandbox_vips* sandbox = sharp::AcquireSandboxForInput(input);
+
+  // Everything but the input descriptor is copied from the prototype in a single call
+  tainted_vips<PipelineBaton*> t_baton = CloneFromTemplate(pipelineTemplate, sandbox, options,
+    sharp::CreateInputDescriptor(sandbox, input));
+
+  // Function to notify of libvips warnings
+  Napi::Function debuglog = options.Get("debuglog").As<Napi::Function>();
+
+  // Function to notify of the order of point-wise operations
+  Napi::Function planlog = options.Get("planlog").As<Napi::Function>();
+
+  // Function to notify of queue length changes
+  Napi::Function queueListener = options.Get("queueListener").As<Napi::Function>();
+
+  // Join queue for worker thread
+  Napi::Function callback = info[3].As<Napi::Function>();
+
+  PipelineWorker *worker = new PipelineWorker(callback, t_baton, debuglog, planlog, queueListener, sandbox);
+  worker->Receiver().Set("input", input);
+  worker->Queue();
+
+  // Increment queued task counter
+  g_atomic_int_inc(&sharp::counterQueue);
+  Napi::Number queueLength = Napi::Number::New(info.Env(), static_cast<double>(sharp::counterQueue));
+  queueListener.Call(info.This(), { queueLength });
+
+  return info.Env().Undefined();
+}
+
+/*
+  Inputs run through a compiled template by a pool of native threads, within one asynchronous operation.
+  Each input is prepared on the JavaScript thread, leasing the sandbox best suited to it, only while
+  fewer than one per thread are in flight and the consumer of the results is keeping up.
+  Each result is delivered to JavaScript through a thread-safe function as soon as it is ready,
+  and the batch is finalised once every thread has finished and every result has been delivered.
+*/
+struct PipelineBatch {
+  struct Item {
+    rlbox_sandbox_vips* sandbox;
+    tainted_vips<PipelineBaton*> t_baton;
+    uint32_t index;
+  };
+  // Only accessed from the JavaScript thread
+  uint32_t count;
+  uint32_t prepared;
+  size_t inFlight;
+  size_t window;
+  bool paused;
+  // Prepared items waiting for a thread, exhausted once no more will be prepared
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<Item> queue;
+  bool exhausted;
+  std::vector<std::thread> threads;
+  Napi::ThreadSafeFunction onResult;
+  Napi::FunctionReference onDone;
+  Napi::FunctionReference debuglog;
+  Napi::FunctionReference planlog;
+  Napi::FunctionReference queueListener;
+  Napi::Reference<Napi::External<PipelineTemplate>> pipelineTemplate;
+  Napi::ObjectReference options;
+  Napi::ObjectReference inputs;
+};
+
+static void PrepareBatchItems(PipelineBatch *batch) {
+  Napi::Object options = batch->options.Value();
+  Napi::Object inputs = batch->inputs.Value();
+  while (!batch->paused && batch->inFlight < batch->window && batch->prepared < batch->count) {
+    uint32_t const index = batch->prepared++;
+    Napi::Object input = inputs.Get(index).As<Napi::Object>();
+    rlbox_sandbox_vips* sandbox = sharp::AcquireSandboxForInput(input);
+    tainted_vips<PipelineBaton*> t_baton = CloneFromTemplate(batch->pipelineTemplate.Value().Data(), sandbox, options,
+      sharp::CreateInputDescriptor(sandbox, input));
+    batch->inFlight++;
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    batch->queue.push_back({ sandbox, t_baton, index });
+    batch->exhausted = batch->prepared == batch->count;
+    batch->ready.notify_all();
+  }
+}
+
+static void DeliverBatchResult(Napi::Env env, Napi::Function onResult, PipelineBatch *batch,
+  PipelineBatch::Item const &item) {
+  // Handle warnings
+  std::string warning = sharp::VipsWarningPop();
+  while (!warning.empty()) {
+    batch->debuglog.Call({ Napi::String::New(env, warning) });
+    warning = sharp::VipsWarningPop();
+  }
+
+  tainted_vips<PipelineResult*> t_result = item.sandbox->invoke_sandbox_function(PipelineBaton_GetResult, item.t_baton);
+  std::string errString = t_result->err.copy_and_verify_string([](std::string val) {
+    sharp::profile::CountBytesOut(val.size());
+    // Worst case, the library says there is an error when there isn't
+    return val;
+  });
+  Napi::Number position = Napi::Number::New(env, static_cast<double>(item.index));
+  Napi::Value more;
+  if (errString.empty()) {
+    LogPlan(env, batch->planlog, t_result);
+    Napi::Object info = CreateInfo(env, t_result);
+    uint32_t outBufferLength = static_cast<uint32_t>(t_result->bufferOutLength.unverified_safe_because(image_attrib_reason));
+    info.Set("size", outBufferLength);
+    // Pass ownership of output data, still in the sandbox, to Buffer instance
+    tainted_vips<char*> t_buffer_ref = rlbox::sandbox_static_cast<char*>(t_result->bufferOut);
+    Napi::Buffer<char> data = sharp::NewBufferFromSandbox(env, item.sandbox, t_buffer_ref, outBufferLength);
+    more = onResult.Call({ env.Null(), position, data, info });
+  } else {
+    more = onResult.Call({ Napi::Error::New(env, errString.c_str()).Value(), position });
+  }
+  item.sandbox->invoke_sandbox_function(DestroyPipelineBaton, item.t_baton);
+  ReleaseVipsSandbox(item.sandbox);
+
+  // Decrement processing task counter
+  g_atomic_int_dec_and_test(&sharp::counterProcess);
+  Napi::Number queueLength = Napi::Number::New(env, static_cast<double>(sharp::counterQueue));
+  batch->queueListener.Call({ queueLength });
+
+  // Prepare the next input, unless the consumer has yet to read the results already delivered
+  batch->inFlight--;
+  batch->paused = !more.IsBoolean() || !more.As<Napi::Boolean>().Value();
+  PrepareBatchItems(batch);
+}
+
+/*
+  pipelineBatch(template, options, inputs, concurrency, onResult, onDone)
+
+  onResult returns false to pause the preparation of further inputs until pipelineBatchResume.
+*/
+Napi::Value pipelineBatch(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  Napi::Object options = info[1].As<Napi::Object>();
+  Napi::Array inputs = info[2].As<Napi::Array>();
+  uint32_t const concurrency = std::max(info[3].As<Napi::Number>().Uint32Value(), 1u);
+
+  PipelineBatch *batch = new PipelineBatch;
+  batch->count = inputs.Length();
+  batch->prepared = 0;
+  batch->inFlight = 0;
+  batch->window = std::max(std::min(static_cast<size_t>(concurrency), static_cast<size_t>(batch->count)),
+    static_cast<size_t>(1));
+  batch->paused = false;
+  batch->exhausted = batch->count == 0;
+  batch->onDone = Napi::Persistent(info[5].As<Napi::Function>());
+  batch->debuglog = Napi::Persistent(options.Get("debuglog").As<Napi::Function>());
+  batch->planlog = Napi::Persistent(options.Get("planlog").As<Napi::Function>());
+  batch->queueListener = Napi::Persistent(options.Get("queueListener").As<Napi::Function>());
+  batch->pipelineTemplate = Napi::Persistent(info[0].As<Napi::External<PipelineTemplate>>());
+  batch->options = Napi::Persistent(options);
+  batch->inputs = Napi::Persistent(inputs.As<Napi::Object>());
+
+  // Each thread has at most one result waiting to be delivered
+  size_t const threads = batch->window;
+  batch->onResult = Napi::ThreadSafeFunction::New(env, info[4].As<Napi::Function>(), "sharp.batch", threads, threads,
+    batch, [](Napi::Env, PipelineBatch *batch) {
+      for (std::thread &thread : batch->threads) {
+        thread.join();
+      }
+      batch->onDone.Call({});
+      delete batch;
+    });
+
+  // Increment queued task counter by every input
+  g_atomic_int_add(&sharp::counterQueue, static_cast<gint>(batch->count));
+  Napi::Number queueLength = Napi::Number::New(env, static_cast<double>(sharp::counterQueue));
+  batch->queueListener.Call(info.This(), { queueLength });
+
+  PrepareBatchItems(batch);
+
+  batch->threads.reserve(threads);
+  for (size_t t = 0; t < threads; t++) {
+    batch->threads.emplace_back([batch]() {
+      // libvips thread-local data is released once per thread rather than once per input,
+      // so each sandbox used is pinned until then
+      std::vector<rlbox_sandbox_vips*> used;
+      for (;;) {
+        PipelineBatch::Item item;
+        {
+          std::unique_lock<std::mutex> lock(batch->mutex);
+          batch->ready.wait(lock, [batch]() { return !batch->queue.empty() || batch->exhausted; });
+          if (batch->queue.empty()) {
+            break;
+          }
+          item = batch->queue.front();
+          batch->queue.pop_front();
+        }
+        // Decrement queued task counter
+        g_atomic_int_dec_and_test(&sharp::counterQueue);
+        // Increment processing task counter
+        g_atomic_int_inc(&sharp::counterProcess);
+
+        if (std::find(used.begin(), used.end(), item.sandbox) == used.end()) {
+          PinVipsSandbox(item.sandbox);
+          used.push_back(item.sandbox);
+        }
+        item.sandbox->invoke_sandbox_function(PipelineBatchExecute, item.t_baton);
+        batch->onResult.BlockingCall([batch, item](Napi::Env env, Napi::Function onResult) {
+          DeliverBatchResult(env, onResult, batch, item);
+        });
+      }
+      for (rlbox_sandbox_vips* sandbox : used) {
+        sandbox->invoke_sandbox_function(PipelineThreadShutdown);
+        UnpinVipsSandbox(sandbox);
+      }
+      batch->onResult.Release();
+    });
+  }
+
+  return Napi::External<PipelineBatch>::New(env, batch);
+}
+
+/*
+  pipelineBatchResume(batch, stop)
+
+  Prepare further inputs once the consumer has read earlier results,
+  or, when stopping, prepare no more and finish once those in flight are delivered.
+*/
+Napi::Value pipelineBatchResume(const Napi::CallbackInfo& info) {
+  PipelineBatch *batch = info[0].As<Napi::External<PipelineBatch>>().Data();
+  bool const stop = info[1].As<Napi::Boolean>().Value();
+  if (stop) {
+    // Inputs that will no longer be prepared leave the queue
+    g_atomic_int_add(&sharp::counterQueue, -static_cast<gint>(batch->count - batch->prepared));
+    batch->count = batch->prepared;
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    batch->exhausted = true;
+    batch->ready.notify_all();
+  } else {
+    batch->paused = false;
+    PrepareBatchItems(batch);
+  }
+  return info.Env().Undefined();
+}
@@ -24,5 +24,10 @@
 #include <vips/vips8>
 
 Napi::Value pipeline(const Napi::CallbackInfo& info);
+Napi::Value pipelineMany(const Napi::CallbackInfo& info);
+Napi::Value compile(const Napi::CallbackInfo& info);
+Napi::Value pipelineFromTemplate(const Napi::CallbackInfo& info);
+Napi::Value pipelineBatch(const Napi::CallbackInfo& info);
+Napi::Value pipelineBatchResume(const Napi::CallbackInfo& info);
 
 #endif  // SRC_PIPELINE_HOST_H_
@@ -1,4 +1,10 @@
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <sstream>
+
 #include <vips/vips8>
 
 #include "common_sandbox.h"
@@ -50,6 +56,56 @@ CalculateAngleRotation(int angle) {
   return VIPS_ANGLE_D0;
 }
 
+/*
+  A sequence of 90-angle rotations and flips, folded as it is built into a clockwise rotation
+  followed by an optional flop, so opposing operations cancel and at most two are applied.
+*/
+struct Orientation {
+  int degrees = 0;
+  bool flop = false;
+  // Whether any operation was requested, even if they cancel
+  bool requested = false;
+
+  Orientation &Rotate(VipsAngle const angle) {
+    int const by = angle == VIPS_ANGLE_D90 ? 90 : angle == VIPS_ANGLE_D180 ? 180 : angle == VIPS_ANGLE_D270 ? 270 : 0;
+    // Rotating after a flop is a flop after rotating the other way
+    degrees = (degrees + (flop ? 360 - by : by)) % 360;
+    requested = requested || by != 0;
+    return *this;
+  }
+  Orientation &Flip(bool const apply) {
+    // A flip is a flop after rotating by 180
+    if (apply) {
+      Rotate(VIPS_ANGLE_D180);
+      Flop(true);
+    }
+    return *this;
+  }
+  Orientation &Flop(bool const apply) {
+    flop = flop != apply;
+    requested = requested || apply;
+    return *this;
+  }
+};
+
+/*
+  Apply a folded orientation and, when anything was requested, remove the EXIF Orientation tag.
+*/
+static VImage
+ApplyOrientation(VImage image, Orientation const &orientation) {
+  if (orientation.degrees == 180 && orientation.flop) {
+    image = image.flip(VIPS_DIRECTION_VERTICAL);
+  } else {
+    if (orientation.degrees != 0) {
+      image = image.rot(CalculateAngleRotation(orientation.degrees));
+    }
+    if (orientation.flop) {
+      image = image.flip(VIPS_DIRECTION_HORIZONTAL);
+    }
+  }
+  return orientation.requested ? sharp::RemoveExifOrientation(image) : image;
+}
+
 
 /*
   Assemble the suffix argument to dzsave, which is the format (by extname)
@@ -69,23 +125,422 @@ AssembleSuffixString(std::string extname, std::vector<std::pair<std::string, std
 }
 
 /*
-  Clear all thread-local data.
+  Reload a TIFF, HEIF or OpenSlide input with the given level-selecting option.
+*/
+static VImage
+ReloadLevel(InputDescriptor *input, sharp::ImageType const inputImageType, vips::VOption *option) {
+  option
+    ->set("access", input->access)
+    ->set("fail", input->failOnError);
+  VImage image;
+  if (inputImageType == sharp::ImageType::OPENSLIDE) {
+    image = VImage::openslideload(const_cast<char*>(input->file.data()), option);
+  } else if (input->buffer != nullptr) {
+    VipsBlob *blob = vips_blob_new(nullptr, input->buffer, input->bufferLength);
+    image = inputImageType == sharp::ImageType::TIFF
+      ? VImage::tiffload_buffer(blob, option)
+      : VImage::heifload_buffer(blob, option);
+    vips_area_unref(reinterpret_cast<VipsArea*>(blob));
+  } else {
+    image = inputImageType == sharp::ImageType::TIFF
+      ? VImage::tiffload(const_cast<char*>(input->file.data()), option)
+      : VImage::heifload(const_cast<char*>(input->file.data()), option);
+  }
+  return image;
+}
+
+/*
+  Reload a multi-resolution input at its smallest level that still leaves the given shrink to
+  the final resize: a TIFF sub-IFD or page pyramid level, an OpenSlide level or the HEIF thumbnail.
+  Returns the given image when there is no such level.
+*/
+static VImage
+ShrinkOnLoadLevel(VImage image, InputDescriptor *input, sharp::ImageType const inputImageType,
+  double const shrink, bool const fastShrinkOnLoad) {
+  // Leave at least a factor of two for the final resize step, as for JPEG, when fastShrinkOnLoad: false
+  double const factor = fastShrinkOnLoad ? 1.0 : 2.0;
+  int const minWidth = static_cast<int>(std::ceil(image.width() * factor / shrink));
+  int const minHeight = static_cast<int>(std::ceil(image.height() * factor / shrink));
+  if (minWidth * 2 > image.width() || minHeight * 2 > image.height()) {
+    // Too little shrink for a reduced level to pay for opening it
+    return image;
+  }
+  // A usable level is a smaller copy of the whole image, at least as large as required
+  auto const usable = [&](VImage const &level, VImage const &larger) {
+    return level.width() < larger.width() && level.width() >= minWidth && level.height() >= minHeight &&
+      level.bands() == image.bands() && level.format() == image.format() &&
+      std::abs(level.height() - static_cast<double>(image.height()) * level.width() / image.width()) <= 2.0;
+  };
+  VImage best = image;
+  if (inputImageType == sharp::ImageType::TIFF &&
+    input->pages == 1 && input->page == 0 && input->subifd == -1) {
+    int const subifds = image.get_typeof("n-subifds") == G_TYPE_INT ? image.get_int("n-subifds") : 0;
+    int const pages = image.get_typeof(VIPS_META_N_PAGES) == G_TYPE_INT ? image.get_int(VIPS_META_N_PAGES) : 1;
+    if (subifds > 0) {
+      for (int i = 0; i < subifds; i++) {
+        VImage level = ReloadLevel(input, inputImageType, VImage::option()->set("subifd", i));
+        if (!usable(level, best)) {
+          break;
+        }
+        best = level;
+      }
+    } else {
+      for (int i = 1; i < pages; i++) {
+        VImage level = ReloadLevel(input, inputImageType, VImage::option()->set("page", i));
+        // Each page of a pyramid is half the size of the page before
+        if (std::abs(level.width() - best.width() / 2) > 1 || !usable(level, best)) {
+          break;
+        }
+        best = level;
+      }
+    }
+  } else if (inputImageType == sharp::ImageType::OPENSLIDE && input->level == 0 &&
+    image.get_typeof("openslide.level-count") != 0) {
+    // Level dimensions are in the header of level 0, so only the chosen level is opened
+    int const levels = std::atoi(image.get_string("openslide.level-count"));
+    int chosen = 0;
+    for (int i = 1; i < levels; i++) {
+      std::string const prefix = "openslide.level[" + std::to_string(i) + "].";
+      std::string const width = prefix + "width";
+      std::string const height = prefix + "height";
+      if (image.get_typeof(width.data()) == 0 || image.get_typeof(height.data()) == 0 ||
+        std::atoi(image.get_string(width.data())) < minWidth ||
+        std::atoi(image.get_string(height.data())) < minHeight) {
+        break;
+      }
+      chosen = i;
+    }
+    if (chosen > 0) {
+      best = ReloadLevel(input, inputImageType, VImage::option()->set("level", chosen));
+    }
+  } else if (inputImageType == sharp::ImageType::HEIF && input->pages == 1) {
+    // Without a thumbnail, heifload returns the primary image and nothing changes
+    VImage thumbnail = ReloadLevel(input, inputImageType, VImage::option()
+      ->set("page", input->page)
+      ->set("thumbnail", TRUE));
+    if (usable(thumbnail, image)) {
+      best = thumbnail;
+    }
+  }
+  if (best.get_image() == image.get_image()) {
+    return image;
+  }
+  // Reduced levels need not repeat the orientation and profile of the full resolution image
+  best = best.copy();
+  if (image.get_typeof(VIPS_META_ORIENTATION) != 0 && best.get_typeof(VIPS_META_ORIENTATION) == 0) {
+    best.set(VIPS_META_ORIENTATION, image.get_int(VIPS_META_ORIENTATION));
+  }
+  if (sharp::HasProfile(image) && !sharp::HasProfile(best)) {
+    size_t length;
+    void const *profile = image.get_blob(VIPS_META_ICC_NAME, &length);
+    vips_image_set_blob_copy(best.get_image(), VIPS_META_ICC_NAME, profile, length);
+  }
+  return best;
+}
+
+/*
+  Resolve the nick of a resize kernel, once when the baton is built, VIPS_KERNEL_LAST when unsupported.
+*/
+static VipsKernel
+ResolveKernel(std::string const &nick) {
+  VipsKernel const kernel = static_cast<VipsKernel>(
+    vips_enum_from_nick(nullptr, VIPS_TYPE_KERNEL, nick.data()));
+  if (
+    kernel != VIPS_KERNEL_NEAREST && kernel != VIPS_KERNEL_CUBIC && kernel != VIPS_KERNEL_LANCZOS2 &&
+    kernel != VIPS_KERNEL_LANCZOS3 && kernel != VIPS_KERNEL_MITCHELL
+  ) {
+    return VIPS_KERNEL_LAST;
+  }
+  return kernel;
+}
+
+/*
+  The profile used while processing: P3 for 16-bit RGB, otherwise sRGB.
+*/
+static char const *
+ProcessingProfile(VImage image) {
+  return image.interpretation() == VIPS_INTERPRETATION_RGB16 ? "p3" : "srgb";
+}
+
+/*
+  Convert to the device-independent processing colour space using the embedded profile, if any.
+*/
+static VImage
+ToProcessingProfile(VImage image) {
+  char const *processingProfile = ProcessingProfile(image);
+  if (
+    sharp::HasProfile(image) &&
+    image.interpretation() != VIPS_INTERPRETATION_LABS &&
+    image.interpretation() != VIPS_INTERPRETATION_GREY16 &&
+    image.interpretation() != VIPS_INTERPRETATION_B_W
+  ) {
+    // Convert to sRGB/P3 using embedded profile
+    try {
+      image = sharp::EmbeddedProfileTransform(image, processingProfile,
+        image.interpretation() == VIPS_INTERPRETATION_RGB16 ? 16 : 8, VIPS_INTENT_PERCEPTUAL);
+    } catch(...) {
+      // Ignore failure of embedded profile
+    }
+  } else if (image.interpretation() == VIPS_INTERPRETATION_CMYK) {
+    image = image.icc_transform(processingProfile, VImage::option()
+      ->set("input_profile", "cmyk")
+      ->set("intent", VIPS_INTENT_PERCEPTUAL));
+  }
+  return image;
+}
+
+/*
+  An input that has already been decoded, shrunk-on-load and colour-managed,
+  shared by the outputs of a multi-output pipeline.
+*/
+struct PipelineSource {
+  VImage image;
+  sharp::ImageType type;
+  // The shrink applied relative to the decoded input
+  double shrink;
+};
+
+/*
+  The point-wise operations that may run before the resize, in pipeline order.
+*/
+enum class PointOp {
+  PROFILE,
+  FLATTEN,
+  NEGATE,
+  GAMMA,
+  GREYSCALE,
+  ENSURE_ALPHA
+};
+
+static char const *
+PointOpName(PointOp const op) {
+  switch (op) {
+    case PointOp::PROFILE: return "icc_transform";
+    case PointOp::FLATTEN: return "flatten";
+    case PointOp::NEGATE: return "negate";
+    case PointOp::GAMMA: return "gamma";
+    case PointOp::GREYSCALE: return "greyscale";
+    case PointOp::ENSURE_ALPHA: return "ensureAlpha";
+  }
+  return "";
+}
+
+/*
+  Which point-wise operations run before the resize and which are deferred until after it,
+  where they touch fewer pixels.
+*/
+struct PointOpPlan {
+  std::vector<PointOp> before;
+  std::vector<PointOp> after;
+  // Worst-case difference, in 8-bit levels, introduced by deferring
+  double error = 0.0;
+};
+
+/*
+  Worst-case difference, in 8-bit levels, when a colour conversion through linear light runs after
+  rather than before a reduction. It is largest at an edge between saturated complementary colours:
+  green and magenta average to mid-grey, 128, whereas their luminances of 0.7152 and 0.2848 encode
+  to 220 and 145 through the sRGB transfer curve and average to 183, 55 levels apart, rounded up.
+*/
+static double const transferCurveDeferralError = 56.0;
+
+/*
+  Worst-case difference, in 8-bit levels, between running an operation before and after a
+  reduction, or a negative value when it must, or is cheaper to, run before. Linear operations
+  commute with the weighted average of a reduction, premultiplied where there is alpha, up to rounding.
+*/
+static double
+PointOpDeferralError(PointOp const op, PipelineBaton *baton, VImage const &image, bool const hasAlpha) {
+  switch (op) {
+    case PointOp::PROFILE:
+      // The CMYK to RGB conversion has no such bound
+      return image.interpretation() == VIPS_INTERPRETATION_CMYK ? -1.0 : transferCurveDeferralError;
+    case PointOp::FLATTEN:
+      // Deferring would carry, and premultiply, an alpha channel through the reduction,
+      // costing more than flattening at full size
+      return -1.0;
+    case PointOp::NEGATE:
+      // Negated alpha would weight the reduction differently
+      return baton->negateAlpha && hasAlpha ? -1.0 : 1.0;
+    case PointOp::GAMMA:
+      // Reducing in the gamma-encoded space is the point of the operation
+      return -1.0;
+    case PointOp::GREYSCALE:
+      // Reducing colour bands to one before the resize leaves it a third of the work
+      return image.bands() - (hasAlpha ? 1 : 0) == 1 ? 1.0 : -1.0;
+    default:
+      return 1.0;
+  }
+}
+
+/*
+  Build the list of point-wise operations from the baton and, when the resize reduces the
+  number of pixels, defer the longest tail of it whose combined worst-case difference is
+  within the tolerance. Only a tail is deferred so the operations keep their order.
+*/
+static PointOpPlan
+PlanPointOps(PipelineBaton *baton, VImage const &image, bool const toProcessingProfile, double const shrink) {
+  std::vector<std::pair<PointOp, double>> ops;
+  bool hasAlpha = sharp::HasAlpha(image);
+  auto const add = [&](PointOp const op) {
+    ops.emplace_back(op, PointOpDeferralError(op, baton, image, hasAlpha));
+  };
+  if (toProcessingProfile && (image.interpretation() == VIPS_INTERPRETATION_CMYK || (
+    sharp::HasProfile(image) &&
+    image.interpretation() != VIPS_INTERPRETATION_LABS &&
+    image.interpretation() != VIPS_INTERPRETATION_GREY16 &&
+    image.interpretation() != VIPS_INTERPRETATION_B_W))) {
+    add(PointOp::PROFILE);
+  }
+  if (baton->flatten && hasAlpha) {
+    add(PointOp::FLATTEN);
+    hasAlpha = false;
+  }
+  if (baton->negate) {
+    add(PointOp::NEGATE);
+  }
+  if (baton->gamma >= 1 && baton->gamma <= 3) {
+    add(PointOp::GAMMA);
+  }
+  if (baton->greyscale) {
+    add(PointOp::GREYSCALE);
+  }
+  if (!baton->composite.empty() && !hasAlpha) {
+    add(PointOp::ENSURE_ALPHA);
+  }
+
+  PointOpPlan plan;
+  size_t deferred = 0;
+  if (shrink > 1.0) {
+    for (auto op = ops.rbegin(); op != ops.rend(); op++) {
+      if (op->second < 0.0 || plan.error + op->second > baton->reorderTolerance) {
+        break;
+      }
+      plan.error += op->second;
+      deferred++;
+    }
+  }
+  for (size_t i = 0; i < ops.size(); i++) {
+    (i < ops.size() - deferred ? plan.before : plan.after).push_back(ops[i].first);
+  }
+  return plan;
+}
+
+/*
+  Run point-wise operations, in order.
+*/
+static VImage
+ApplyPointOps(VImage image, PipelineBaton *baton, std::vector<PointOp> const &ops) {
+  for (PointOp const op : ops) {
+    switch (op) {
+      case PointOp::PROFILE:
+        image = ToProcessingProfile(image);
+        break;
+      case PointOp::FLATTEN:
+        // Flatten image to remove alpha channel
+        if (sharp::HasAlpha(image)) {
+          // Scale up 8-bit values to match 16-bit input image
+          double const multiplier = sharp::Is16Bit(image.interpretation()) ? 256.0 : 1.0;
+          // Background colour
+          std::vector<double> background {
+            baton->flattenBackground[0] * multiplier,
+            baton->flattenBackground[1] * multiplier,
+            baton->flattenBackground[2] * multiplier
+          };
+          image = image.flatten(VImage::option()
+            ->set("background", background));
+        }
+        break;
+      case PointOp::NEGATE:
+        // Negate the colours in the image
+        image = sharp::Negate(image, baton->negateAlpha);
+        break;
+      case PointOp::GAMMA:
+        // Gamma encoding (darken)
+        image = sharp::Gamma(image, 1.0 / baton->gamma);
+        break;
+      case PointOp::GREYSCALE:
+        // Convert to greyscale (linear, therefore after gamma encoding, if any)
+        image = image.colourspace(VIPS_INTERPRETATION_B_W);
+        break;
+      case PointOp::ENSURE_ALPHA:
+        // Composite needs an alpha channel
+        if (!sharp::HasAlpha(image)) {
+          image = sharp::EnsureAlpha(image, 1);
+        }
+        break;
+    }
+  }
+  return image;
+}
+
+/*
+  Describe a plan for debug output.
+*/
+static std::string
+DescribePointOps(PointOpPlan const &plan, double const hshrink, double const vshrink) {
+  auto const names = [](std::vector<PointOp> const &ops) {
+    std::string list;
+    for (PointOp const op : ops) {
+      list += (list.empty() ? "" : ", ") + std::string(PointOpName(op));
+    }
+    return list.empty() ? std::string("none") : list;
+  };
+  std::ostringstream description;
+  description << "pipeline plan: before resize [" << names(plan.before) << "]"
+    << ", resize " << hshrink << "x" << vshrink
+    << ", after resize [" << names(plan.after) << "]"
+    << ", worst-case difference " << plan.error << " levels";
+  return description.str();
+}
+
+/*
+  The 8-bit interpretation a 16-bit image can be reduced to straight after the resize, or
+  VIPS_INTERPRETATION_LAST to keep it. Output converted to 8-bit sRGB or greyscale gains nothing
+  from 16-bit intermediates once the image is small, unless a later operation takes values in
+  absolute rather than format-relative units. Premultiplied images are float until the end anyway.
+*/
+static VipsInterpretation
+ReducedInterpretation(PipelineBaton const *baton, VImage const &image, bool const premultiplied) {
+  bool const eightBitOutput =
+    baton->colourspace == VIPS_INTERPRETATION_sRGB || baton->colourspace == VIPS_INTERPRETATION_B_W;
+  bool const absoluteValues =
+    baton->linearA != 1.0 || baton->linearB != 0.0 || baton->convKernelWidth * baton->convKernelHeight > 0 ||
+    baton->threshold != 0 || baton->boolean != nullptr || !baton->joinChannelIn.empty() ||
+    (baton->bandBoolOp >= VIPS_OPERATION_BOOLEAN_AND && baton->bandBoolOp < VIPS_OPERATION_BOOLEAN_LAST);
+  if (!baton->reduceEarly || !eightBitOutput || absoluteValues || premultiplied ||
+    baton->colourspaceInput != VIPS_INTERPRETATION_LAST || image.format() != VIPS_FORMAT_USHORT) {
+    return VIPS_INTERPRETATION_LAST;
+  }
+  switch (image.interpretation()) {
+    case VIPS_INTERPRETATION_RGB16: return VIPS_INTERPRETATION_sRGB;
+    case VIPS_INTERPRETATION_GREY16: return VIPS_INTERPRETATION_B_W;
+    default: return VIPS_INTERPRETATION_LAST;
+  }
+}
+
+/*
+  Clear per-request error state. Thread-local data is released by whoever owns the
+  thread, so long-lived threads can run many pipelines.
 */
 static void Error() {
-  // Clean up libvips' per-request data and threads
   vips_error_clear();
-  vips_thread_shutdown();
 }
 
 
-void PipelineWorkerExecute(PipelineBaton *baton) {
+static void RunPipeline(PipelineBaton *baton, PipelineSource const *source = nullptr) {
 
   try {
-    // Open input
+    // Open input, unless it has already been decoded for us
     vips::VImage image;
     sharp::ImageType inputImageType;
-    std::tie(image, inputImageType) = sharp::OpenInput(baton->input);
-    image = sharp::EnsureColourspace(image, baton->colourspaceInput);
+    if (source != nullptr) {
+      image = source->image;
+      inputImageType = source->type;
+    } else {
+      std::tie(image, inputImageType) = sharp::OpenInput(baton->input);
+      image = sharp::EnsureColourspace(image, baton->colourspaceInput);
+    }
 
     int nPages = baton->input->pages;
     if (nPages == -1) {
@@ -112,16 +567,9 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
     // Rotate pre-extract
     if (baton->rotateBeforePreExtract) {
       if (rotation != VIPS_ANGLE_D0) {
-        image = image.rot(rotation);
-        if (flip) {
-          image = image.flip(VIPS_DIRECTION_VERTICAL);
-          flip = FALSE;
-        }
-        if (flop) {
-          image = image.flip(VIPS_DIRECTION_HORIZONTAL);
-          flop = FALSE;
-        }
-        image = sharp::RemoveExifOrientation(image);
+        image = ApplyOrientation(image, Orientation().Rotate(rotation).Flip(flip).Flop(flop));
+        flip = FALSE;
+        flop = FALSE;
       }
       if (baton->rotationAngle != 0.0) {
         MultiPageUnsupported(nPages, "Rotate");
@@ -176,109 +624,29 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
     // WebP, PDF, SVG scale
     double scale = 1.0;
 
-    // Try to reload input using shrink-on-load for JPEG, WebP, SVG and PDF, when:
+    // Try to reload input using shrink-on-load for JPEG, WebP, SVG and PDF,
+    // or at a reduced level for TIFF, OpenSlide and HEIF, when:
     //  - the width or height parameters are specified;
     //  - gamma correction doesn't need to be applied;
     //  - trimming or pre-resize extract isn't required;
     //  - input colourspace is not specified;
-    bool const shouldPreShrink = (targetResizeWidth > 0 || targetResizeHeight > 0) &&
+    //  - the input has not already been decoded for us;
+    bool const shouldPreShrink = source == nullptr && (targetResizeWidth > 0 || targetResizeHeight > 0) &&
       baton->gamma == 0 && baton->topOffsetPre == -1 && baton->trimThreshold == 0.0 &&
       baton->colourspaceInput == VIPS_INTERPRETATION_LAST;
 
     if (shouldPreShrink) {
       // The common part of the shrink: the bit by which both axes must be shrunk
-      double shrink = std::min(hshrink, vshrink);
-
-      if (inputImageType == sharp::ImageType::JPEG) {
-        // Leave at least a factor of two for the final resize step, when fastShrinkOnLoad: false
-        // for more consistent results and to avoid extra sharpness to the image
-        int factor = baton->fastShrinkOnLoad ? 1 : 2;
-        if (shrink >= 8 * factor) {
-          jpegShrinkOnLoad = 8;
-        } else if (shrink >= 4 * factor) {
-          jpegShrinkOnLoad = 4;
-        } else if (shrink >= 2 * factor) {
-          jpegShrinkOnLoad = 2;
-        }
-        // Lower shrink-on-load for known libjpeg rounding errors
-        if (jpegShrinkOnLoad > 1 && static_cast<int>(shrink) == jpegShrinkOnLoad) {
-          jpegShrinkOnLoad /= 2;
-        }
-      } else if (inputImageType == sharp::ImageType::WEBP ||
-                 inputImageType == sharp::ImageType::SVG ||
-                 inputImageType == sharp::ImageType::PDF) {
-        scale = 1.0 / shrink;
-      }
+      double const shrink = std::min(hshrink, vshrink);
+      std::tie(jpegShrinkOnLoad, scale) = sharp::ShrinkOnLoadFactors(inputImageType, shrink, baton->fastShrinkOnLoad);
+      // Pick the smallest sufficient level of a multi-resolution TIFF, OpenSlide or HEIF input
+      image = ShrinkOnLoadLevel(image, baton->input, inputImageType, shrink, baton->fastShrinkOnLoad);
     }
 
     // Reload input using shrink-on-load, it'll be an integer shrink
     // factor for jpegload*, a double scale factor for webpload*,
     // pdfload* and svgload*
-    if (jpegShrinkOnLoad > 1) {
-      vips::VOption *option = VImage::option()
-        ->set("access", baton->input->access)
-        ->set("shrink", jpegShrinkOnLoad)
-        ->set("fail", baton->input->failOnError);
-      if (baton->input->buffer != nullptr) {
-        // Reload JPEG buffer
-        VipsBlob *blob = vips_blob_new(nullptr, baton->input->buffer, baton->input->bufferLength);
-        image = VImage::jpegload_buffer(blob, option);
-        vips_area_unref(reinterpret_cast<VipsArea*>(blob));
-      } else {
-        // Reload JPEG file
-        image = VImage::jpegload(const_cast<char*>(baton->input->file.data()), option);
-      }
-    } else if (scale != 1.0) {
-      vips::VOption *option = VImage::option()
-        ->set("access", baton->input->access)
-        ->set("scale", scale)
-        ->set("fail", baton->input->failOnError);
-      if (inputImageType == sharp::ImageType::WEBP) {
-        option->set("n", baton->input->pages);
-        option->set("page", baton->input->page);
-
-        if (baton->input->buffer != nullptr) {
-          // Reload WebP buffer
-          VipsBlob *blob = vips_blob_new(nullptr, baton->input->buffer, baton->input->bufferLength);
-          image = VImage::webpload_buffer(blob, option);
-          vips_area_unref(reinterpret_cast<VipsArea*>(blob));
-        } else {
-          // Reload WebP file
-          image = VImage::webpload(const_cast<char*>(baton->input->file.data()), option);
-        }
-      } else if (inputImageType == sharp::ImageType::SVG) {
-        option->set("unlimited", baton->input->unlimited);
-        option->set("dpi", baton->input->density);
-
-        if (baton->input->buffer != nullptr) {
-          // Reload SVG buffer
-          VipsBlob *blob = vips_blob_new(nullptr, baton->input->buffer, baton->input->bufferLength);
-          image = VImage::svgload_buffer(blob, option);
-          vips_area_unref(reinterpret_cast<VipsArea*>(blob));
-        } else {
-          // Reload SVG file
-          image = VImage::svgload(const_cast<char*>(baton->input->file.data()), option);
-        }
-
-        sharp::SetDensity(image, baton->input->density);
-      } else if (inputImageType == sharp::ImageType::PDF) {
-        option->set("n", baton->input->pages);
-        option->set("page", baton->input->page);
-        option->set("dpi", baton->input->density);
-
-        if (baton->input->buffer != nullptr) {
-          // Reload PDF buffer
-          VipsBlob *blob = vips_blob_new(nullptr, baton->input->buffer, baton->input->bufferLength);
-          image = VImage::pdfload_buffer(blob, option);
-          vips_area_unref(reinterpret_cast<VipsArea*>(blob));
-        } else {
-          // Reload PDF file
-          image = VImage::pdfload(const_cast<char*>(baton->input->file.data()), option);
-        }
-
-        sharp::SetDensity(image, baton->input->density);
-      }
-    }
+    image = sharp::ShrinkOnLoad(image, baton->input, inputImageType, jpegShrinkOnLoad, scale);
 
     // Any pre-shrinking may already have been done
     inputWidth = image.width();
@@ -305,57 +673,8 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
       vshrink = static_cast<double>(inputHeight) / targetHeight;
     }
 
-    // Ensure we're using a device-independent colour space
-    char const *processingProfile = image.interpretation() == VIPS_INTERPRETATION_RGB16 ? "p3" : "srgb";
-    if (
-      sharp::HasProfile(image) &&
-      image.interpretation() != VIPS_INTERPRETATION_LABS &&
-      image.interpretation() != VIPS_INTERPRETATION_GREY16 &&
-      image.interpretation() != VIPS_INTERPRETATION_B_W
-    ) {
-      // Convert to sRGB/P3 using embedded profile
-      try {
-        image = image.icc_transform(processingProfile, VImage::option()
-          ->set("embedded", TRUE)
-          ->set("depth", image.interpretation() == VIPS_INTERPRETATION_RGB16 ? 16 : 8)
-          ->set("intent", VIPS_INTENT_PERCEPTUAL));
-      } catch(...) {
-        // Ignore failure of embedded profile
-      }
-    } else if (image.interpretation() == VIPS_INTERPRETATION_CMYK) {
-      image = image.icc_transform(processingProfile, VImage::option()
-        ->set("input_profile", "cmyk")
-        ->set("intent", VIPS_INTENT_PERCEPTUAL));
-    }
-
-    // Flatten image to remove alpha channel
-    if (baton->flatten && sharp::HasAlpha(image)) {
-      // Scale up 8-bit values to match 16-bit input image
-      double const multiplier = sharp::Is16Bit(image.interpretation()) ? 256.0 : 1.0;
-      // Background colour
-      std::vector<double> background {
-        baton->flattenBackground[0] * multiplier,
-        baton->flattenBackground[1] * multiplier,
-        baton->flattenBackground[2] * multiplier
-      };
-      image = image.flatten(VImage::option()
-        ->set("background", background));
-    }
-
-    // Negate the colours in the image
-    if (baton->negate) {
-      image = sharp::Negate(image, baton->negateAlpha);
-    }
-
-    // Gamma encoding (darken)
-    if (baton->gamma >= 1 && baton->gamma <= 3) {
-      image = sharp::Gamma(image, 1.0 / baton->gamma);
-    }
-
-    // Convert to greyscale (linear, therefore after gamma encoding, if any)
-    if (baton->greyscale) {
-      image = image.colourspace(VIPS_INTERPRETATION_B_W);
-    }
+    // The profile used while processing, which the input is converted to before or after the resize
+    char const *processingProfile = ProcessingProfile(image);
 
     bool const shouldResize = hshrink != 1.0 || vshrink != 1.0;
     bool const shouldBlur = baton->blurSigma != 0.0;
@@ -367,11 +686,16 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
                                 baton->hue != 0.0 || baton->lightness != 0.0;
     bool const shouldApplyClahe = baton->claheWidth != 0 && baton->claheHeight != 0;
 
-    if (shouldComposite && !sharp::HasAlpha(image)) {
-      image = sharp::EnsureAlpha(image, 1);
+    // Point-wise operations: conversion to a device-independent colour space, unless a shared
+    // source already is, flatten, negate, gamma, greyscale and an alpha channel for composite.
+    // Those that give the same output within the tolerance run after a reduction instead.
+    PointOpPlan const pointOps = PlanPointOps(baton, image, source == nullptr, shouldResize ? hshrink * vshrink : 1.0);
+    if (baton->debugPlan && shouldResize && !(pointOps.before.empty() && pointOps.after.empty())) {
+      baton->plan = DescribePointOps(pointOps, hshrink, vshrink);
     }
+    image = ApplyPointOps(image, baton, pointOps.before);
 
-    bool const shouldPremultiplyAlpha = sharp::HasAlpha(image) &&
+    bool shouldPremultiplyAlpha = sharp::HasAlpha(image) &&
       (shouldResize || shouldBlur || shouldConv || shouldSharpen);
 
     // Premultiply image alpha channel before all transformations to avoid
@@ -383,44 +707,44 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
 
     // Resize
     if (shouldResize) {
-      VipsKernel kernel = static_cast<VipsKernel>(
-        vips_enum_from_nick(nullptr, VIPS_TYPE_KERNEL, baton->kernel.data()));
-      if (
-        kernel != VIPS_KERNEL_NEAREST && kernel != VIPS_KERNEL_CUBIC && kernel != VIPS_KERNEL_LANCZOS2 &&
-        kernel != VIPS_KERNEL_LANCZOS3 && kernel != VIPS_KERNEL_MITCHELL
-      ) {
+      if (baton->kernelType == VIPS_KERNEL_LAST) {
         throw vips::VError("Unknown kernel");
       }
       image = image.resize(1.0 / hshrink, VImage::option()
         ->set("vscale", 1.0 / vshrink)
-        ->set("kernel", kernel));
+        ->set("kernel", baton->kernelType));
     }
 
-    // Rotate post-extract 90-angle
-    if (!baton->rotateBeforePreExtract && rotation != VIPS_ANGLE_D0) {
-      image = image.rot(rotation);
-      if (flip) {
-        image = image.flip(VIPS_DIRECTION_VERTICAL);
-        flip = FALSE;
+    // Deferred point-wise operations, on unpremultiplied pixels
+    if (!pointOps.after.empty()) {
+      if (shouldPremultiplyAlpha) {
+        image = image.unpremultiply()
+          .cast(sharp::Is16Bit(image.interpretation()) ? VIPS_FORMAT_USHORT : VIPS_FORMAT_UCHAR);
       }
-      if (flop) {
-        image = image.flip(VIPS_DIRECTION_HORIZONTAL);
-        flop = FALSE;
+      image = ApplyPointOps(image, baton, pointOps.after);
+      shouldPremultiplyAlpha = sharp::HasAlpha(image) && (shouldResize || shouldBlur || shouldConv || shouldSharpen);
+      if (shouldPremultiplyAlpha) {
+        image = image.premultiply();
       }
-      image = sharp::RemoveExifOrientation(image);
     }
 
-    // Flip (mirror about Y axis)
-    if (baton->flip || flip) {
-      image = image.flip(VIPS_DIRECTION_VERTICAL);
-      image = sharp::RemoveExifOrientation(image);
+    // Reduce 16-bit to 8-bit now, rather than at output, when nothing that follows needs the precision
+    VipsInterpretation const reducedInterpretation = ReducedInterpretation(baton, image, shouldPremultiplyAlpha);
+    bool const shouldReduceEarly = reducedInterpretation != VIPS_INTERPRETATION_LAST;
+    if (shouldReduceEarly) {
+      image = image.colourspace(reducedInterpretation, VImage::option()->set("source_space", image.interpretation()));
     }
 
-    // Flop (mirror about X axis)
-    if (baton->flop || flop) {
-      image = image.flip(VIPS_DIRECTION_HORIZONTAL);
-      image = sharp::RemoveExifOrientation(image);
+    // Rotate post-extract 90-angle, then flip (mirror about Y axis) and flop (mirror about X axis),
+    // folded so opposing operations cancel
+    Orientation orientation;
+    if (!baton->rotateBeforePreExtract && rotation != VIPS_ANGLE_D0) {
+      orientation.Rotate(rotation).Flip(flip).Flop(flop);
+      flip = FALSE;
+      flop = FALSE;
     }
+    orientation.Flip(baton->flip || flip).Flop(baton->flop || flop);
+    image = ApplyOrientation(image, orientation);
 
     // Join additional color channels to the image
     if (baton->joinChannelIn.size() > 0) {
@@ -584,8 +908,11 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
         baton->convKernel);
     }
 
-    // Recomb
-    if (baton->recombMatrix != NULL) {
+    // Recomb, unless only affine band operations follow, which it is then fused with
+    bool const shouldFuseRecomb = !baton->recombMatrix.empty() && sharp::BandTransform(image).CanRecomb() &&
+      !shouldModulate && !shouldSharpen && !shouldComposite && !shouldPremultiplyAlpha &&
+      !(baton->gammaOut >= 1 && baton->gammaOut <= 3);
+    if (!baton->recombMatrix.empty() && !shouldFuseRecomb) {
       image = sharp::Recomb(image, baton->recombMatrix);
     }
 
@@ -696,9 +1023,25 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
       image = sharp::Gamma(image, baton->gammaOut);
     }
 
+    // Recomb, linear, channel extraction and alpha removal/addition are accumulated while
+    // consecutive, then applied as one affine band transform
+    sharp::BandTransform bandTransform(image);
+    if (shouldFuseRecomb) {
+      bandTransform.Recomb(baton->recombMatrix);
+    }
+
     // Linear adjustment (a * in + b)
     if (baton->linearA != 1.0 || baton->linearB != 0.0) {
-      image = sharp::Linear(image, baton->linearA, baton->linearB);
+      bandTransform.Linear(baton->linearA, baton->linearB);
+    }
+
+    // Apply what has been accumulated before any operation that is not an affine band transform
+    bool const shouldInterruptBandTransform =
+      baton->normalise || shouldApplyClahe || baton->boolean != nullptr ||
+      (baton->bandBoolOp >= VIPS_OPERATION_BOOLEAN_AND && baton->bandBoolOp < VIPS_OPERATION_BOOLEAN_LAST) ||
+      baton->tintA < 128.0 || baton->tintB < 128.0;
+    if (shouldInterruptBandTransform) {
+      image = bandTransform.Apply(image);
     }
 
     // Apply normalisation - stretch luminance to cover full dynamic range
@@ -730,47 +1073,50 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
       image = sharp::Tint(image, baton->tintA, baton->tintB);
     }
 
+    if (shouldInterruptBandTransform) {
+      bandTransform = sharp::BandTransform(image);
+    }
+
     // Extract an image channel (aka vips band)
     if (baton->extractChannel > -1) {
-      if (baton->extractChannel >= image.bands()) {
-        if (baton->extractChannel == 3 && sharp::HasAlpha(image)) {
-          baton->extractChannel = image.bands() - 1;
+      if (baton->extractChannel >= bandTransform.Bands()) {
+        if (baton->extractChannel == 3 && bandTransform.HasAlpha()) {
+          baton->extractChannel = bandTransform.Bands() - 1;
         } else {
           (baton->err).append("Cannot extract channel from image. Too few channels in image.");
           return Error();
         }
       }
-      VipsInterpretation const interpretation = sharp::Is16Bit(image.interpretation())
-        ? VIPS_INTERPRETATION_GREY16
-        : VIPS_INTERPRETATION_B_W;
-      image = image
-        .extract_band(baton->extractChannel)
-        .copy(VImage::option()->set("interpretation", interpretation));
+      bandTransform.ExtractBand(baton->extractChannel);
     }
 
     // Remove alpha channel, if any
     if (baton->removeAlpha) {
-      image = sharp::RemoveAlpha(image);
+      bandTransform.RemoveAlpha();
     }
 
     // Ensure alpha channel, if missing
     if (baton->ensureAlpha != -1) {
-      image = sharp::EnsureAlpha(image, baton->ensureAlpha);
+      bandTransform.EnsureAlpha(baton->ensureAlpha);
     }
 
+    image = bandTransform.Apply(image);
+
     // Convert image to sRGB, if not already
-    if (sharp::Is16Bit(image.interpretation())) {
+    if (sharp::Is16Bit(image.interpretation()) && image.format() != VIPS_FORMAT_USHORT) {
       image = image.cast(VIPS_FORMAT_USHORT);
     }
-    if (image.interpretation() != baton->colourspace) {
+    bool const shouldConvertColourspace = image.interpretation() != baton->colourspace;
+    if (shouldConvertColourspace) {
       // Convert colourspace, pass the current known interpretation so libvips doesn't have to guess
       image = image.colourspace(baton->colourspace, VImage::option()->set("source_space", image.interpretation()));
-      // Transform colours from embedded profile to output profile
-      if (baton->withMetadata && sharp::HasProfile(image) && baton->withMetadataIcc.empty()) {
-        image = image.icc_transform("srgb", VImage::option()
-          ->set("embedded", TRUE)
-          ->set("intent", VIPS_INTENT_PERCEPTUAL));
-      }
+    }
+    // Transform colours from embedded profile to output profile, as if an early reduction were this conversion
+    if ((shouldConvertColourspace || shouldReduceEarly) &&
+      baton->withMetadata && sharp::HasProfile(image) && baton->withMetadataIcc.empty()) {
+      image = image.icc_transform("srgb", VImage::option()
+        ->set("embedded", TRUE)
+        ->set("intent", VIPS_INTENT_PERCEPTUAL));
     }
 
     // Apply output ICC profile
@@ -1179,11 +1525,219 @@ void PipelineWorkerExecute(PipelineBaton *baton) {
       (baton->err).append("Unknown error");
     }
   }
-  // Clean up libvips' per-request data and threads
+  // Clean up libvips' per-request data
   vips_error_clear();
+}
+
+/*
+  Gather everything the host reads back once the pipeline has run.
+*/
+static void FillPipelineResult(PipelineBaton *baton) {
+  PipelineResult &result = baton->result;
+  result.err = baton->err.c_str();
+  result.formatOut = baton->formatOut.c_str();
+  result.fileOut = baton->fileOut.c_str();
+  result.bufferOut = baton->bufferOut;
+  result.bufferOutLength = baton->bufferOutLength;
+  result.width = baton->width;
+  result.height = baton->height;
+  if (baton->topOffsetPre != -1 && (baton->width == -1 || baton->height == -1)) {
+    result.width = baton->widthPre;
+    result.height = baton->heightPre;
+  }
+  if (baton->topOffsetPost != -1) {
+    result.width = baton->widthPost;
+    result.height = baton->heightPost;
+  }
+  result.channels = baton->channels;
+  result.rawDepth = baton->rawDepth;
+  result.premultiplied = baton->premultiplied;
+  result.hasCropOffset = baton->hasCropOffset;
+  result.cropOffsetLeft = baton->cropOffsetLeft;
+  result.cropOffsetTop = baton->cropOffsetTop;
+  result.hasTrimOffset = baton->trimThreshold > 0.0;
+  result.trimOffsetLeft = baton->trimOffsetLeft;
+  result.trimOffsetTop = baton->trimOffsetTop;
+  result.plan = baton->plan.empty() ? nullptr : baton->plan.c_str();
+}
+
+void PipelineWorkerExecute(PipelineBaton *baton) {
+  RunPipeline(baton);
+  FillPipelineResult(baton);
+  // Clean up libvips' per-request threads
   vips_thread_shutdown();
 }
 
+void PipelineBatchExecute(PipelineBaton *baton) {
+  RunPipeline(baton);
+  FillPipelineResult(baton);
+}
+
+void PipelineThreadShutdown() {
+  vips_thread_shutdown();
+}
+
+/*
+  Whether the output dimensions are swapped by the rotation applied after resizing.
+*/
+static bool SwapsDimensions(PipelineBaton *baton, VImage image) {
+  VipsAngle const rotation = baton->useExifOrientation
+    ? std::get<0>(CalculateExifRotationAndFlip(sharp::ExifOrientation(image)))
+    : CalculateAngleRotation(baton->angle);
+  return !baton->rotateBeforePreExtract && (rotation == VIPS_ANGLE_D90 || rotation == VIPS_ANGLE_D270);
+}
+
+/*
+  Decode the input shared by every output of a multi-output pipeline, once.
+  Shrink-on-load is applied for the largest output, under the same conditions as
+  RunPipeline, before converting to the processing colour space and copying to memory.
+*/
+static PipelineSource OpenPipelineSource(std::vector<PipelineBaton*> const &batons) {
+  PipelineBaton *baton = batons.front();
+  PipelineSource source;
+  std::tie(source.image, source.type) = sharp::OpenInput(baton->input);
+  source.image = sharp::EnsureColourspace(source.image, baton->colourspaceInput);
+  source.shrink = 1.0;
+
+  bool shouldPreShrink = sharp::GetPageHeight(source.image) == source.image.height() &&
+    !baton->rotateBeforePreExtract && baton->gamma == 0 && baton->topOffsetPre == -1 &&
+    baton->trimThreshold == 0.0 && baton->colourspaceInput == VIPS_INTERPRETATION_LAST;
+  if (shouldPreShrink) {
+    bool const swap = SwapsDimensions(baton, source.image);
+    double shrink = 0.0;
+    for (PipelineBaton *output : batons) {
+      if (output->width <= 0 && output->height <= 0) {
+        shouldPreShrink = false;
+        break;
+      }
+      double hshrink;
+      double vshrink;
+      std::tie(hshrink, vshrink) = sharp::ResolveShrink(
+        source.image.width(), source.image.height(), output->width, output->height,
+        output->canvas, swap, output->withoutEnlargement, output->withoutReduction);
+      shrink = shrink == 0.0 ? std::min(hshrink, vshrink) : std::min(shrink, std::min(hshrink, vshrink));
+    }
+    if (shouldPreShrink) {
+      int jpegShrinkOnLoad;
+      double scale;
+      std::tie(jpegShrinkOnLoad, scale) = sharp::ShrinkOnLoadFactors(source.type, shrink, baton->fastShrinkOnLoad);
+      source.image = sharp::ShrinkOnLoad(source.image, baton->input, source.type, jpegShrinkOnLoad, scale);
+      source.image = ShrinkOnLoadLevel(source.image, baton->input, source.type, shrink, baton->fastShrinkOnLoad);
+    }
+  }
+
+  source.image = ToProcessingProfile(source.image).copy_memory();
+  return source;
+}
+
+/*
+  Resize a shared source by a further uniform factor, premultiplying any alpha channel,
+  so smaller outputs can be derived from it rather than from the full-size source.
+*/
+static PipelineSource ShrinkPipelineSource(PipelineSource const &from, double const shrink, PipelineBaton *baton) {
+  VImage image = from.image;
+  VipsBandFormat const format = image.format();
+  bool const hasAlpha = sharp::HasAlpha(image);
+  if (hasAlpha) {
+    image = image.premultiply();
+  }
+  image = image.resize(from.shrink / shrink, VImage::option()->set("kernel", baton->kernelType));
+  if (hasAlpha) {
+    image = image.unpremultiply().cast(format);
+  }
+  PipelineSource source;
+  source.image = image.copy_memory();
+  source.type = from.type;
+  source.shrink = from.shrink * static_cast<double>(from.image.width()) / source.image.width();
+  return source;
+}
+
+/*
+  The outputs of a multi-output pipeline and the source each one is derived from.
+*/
+struct PipelineMany {
+  std::vector<PipelineBaton*> outputs;
+  std::vector<PipelineSource> sources;
+};
+
+PipelineMany* PipelineManyOpen(PipelineBaton **batons, size_t count) {
+  std::vector<PipelineBaton*> const outputs(batons, batons + count);
+  std::vector<PipelineSource> sources(count);
+  try {
+    PipelineSource const master = OpenPipelineSource(outputs);
+    PipelineBaton *baton = outputs.front();
+
+    // The uniform shrink each output needs from the shared source
+    bool const swap = SwapsDimensions(baton, master.image);
+    std::vector<double> shrinks(count);
+    for (size_t i = 0; i < count; i++) {
+      double hshrink;
+      double vshrink;
+      std::tie(hshrink, vshrink) = sharp::ResolveShrink(
+        master.image.width(), master.image.height(), outputs[i]->width, outputs[i]->height,
+        outputs[i]->canvas, swap, outputs[i]->withoutEnlargement, outputs[i]->withoutReduction);
+      shrinks[i] = std::max(1.0, std::min(hshrink, vshrink));
+    }
+
+    // Derive each output from the smallest larger one already produced, as long as that still
+    // leaves at least a factor of two for its own resize step, otherwise from the shared source.
+    // Coordinates of trimming and pre-resize extraction, gamma correction and multi-page
+    // images all rely on seeing the full-size source, so these always use it.
+    bool const shouldCascade = sharp::GetPageHeight(master.image) == master.image.height() &&
+      !baton->rotateBeforePreExtract && baton->gamma == 0 && baton->topOffsetPre == -1 &&
+      baton->trimThreshold == 0.0;
+    std::vector<size_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&shrinks](size_t a, size_t b) {
+      return shrinks[a] < shrinks[b];
+    });
+    std::vector<PipelineSource> cascade { master };
+    for (size_t n = 0; n < count; n++) {
+      size_t const i = order[n];
+      size_t from = 0;
+      if (shouldCascade) {
+        for (size_t c = 1; c < cascade.size(); c++) {
+          if (shrinks[i] / cascade[c].shrink >= 2.0 && cascade[c].shrink > cascade[from].shrink) {
+            from = c;
+          }
+        }
+      }
+      sources[i] = cascade[from];
+      // Keep an intermediate at this size only when a smaller output can be derived from it
+      bool const isUseful = shouldCascade && shrinks[i] / cascade[from].shrink >= 2.0 &&
+        std::any_of(order.begin() + n + 1, order.end(), [&shrinks, i](size_t j) {
+          return shrinks[j] / shrinks[i] >= 2.0;
+        });
+      if (isUseful) {
+        PipelineSource const intermediate = ShrinkPipelineSource(cascade[from], shrinks[i], outputs[i]);
+        cascade.push_back(intermediate);
+      }
+    }
+  } catch (vips::VError const &err) {
+    char const *what = err.what();
+    for (PipelineBaton *output : outputs) {
+      (output->err).append(what && what[0] ? what : "Unknown error");
+      FillPipelineResult(output);
+    }
+    Error();
+    vips_thread_shutdown();
+    return nullptr;
+  }
+  return new PipelineMany { outputs, std::move(sources) };
+}
+
+void PipelineManyExecute(PipelineMany *many, size_t index) {
+  if (index < many->outputs.size()) {
+    RunPipeline(many->outputs[index], &many->sources[index]);
+    FillPipelineResult(many->outputs[index]);
+  }
+}
+
+void PipelineManyClose(PipelineMany *many) {
+  delete many;
+  Error();
+}
+
 Composite* CreateComposite() {
   return new Composite;
 }
@@ -1208,8 +1762,208 @@ void Composite_SetTile(Composite* composite, bool tile) { composite->tile = tile
 bool Composite_GetPremultiplied(Composite* composite) { return composite->premultiplied; }
 void Composite_SetPremultiplied(Composite* composite, bool premultiplied) { composite->premultiplied = premultiplied; }
 
-PipelineBaton* CreatePipelineBaton() {
-  return new PipelineBaton;
+/*
+  Force random access of the input for operations that require it.
+*/
+static void ForceRandomAccess(PipelineBaton *baton) {
+  if (baton->input != nullptr && baton->input->access == VIPS_ACCESS_SEQUENTIAL) {
+    if (
+      baton->trimThreshold > 0.0 ||
+      baton->normalise ||
+      baton->position == 16 || baton->position == 17 ||
+      baton->angle % 360 != 0 ||
+      fmod(baton->rotationAngle, 360.0) != 0.0 ||
+      baton->useExifOrientation
+    ) {
+      baton->input->access = VIPS_ACCESS_RANDOM;
+    }
+  }
+}
+
+PipelineBaton* CreatePipelineBaton(PipelineOptions* options, const char* strings) {
+  PipelineBaton *baton = new PipelineBaton;
+  // Input
+  baton->input = options->input;
+  // Extract image options
+  baton->topOffsetPre = options->topOffsetPre;
+  baton->leftOffsetPre = options->leftOffsetPre;
+  baton->widthPre = options->widthPre;
+  baton->heightPre = options->heightPre;
+  baton->topOffsetPost = options->topOffsetPost;
+  baton->leftOffsetPost = options->leftOffsetPost;
+  baton->widthPost = options->widthPost;
+  baton->heightPost = options->heightPost;
+  // Output image dimensions
+  baton->width = options->width;
+  baton->height = options->height;
+  baton->canvas = static_cast<sharp::Canvas>(options->canvas);
+  // Tint chroma
+  baton->tintA = options->tintA;
+  baton->tintB = options->tintB;
+  // Resize options
+  baton->withoutEnlargement = options->withoutEnlargement;
+  baton->withoutReduction = options->withoutReduction;
+  baton->position = options->position;
+  baton->resizeBackground = std::vector<double>(options->resizeBackground, options->resizeBackground + 4);
+  baton->kernel = strings + options->kernel;
+  baton->kernelType = ResolveKernel(baton->kernel);
+  baton->fastShrinkOnLoad = options->fastShrinkOnLoad;
+  baton->reorderTolerance = options->reorderTolerance;
+  baton->debugPlan = options->debugPlan;
+  // Operators
+  baton->flatten = options->flatten;
+  baton->flattenBackground = std::vector<double>(options->flattenBackground, options->flattenBackground + 3);
+  baton->negate = options->negate;
+  baton->negateAlpha = options->negateAlpha;
+  baton->blurSigma = options->blurSigma;
+  baton->brightness = options->brightness;
+  baton->saturation = options->saturation;
+  baton->hue = options->hue;
+  baton->lightness = options->lightness;
+  baton->medianSize = options->medianSize;
+  baton->sharpenSigma = options->sharpenSigma;
+  baton->sharpenM1 = options->sharpenM1;
+  baton->sharpenM2 = options->sharpenM2;
+  baton->sharpenX1 = options->sharpenX1;
+  baton->sharpenY2 = options->sharpenY2;
+  baton->sharpenY3 = options->sharpenY3;
+  baton->threshold = options->threshold;
+  baton->thresholdGrayscale = options->thresholdGrayscale;
+  baton->trimThreshold = options->trimThreshold;
+  baton->gamma = options->gamma;
+  baton->gammaOut = options->gammaOut;
+  baton->linearA = options->linearA;
+  baton->linearB = options->linearB;
+  baton->greyscale = options->greyscale;
+  baton->normalise = options->normalise;
+  baton->claheWidth = options->claheWidth;
+  baton->claheHeight = options->claheHeight;
+  baton->claheMaxSlope = options->claheMaxSlope;
+  baton->useExifOrientation = options->useExifOrientation;
+  baton->angle = options->angle;
+  baton->rotationAngle = options->rotationAngle;
+  baton->rotationBackground = std::vector<double>(options->rotationBackground, options->rotationBackground + 4);
+  baton->rotateBeforePreExtract = options->rotateBeforePreExtract;
+  baton->flip = options->flip;
+  baton->flop = options->flop;
+  baton->extendTop = options->extendTop;
+  baton->extendBottom = options->extendBottom;
+  baton->extendLeft = options->extendLeft;
+  baton->extendRight = options->extendRight;
+  baton->extendBackground = std::vector<double>(options->extendBackground, options->extendBackground + 4);
+  baton->extractChannel = options->extractChannel;
+  baton->affineMatrix = std::vector<double>(options->affineMatrix,
+    options->affineMatrix + std::min(options->affineMatrixSize, 4u));
+  baton->affineBackground = std::vector<double>(options->affineBackground, options->affineBackground + 4);
+  baton->affineIdx = options->affineIdx;
+  baton->affineIdy = options->affineIdy;
+  baton->affineOdx = options->affineOdx;
+  baton->affineOdy = options->affineOdy;
+  baton->affineInterpolator = strings + options->affineInterpolator;
+  baton->removeAlpha = options->removeAlpha;
+  baton->ensureAlpha = options->ensureAlpha;
+  baton->boolean = options->boolean;
+  baton->booleanOp = static_cast<VipsOperationBoolean>(options->booleanOp);
+  baton->bandBoolOp = static_cast<VipsOperationBoolean>(options->bandBoolOp);
+  baton->convKernelWidth = options->convKernelWidth;
+  baton->convKernelHeight = options->convKernelHeight;
+  baton->convKernelScale = options->convKernelScale;
+  baton->convKernelOffset = options->convKernelOffset;
+  if (options->hasRecombMatrix) {
+    baton->recombMatrix = std::vector<double>(options->recombMatrix, options->recombMatrix + 9);
+  }
+  baton->colourspaceInput = static_cast<VipsInterpretation>(options->colourspaceInput);
+  baton->colourspace = static_cast<VipsInterpretation>(options->colourspace);
+  baton->reduceEarly = options->reduceEarly;
+  // Output
+  baton->formatOut = strings + options->formatOut;
+  baton->fileOut = strings + options->fileOut;
+  baton->withMetadata = options->withMetadata;
+  baton->withMetadataOrientation = options->withMetadataOrientation;
+  baton->withMetadataDensity = options->withMetadataDensity;
+  baton->withMetadataIcc = strings + options->withMetadataIcc;
+  const char *mdStr = strings + options->withMetadataStrs;
+  for (unsigned int i = 0; i < options->withMetadataStrsCount; i++) {
+    std::string k(mdStr);
+    mdStr += k.size() + 1;
+    std::string v(mdStr);
+    mdStr += v.size() + 1;
+    baton->withMetadataStrs.insert(std::make_pair(k, v));
+  }
+  baton->timeoutSeconds = options->timeoutSeconds;
+  // Format-specific
+  baton->jpegQuality = options->jpegQuality;
+  baton->jpegProgressive = options->jpegProgressive;
+  baton->jpegChromaSubsampling = strings + options->jpegChromaSubsampling;
+  baton->jpegTrellisQuantisation = options->jpegTrellisQuantisation;
+  baton->jpegQuantisationTable = options->jpegQuantisationTable;
+  baton->jpegOvershootDeringing = options->jpegOvershootDeringing;
+  baton->jpegOptimiseScans = options->jpegOptimiseScans;
+  baton->jpegOptimiseCoding = options->jpegOptimiseCoding;
+  baton->pngProgressive = options->pngProgressive;
+  baton->pngCompressionLevel = options->pngCompressionLevel;
+  baton->pngAdaptiveFiltering = options->pngAdaptiveFiltering;
+  baton->pngPalette = options->pngPalette;
+  baton->pngQuality = options->pngQuality;
+  baton->pngEffort = options->pngEffort;
+  baton->pngBitdepth = options->pngBitdepth;
+  baton->pngDither = options->pngDither;
+  baton->jp2Quality = options->jp2Quality;
+  baton->jp2Lossless = options->jp2Lossless;
+  baton->jp2TileHeight = options->jp2TileHeight;
+  baton->jp2TileWidth = options->jp2TileWidth;
+  baton->jp2ChromaSubsampling = strings + options->jp2ChromaSubsampling;
+  baton->webpQuality = options->webpQuality;
+  baton->webpAlphaQuality = options->webpAlphaQuality;
+  baton->webpLossless = options->webpLossless;
+  baton->webpNearLossless = options->webpNearLossless;
+  baton->webpSmartSubsample = options->webpSmartSubsample;
+  baton->webpEffort = options->webpEffort;
+  baton->gifBitdepth = options->gifBitdepth;
+  baton->gifEffort = options->gifEffort;
+  baton->gifDither = options->gifDither;
+  baton->tiffQuality = options->tiffQuality;
+  baton->tiffPyramid = options->tiffPyramid;
+  baton->tiffBitdepth = options->tiffBitdepth;
+  baton->tiffTile = options->tiffTile;
+  baton->tiffTileWidth = options->tiffTileWidth;
+  baton->tiffTileHeight = options->tiffTileHeight;
+  baton->tiffXres = options->tiffXres;
+  baton->tiffYres = options->tiffYres;
+  baton->tiffCompression = static_cast<VipsForeignTiffCompression>(options->tiffCompression);
+  baton->tiffPredictor = static_cast<VipsForeignTiffPredictor>(options->tiffPredictor);
+  baton->tiffResolutionUnit = static_cast<VipsForeignTiffResunit>(options->tiffResolutionUnit);
+  baton->heifQuality = options->heifQuality;
+  baton->heifLossless = options->heifLossless;
+  baton->heifCompression = static_cast<VipsForeignHeifCompression>(options->heifCompression);
+  baton->heifEffort = options->heifEffort;
+  baton->heifChromaSubsampling = strings + options->heifChromaSubsampling;
+  // Raw output
+  baton->rawDepth = static_cast<VipsBandFormat>(options->rawDepth);
+  // Animated output properties
+  baton->loop = options->loop;
+  // Tile output
+  baton->tileSize = options->tileSize;
+  baton->tileOverlap = options->tileOverlap;
+  baton->tileAngle = options->tileAngle;
+  baton->tileBackground = std::vector<double>(options->tileBackground, options->tileBackground + 4);
+  baton->tileSkipBlanks = options->tileSkipBlanks;
+  baton->tileContainer = static_cast<VipsForeignDzContainer>(options->tileContainer);
+  baton->tileLayout = static_cast<VipsForeignDzLayout>(options->tileLayout);
+  baton->tileFormat = strings + options->tileFormat;
+  baton->tileDepth = static_cast<VipsForeignDzDepth>(options->tileDepth);
+  baton->tileCentre = options->tileCentre;
+  baton->tileId = strings + options->tileId;
+
+  ForceRandomAccess(baton);
+  return baton;
+}
+
+PipelineBaton* ClonePipelineBaton(PipelineBaton* prototype, InputDescriptor* input) {
+  PipelineBaton *baton = new PipelineBaton(*prototype);
+  baton->input = input;
+  ForceRandomAccess(baton);
+  return baton;
 }
 
 void DestroyPipelineBaton(PipelineBaton* baton) {
@@ -1225,338 +1979,12 @@ void DestroyPipelineBaton(PipelineBaton* baton) {
   delete baton;
 }
 
-InputDescriptor* PipelineBaton_GetInput(PipelineBaton* baton) { return baton->input; }
 void PipelineBaton_SetInput(PipelineBaton* baton, InputDescriptor* val) { baton->input = val; }
-const char* PipelineBaton_GetFormatOut(PipelineBaton* baton) { return baton->formatOut.c_str(); }
-void PipelineBaton_SetFormatOut(PipelineBaton* baton, const char* val) { baton->formatOut = val; }
-const char* PipelineBaton_GetFileOut(PipelineBaton* baton) { return baton->fileOut.c_str(); }
-void PipelineBaton_SetFileOut(PipelineBaton* baton, const char* val) { baton->fileOut = val; }
-void* PipelineBaton_GetBufferOut(PipelineBaton* baton) { return baton->bufferOut; }
-void PipelineBaton_SetBufferOut(PipelineBaton* baton, void* val) { baton->bufferOut = val; }
-size_t PipelineBaton_GetBufferOutLength(PipelineBaton* baton) { return baton->bufferOutLength; }
-void PipelineBaton_SetBufferOutLength(PipelineBaton* baton, size_t val) { baton->bufferOutLength = val; }
-Composite ** PipelineBaton_GetComposite(PipelineBaton* baton) { return baton->composite.data(); }
-void PipelineBaton_SetComposite(PipelineBaton* baton, Composite ** val, size_t count) { baton->composite = std::vector<Composite*>(val, val + count); }
-InputDescriptor ** PipelineBaton_GetJoinChannelIn(PipelineBaton* baton) { return baton->joinChannelIn.data(); }
-void PipelineBaton_SetJoinChannelIn(PipelineBaton* baton, InputDescriptor ** val, size_t count) { baton->joinChannelIn = std::vector<InputDescriptor*>(val, val + count); }
-int PipelineBaton_GetTopOffsetPre(PipelineBaton* baton) { return baton->topOffsetPre; }
-void PipelineBaton_SetTopOffsetPre(PipelineBaton* baton, int val) { baton->topOffsetPre = val; }
-int PipelineBaton_GetLeftOffsetPre(PipelineBaton* baton) { return baton->leftOffsetPre; }
-void PipelineBaton_SetLeftOffsetPre(PipelineBaton* baton, int val) { baton->leftOffsetPre = val; }
-int PipelineBaton_GetWidthPre(PipelineBaton* baton) { return baton->widthPre; }
-void PipelineBaton_SetWidthPre(PipelineBaton* baton, int val) { baton->widthPre = val; }
-int PipelineBaton_GetHeightPre(PipelineBaton* baton) { return baton->heightPre; }
-void PipelineBaton_SetHeightPre(PipelineBaton* baton, int val) { baton->heightPre = val; }
-int PipelineBaton_GetTopOffsetPost(PipelineBaton* baton) { return baton->topOffsetPost; }
-void PipelineBaton_SetTopOffsetPost(PipelineBaton* baton, int val) { baton->topOffsetPost = val; }
-int PipelineBaton_GetLeftOffsetPost(PipelineBaton* baton) { return baton->leftOffsetPost; }
-void PipelineBaton_SetLeftOffsetPost(PipelineBaton* baton, int val) { baton->leftOffsetPost = val; }
-int PipelineBaton_GetWidthPost(PipelineBaton* baton) { return baton->widthPost; }
-void PipelineBaton_SetWidthPost(PipelineBaton* baton, int val) { baton->widthPost = val; }
-int PipelineBaton_GetHeightPost(PipelineBaton* baton) { return baton->heightPost; }
-void PipelineBaton_SetHeightPost(PipelineBaton* baton, int val) { baton->heightPost = val; }
-int PipelineBaton_GetWidth(PipelineBaton* baton) { return baton->width; }
-void PipelineBaton_SetWidth(PipelineBaton* baton, int val) { baton->width = val; }
-int PipelineBaton_GetHeight(PipelineBaton* baton) { return baton->height; }
-void PipelineBaton_SetHeight(PipelineBaton* baton, int val) { baton->height = val; }
-int PipelineBaton_GetChannels(PipelineBaton* baton) { return baton->channels; }
-void PipelineBaton_SetChannels(PipelineBaton* baton, int val) { baton->channels = val; }
-sharp::Canvas PipelineBaton_GetCanvas(PipelineBaton* baton) { return baton->canvas; }
-void PipelineBaton_SetCanvas(PipelineBaton* baton, sharp::Canvas val) { baton->canvas = val; }
-int PipelineBaton_GetPosition(PipelineBaton* baton) { return baton->position; }
-void PipelineBaton_SetPosition(PipelineBaton* baton, int val) { baton->position = val; }
-double* PipelineBaton_GetResizeBackground(PipelineBaton* baton) { return baton->resizeBackground.data(); }
-void PipelineBaton_SetResizeBackground(PipelineBaton* baton, double* val, size_t count) { baton->resizeBackground = std::vector<double>(val, val + count); }
-bool PipelineBaton_GetHasCropOffset(PipelineBaton* baton) { return baton->hasCropOffset; }
-void PipelineBaton_SetHasCropOffset(PipelineBaton* baton, bool val) { baton->hasCropOffset = val; }
-int PipelineBaton_GetCropOffsetLeft(PipelineBaton* baton) { return baton->cropOffsetLeft; }
-void PipelineBaton_SetCropOffsetLeft(PipelineBaton* baton, int val) { baton->cropOffsetLeft = val; }
-int PipelineBaton_GetCropOffsetTop(PipelineBaton* baton) { return baton->cropOffsetTop; }
-void PipelineBaton_SetCropOffsetTop(PipelineBaton* baton, int val) { baton->cropOffsetTop = val; }
-bool PipelineBaton_GetPremultiplied(PipelineBaton* baton) { return baton->premultiplied; }
-void PipelineBaton_SetPremultiplied(PipelineBaton* baton, bool val) { baton->premultiplied = val; }
-bool PipelineBaton_GetTileCentre(PipelineBaton* baton) { return baton->tileCentre; }
-void PipelineBaton_SetTileCentre(PipelineBaton* baton, bool val) { baton->tileCentre = val; }
-const char* PipelineBaton_GetKernel(PipelineBaton* baton) { return baton->kernel.c_str(); }
-void PipelineBaton_SetKernel(PipelineBaton* baton, const char* val) { baton->kernel = val; }
-bool PipelineBaton_GetFastShrinkOnLoad(PipelineBaton* baton) { return baton->fastShrinkOnLoad; }
-void PipelineBaton_SetFastShrinkOnLoad(PipelineBaton* baton, bool val) { baton->fastShrinkOnLoad = val; }
-double PipelineBaton_GetTintA(PipelineBaton* baton) { return baton->tintA; }
-void PipelineBaton_SetTintA(PipelineBaton* baton, double val) { baton->tintA = val; }
-double PipelineBaton_GetTintB(PipelineBaton* baton) { return baton->tintB; }
-void PipelineBaton_SetTintB(PipelineBaton* baton, double val) { baton->tintB = val; }
-bool PipelineBaton_GetFlatten(PipelineBaton* baton) { return baton->flatten; }
-void PipelineBaton_SetFlatten(PipelineBaton* baton, bool val) { baton->flatten = val; }
-double* PipelineBaton_GetFlattenBackground(PipelineBaton* baton) { return baton->flattenBackground.data(); }
-void PipelineBaton_SetFlattenBackground(PipelineBaton* baton, double* val, size_t count) { baton->flattenBackground = std::vector<double>(val, val + count); }
-bool PipelineBaton_GetNegate(PipelineBaton* baton) { return baton->negate; }
-void PipelineBaton_SetNegate(PipelineBaton* baton, bool val) { baton->negate = val; }
-bool PipelineBaton_GetNegateAlpha(PipelineBaton* baton) { return baton->negateAlpha; }
-void PipelineBaton_SetNegateAlpha(PipelineBaton* baton, bool val) { baton->negateAlpha = val; }
-double PipelineBaton_GetBlurSigma(PipelineBaton* baton) { return baton->blurSigma; }
-void PipelineBaton_SetBlurSigma(PipelineBaton* baton, double val) { baton->blurSigma = val; }
-double PipelineBaton_GetBrightness(PipelineBaton* baton) { return baton->brightness; }
-void PipelineBaton_SetBrightness(PipelineBaton* baton, double val) { baton->brightness = val; }
-double PipelineBaton_GetSaturation(PipelineBaton* baton) { return baton->saturation; }
-void PipelineBaton_SetSaturation(PipelineBaton* baton, double val) { baton->saturation = val; }
-int PipelineBaton_GetHue(PipelineBaton* baton) { return baton->hue; }
-void PipelineBaton_SetHue(PipelineBaton* baton, int val) { baton->hue = val; }
-double PipelineBaton_GetLightness(PipelineBaton* baton) { return baton->lightness; }
-void PipelineBaton_SetLightness(PipelineBaton* baton, double val) { baton->lightness = val; }
-int PipelineBaton_GetMedianSize(PipelineBaton* baton) { return baton->medianSize; }
-void PipelineBaton_SetMedianSize(PipelineBaton* baton, int val) { baton->medianSize = val; }
-double PipelineBaton_GetSharpenSigma(PipelineBaton* baton) { return baton->sharpenSigma; }
-void PipelineBaton_SetSharpenSigma(PipelineBaton* baton, double val) { baton->sharpenSigma = val; }
-double PipelineBaton_GetSharpenM1(PipelineBaton* baton) { return baton->sharpenM1; }
-void PipelineBaton_SetSharpenM1(PipelineBaton* baton, double val) { baton->sharpenM1 = val; }
-double PipelineBaton_GetSharpenM2(PipelineBaton* baton) { return baton->sharpenM2; }
-void PipelineBaton_SetSharpenM2(PipelineBaton* baton, double val) { baton->sharpenM2 = val; }
-double PipelineBaton_GetSharpenX1(PipelineBaton* baton) { return baton->sharpenX1; }
-void PipelineBaton_SetSharpenX1(PipelineBaton* baton, double val) { baton->sharpenX1 = val; }
-double PipelineBaton_GetSharpenY2(PipelineBaton* baton) { return baton->sharpenY2; }
-void PipelineBaton_SetSharpenY2(PipelineBaton* baton, double val) { baton->sharpenY2 = val; }
-double PipelineBaton_GetSharpenY3(PipelineBaton* baton) { return baton->sharpenY3; }
-void PipelineBaton_SetSharpenY3(PipelineBaton* baton, double val) { baton->sharpenY3 = val; }
-int PipelineBaton_GetThreshold(PipelineBaton* baton) { return baton->threshold; }
-void PipelineBaton_SetThreshold(PipelineBaton* baton, int val) { baton->threshold = val; }
-bool PipelineBaton_GetThresholdGrayscale(PipelineBaton* baton) { return baton->thresholdGrayscale; }
-void PipelineBaton_SetThresholdGrayscale(PipelineBaton* baton, bool val) { baton->thresholdGrayscale = val; }
-double PipelineBaton_GetTrimThreshold(PipelineBaton* baton) { return baton->trimThreshold; }
-void PipelineBaton_SetTrimThreshold(PipelineBaton* baton, double val) { baton->trimThreshold = val; }
-int PipelineBaton_GetTrimOffsetLeft(PipelineBaton* baton) { return baton->trimOffsetLeft; }
-void PipelineBaton_SetTrimOffsetLeft(PipelineBaton* baton, int val) { baton->trimOffsetLeft = val; }
-int PipelineBaton_GetTrimOffsetTop(PipelineBaton* baton) { return baton->trimOffsetTop; }
-void PipelineBaton_SetTrimOffsetTop(PipelineBaton* baton, int val) { baton->trimOffsetTop = val; }
-double PipelineBaton_GetLinearA(PipelineBaton* baton) { return baton->linearA; }
-void PipelineBaton_SetLinearA(PipelineBaton* baton, double val) { baton->linearA = val; }
-double PipelineBaton_GetLinearB(PipelineBaton* baton) { return baton->linearB; }
-void PipelineBaton_SetLinearB(PipelineBaton* baton, double val) { baton->linearB = val; }
-double PipelineBaton_GetGamma(PipelineBaton* baton) { return baton->gamma; }
-void PipelineBaton_SetGamma(PipelineBaton* baton, double val) { baton->gamma = val; }
-double PipelineBaton_GetGammaOut(PipelineBaton* baton) { return baton->gammaOut; }
-void PipelineBaton_SetGammaOut(PipelineBaton* baton, double val) { baton->gammaOut = val; }
-bool PipelineBaton_GetGreyscale(PipelineBaton* baton) { return baton->greyscale; }
-void PipelineBaton_SetGreyscale(PipelineBaton* baton, bool val) { baton->greyscale = val; }
-bool PipelineBaton_GetNormalise(PipelineBaton* baton) { return baton->normalise; }
-void PipelineBaton_SetNormalise(PipelineBaton* baton, bool val) { baton->normalise = val; }
-int PipelineBaton_GetClaheWidth(PipelineBaton* baton) { return baton->claheWidth; }
-void PipelineBaton_SetClaheWidth(PipelineBaton* baton, int val) { baton->claheWidth = val; }
-int PipelineBaton_GetClaheHeight(PipelineBaton* baton) { return baton->claheHeight; }
-void PipelineBaton_SetClaheHeight(PipelineBaton* baton, int val) { baton->claheHeight = val; }
-int PipelineBaton_GetClaheMaxSlope(PipelineBaton* baton) { return baton->claheMaxSlope; }
-void PipelineBaton_SetClaheMaxSlope(PipelineBaton* baton, int val) { baton->claheMaxSlope = val; }
-bool PipelineBaton_GetUseExifOrientation(PipelineBaton* baton) { return baton->useExifOrientation; }
-void PipelineBaton_SetUseExifOrientation(PipelineBaton* baton, bool val) { baton->useExifOrientation = val; }
-int PipelineBaton_GetAngle(PipelineBaton* baton) { return baton->angle; }
-void PipelineBaton_SetAngle(PipelineBaton* baton, int val) { baton->angle = val; }
-double PipelineBaton_GetRotationAngle(PipelineBaton* baton) { return baton->rotationAngle; }
-void PipelineBaton_SetRotationAngle(PipelineBaton* baton, double val) { baton->rotationAngle = val; }
-double* PipelineBaton_GetRotationBackground(PipelineBaton* baton) { return baton->rotationBackground.data(); }
-void PipelineBaton_SetRotationBackground(PipelineBaton* baton, double* val, size_t count) { baton->rotationBackground = std::vector<double>(val, val + count); }
-bool PipelineBaton_GetRotateBeforePreExtract(PipelineBaton* baton) { return baton->rotateBeforePreExtract; }
-void PipelineBaton_SetRotateBeforePreExtract(PipelineBaton* baton, bool val) { baton->rotateBeforePreExtract = val; }
-bool PipelineBaton_GetFlip(PipelineBaton* baton) { return baton->flip; }
-void PipelineBaton_SetFlip(PipelineBaton* baton, bool val) { baton->flip = val; }
-bool PipelineBaton_GetFlop(PipelineBaton* baton) { return baton->flop; }
-void PipelineBaton_SetFlop(PipelineBaton* baton, bool val) { baton->flop = val; }
-int PipelineBaton_GetExtendTop(PipelineBaton* baton) { return baton->extendTop; }
-void PipelineBaton_SetExtendTop(PipelineBaton* baton, int val) { baton->extendTop = val; }
-int PipelineBaton_GetExtendBottom(PipelineBaton* baton) { return baton->extendBottom; }
-void PipelineBaton_SetExtendBottom(PipelineBaton* baton, int val) { baton->extendBottom = val; }
-int PipelineBaton_GetExtendLeft(PipelineBaton* baton) { return baton->extendLeft; }
-void PipelineBaton_SetExtendLeft(PipelineBaton* baton, int val) { baton->extendLeft = val; }
-int PipelineBaton_GetExtendRight(PipelineBaton* baton) { return baton->extendRight; }
-void PipelineBaton_SetExtendRight(PipelineBaton* baton, int val) { baton->extendRight = val; }
-double* PipelineBaton_GetExtendBackground(PipelineBaton* baton) { return baton->extendBackground.data(); }
-void PipelineBaton_SetExtendBackground(PipelineBaton* baton, double* val, size_t count) { baton->extendBackground = std::vector<double>(val, val + count); }
-bool PipelineBaton_GetWithoutEnlargement(PipelineBaton* baton) { return baton->withoutEnlargement; }
-void PipelineBaton_SetWithoutEnlargement(PipelineBaton* baton, bool val) { baton->withoutEnlargement = val; }
-bool PipelineBaton_GetWithoutReduction(PipelineBaton* baton) { return baton->withoutReduction; }
-void PipelineBaton_SetWithoutReduction(PipelineBaton* baton, bool val) { baton->withoutReduction = val; }
-double* PipelineBaton_GetAffineMatrix(PipelineBaton* baton) { return baton->affineMatrix.data(); }
-void PipelineBaton_SetAffineMatrix(PipelineBaton* baton, double* val, size_t count) { baton->affineMatrix = std::vector<double>(val, val + count); }
-double* PipelineBaton_GetAffineBackground(PipelineBaton* baton) { return baton->affineBackground.data(); }
-void PipelineBaton_SetAffineBackground(PipelineBaton* baton, double* val, size_t count) { baton->affineBackground = std::vector<double>(val, val + count); }
-double PipelineBaton_GetAffineIdx(PipelineBaton* baton) { return baton->affineIdx; }
-void PipelineBaton_SetAffineIdx(PipelineBaton* baton, double val) { baton->affineIdx = val; }
-double PipelineBaton_GetAffineIdy(PipelineBaton* baton) { return baton->affineIdy; }
-void PipelineBaton_SetAffineIdy(PipelineBaton* baton, double val) { baton->affineIdy = val; }
-double PipelineBaton_GetAffineOdx(PipelineBaton* baton) { return baton->affineOdx; }
-void PipelineBaton_SetAffineOdx(PipelineBaton* baton, double val) { baton->affineOdx = val; }
-double PipelineBaton_GetAffineOdy(PipelineBaton* baton) { return baton->affineOdy; }
-void PipelineBaton_SetAffineOdy(PipelineBaton* baton, double val) { baton->affineOdy = val; }
-const char* PipelineBaton_GetAffineInterpolator(PipelineBaton* baton) { return baton->affineInterpolator.c_str(); }
-void PipelineBaton_SetAffineInterpolator(PipelineBaton* baton, const char* val) { baton->affineInterpolator = val; }
-int PipelineBaton_GetJpegQuality(PipelineBaton* baton) { return baton->jpegQuality; }
-void PipelineBaton_SetJpegQuality(PipelineBaton* baton, int val) { baton->jpegQuality = val; }
-bool PipelineBaton_GetJpegProgressive(PipelineBaton* baton) { return baton->jpegProgressive; }
-void PipelineBaton_SetJpegProgressive(PipelineBaton* baton, bool val) { baton->jpegProgressive = val; }
-const char* PipelineBaton_GetJpegChromaSubsampling(PipelineBaton* baton) { return baton->jpegChromaSubsampling.c_str(); }
-void PipelineBaton_SetJpegChromaSubsampling(PipelineBaton* baton, const char* val) { baton->jpegChromaSubsampling = val; }
-bool PipelineBaton_GetJpegTrellisQuantisation(PipelineBaton* baton) { return baton->jpegTrellisQuantisation; }
-void PipelineBaton_SetJpegTrellisQuantisation(PipelineBaton* baton, bool val) { baton->jpegTrellisQuantisation = val; }
-int PipelineBaton_GetJpegQuantisationTable(PipelineBaton* baton) { return baton->jpegQuantisationTable; }
-void PipelineBaton_SetJpegQuantisationTable(PipelineBaton* baton, int val) { baton->jpegQuantisationTable = val; }
-bool PipelineBaton_GetJpegOvershootDeringing(PipelineBaton* baton) { return baton->jpegOvershootDeringing; }
-void PipelineBaton_SetJpegOvershootDeringing(PipelineBaton* baton, bool val) { baton->jpegOvershootDeringing = val; }
-bool PipelineBaton_GetJpegOptimiseScans(PipelineBaton* baton) { return baton->jpegOptimiseScans; }
-void PipelineBaton_SetJpegOptimiseScans(PipelineBaton* baton, bool val) { baton->jpegOptimiseScans = val; }
-bool PipelineBaton_GetJpegOptimiseCoding(PipelineBaton* baton) { return baton->jpegOptimiseCoding; }
-void PipelineBaton_SetJpegOptimiseCoding(PipelineBaton* baton, bool val) { baton->jpegOptimiseCoding = val; }
-bool PipelineBaton_GetPngProgressive(PipelineBaton* baton) { return baton->pngProgressive; }
-void PipelineBaton_SetPngProgressive(PipelineBaton* baton, bool val) { baton->pngProgressive = val; }
-int PipelineBaton_GetPngCompressionLevel(PipelineBaton* baton) { return baton->pngCompressionLevel; }
-void PipelineBaton_SetPngCompressionLevel(PipelineBaton* baton, int val) { baton->pngCompressionLevel = val; }
-bool PipelineBaton_GetPngAdaptiveFiltering(PipelineBaton* baton) { return baton->pngAdaptiveFiltering; }
-void PipelineBaton_SetPngAdaptiveFiltering(PipelineBaton* baton, bool val) { baton->pngAdaptiveFiltering = val; }
-bool PipelineBaton_GetPngPalette(PipelineBaton* baton) { return baton->pngPalette; }
-void PipelineBaton_SetPngPalette(PipelineBaton* baton, bool val) { baton->pngPalette = val; }
-int PipelineBaton_GetPngQuality(PipelineBaton* baton) { return baton->pngQuality; }
-void PipelineBaton_SetPngQuality(PipelineBaton* baton, int val) { baton->pngQuality = val; }
-int PipelineBaton_GetPngEffort(PipelineBaton* baton) { return baton->pngEffort; }
-void PipelineBaton_SetPngEffort(PipelineBaton* baton, int val) { baton->pngEffort = val; }
-int PipelineBaton_GetPngBitdepth(PipelineBaton* baton) { return baton->pngBitdepth; }
-void PipelineBaton_SetPngBitdepth(PipelineBaton* baton, int val) { baton->pngBitdepth = val; }
-double PipelineBaton_GetPngDither(PipelineBaton* baton) { return baton->pngDither; }
-void PipelineBaton_SetPngDither(PipelineBaton* baton, double val) { baton->pngDither = val; }
-int PipelineBaton_GetJp2Quality(PipelineBaton* baton) { return baton->jp2Quality; }
-void PipelineBaton_SetJp2Quality(PipelineBaton* baton, int val) { baton->jp2Quality = val; }
-bool PipelineBaton_GetJp2Lossless(PipelineBaton* baton) { return baton->jp2Lossless; }
-void PipelineBaton_SetJp2Lossless(PipelineBaton* baton, bool val) { baton->jp2Lossless = val; }
-int PipelineBaton_GetJp2TileHeight(PipelineBaton* baton) { return baton->jp2TileHeight; }
-void PipelineBaton_SetJp2TileHeight(PipelineBaton* baton, int val) { baton->jp2TileHeight = val; }
-int PipelineBaton_GetJp2TileWidth(PipelineBaton* baton) { return baton->jp2TileWidth; }
-void PipelineBaton_SetJp2TileWidth(PipelineBaton* baton, int val) { baton->jp2TileWidth = val; }
-const char* PipelineBaton_GetJp2ChromaSubsampling(PipelineBaton* baton) { return baton->jp2ChromaSubsampling.c_str(); }
-void PipelineBaton_SetJp2ChromaSubsampling(PipelineBaton* baton, const char* val) { baton->jp2ChromaSubsampling = val; }
-int PipelineBaton_GetWebpQuality(PipelineBaton* baton) { return baton->webpQuality; }
-void PipelineBaton_SetWebpQuality(PipelineBaton* baton, int val) { baton->webpQuality = val; }
-int PipelineBaton_GetWebpAlphaQuality(PipelineBaton* baton) { return baton->webpAlphaQuality; }
-void PipelineBaton_SetWebpAlphaQuality(PipelineBaton* baton, int val) { baton->webpAlphaQuality = val; }
-bool PipelineBaton_GetWebpNearLossless(PipelineBaton* baton) { return baton->webpNearLossless; }
-void PipelineBaton_SetWebpNearLossless(PipelineBaton* baton, bool val) { baton->webpNearLossless = val; }
-bool PipelineBaton_GetWebpLossless(PipelineBaton* baton) { return baton->webpLossless; }
-void PipelineBaton_SetWebpLossless(PipelineBaton* baton, bool val) { baton->webpLossless = val; }
-bool PipelineBaton_GetWebpSmartSubsample(PipelineBaton* baton) { return baton->webpSmartSubsample; }
-void PipelineBaton_SetWebpSmartSubsample(PipelineBaton* baton, bool val) { baton->webpSmartSubsample = val; }
-int PipelineBaton_GetWebpEffort(PipelineBaton* baton) { return baton->webpEffort; }
-void PipelineBaton_SetWebpEffort(PipelineBaton* baton, int val) { baton->webpEffort = val; }
-int PipelineBaton_GetGifBitdepth(PipelineBaton* baton) { return baton->gifBitdepth; }
-void PipelineBaton_SetGifBitdepth(PipelineBaton* baton, int val) { baton->gifBitdepth = val; }
-int PipelineBaton_GetGifEffort(PipelineBaton* baton) { return baton->gifEffort; }
-void PipelineBaton_SetGifEffort(PipelineBaton* baton, int val) { baton->gifEffort = val; }
-double PipelineBaton_GetGifDither(PipelineBaton* baton) { return baton->gifDither; }
-void PipelineBaton_SetGifDither(PipelineBaton* baton, double val) { baton->gifDither = val; }
-int PipelineBaton_GetTiffQuality(PipelineBaton* baton) { return baton->tiffQuality; }
-void PipelineBaton_SetTiffQuality(PipelineBaton* baton, int val) { baton->tiffQuality = val; }
-VipsForeignTiffCompression PipelineBaton_GetTiffCompression(PipelineBaton* baton) { return baton->tiffCompression; }
-void PipelineBaton_SetTiffCompression(PipelineBaton* baton, VipsForeignTiffCompression val) { baton->tiffCompression = val; }
-VipsForeignTiffPredictor PipelineBaton_GetTiffPredictor(PipelineBaton* baton) { return baton->tiffPredictor; }
-void PipelineBaton_SetTiffPredictor(PipelineBaton* baton, VipsForeignTiffPredictor val) { baton->tiffPredictor = val; }
-bool PipelineBaton_GetTiffPyramid(PipelineBaton* baton) { return baton->tiffPyramid; }
-void PipelineBaton_SetTiffPyramid(PipelineBaton* baton, bool val) { baton->tiffPyramid = val; }
-int PipelineBaton_GetTiffBitdepth(PipelineBaton* baton) { return baton->tiffBitdepth; }
-void PipelineBaton_SetTiffBitdepth(PipelineBaton* baton, int val) { baton->tiffBitdepth = val; }
-bool PipelineBaton_GetTiffTile(PipelineBaton* baton) { return baton->tiffTile; }
-void PipelineBaton_SetTiffTile(PipelineBaton* baton, bool val) { baton->tiffTile = val; }
-int PipelineBaton_GetTiffTileHeight(PipelineBaton* baton) { return baton->tiffTileHeight; }
-void PipelineBaton_SetTiffTileHeight(PipelineBaton* baton, int val) { baton->tiffTileHeight = val; }
-int PipelineBaton_GetTiffTileWidth(PipelineBaton* baton) { return baton->tiffTileWidth; }
-void PipelineBaton_SetTiffTileWidth(PipelineBaton* baton, int val) { baton->tiffTileWidth = val; }
-double PipelineBaton_GetTiffXres(PipelineBaton* baton) { return baton->tiffXres; }
-void PipelineBaton_SetTiffXres(PipelineBaton* baton, double val) { baton->tiffXres = val; }
-double PipelineBaton_GetTiffYres(PipelineBaton* baton) { return baton->tiffYres; }
-void PipelineBaton_SetTiffYres(PipelineBaton* baton, double val) { baton->tiffYres = val; }
-VipsForeignTiffResunit PipelineBaton_GetTiffResolutionUnit(PipelineBaton* baton) { return baton->tiffResolutionUnit; }
-void PipelineBaton_SetTiffResolutionUnit(PipelineBaton* baton, VipsForeignTiffResunit val) { baton->tiffResolutionUnit = val; }
-int PipelineBaton_GetHeifQuality(PipelineBaton* baton) { return baton->heifQuality; }
-void PipelineBaton_SetHeifQuality(PipelineBaton* baton, int val) { baton->heifQuality = val; }
-VipsForeignHeifCompression PipelineBaton_GetHeifCompression(PipelineBaton* baton) { return baton->heifCompression; }
-void PipelineBaton_SetHeifCompression(PipelineBaton* baton, VipsForeignHeifCompression val) { baton->heifCompression = val; }
-int PipelineBaton_GetHeifEffort(PipelineBaton* baton) { return baton->heifEffort; }
-void PipelineBaton_SetHeifEffort(PipelineBaton* baton, int val) { baton->heifEffort = val; }
-const char* PipelineBaton_GetHeifChromaSubsampling(PipelineBaton* baton) { return baton->heifChromaSubsampling.c_str(); }
-void PipelineBaton_SetHeifChromaSubsampling(PipelineBaton* baton, const char* val) { baton->heifChromaSubsampling = val; }
-bool PipelineBaton_GetHeifLossless(PipelineBaton* baton) { return baton->heifLossless; }
-void PipelineBaton_SetHeifLossless(PipelineBaton* baton, bool val) { baton->heifLossless = val; }
-VipsBandFormat PipelineBaton_GetRawDepth(PipelineBaton* baton) { return baton->rawDepth; }
-void PipelineBaton_SetRawDepth(PipelineBaton* baton, VipsBandFormat val) { baton->rawDepth = val; }
-const char* PipelineBaton_GetErr(PipelineBaton* baton) { return baton->err.c_str(); }
-void PipelineBaton_SetErr(PipelineBaton* baton, const char* val) { baton->err = val; }
-bool PipelineBaton_GetWithMetadata(PipelineBaton* baton) { return baton->withMetadata; }
-void PipelineBaton_SetWithMetadata(PipelineBaton* baton, bool val) { baton->withMetadata = val; }
-int PipelineBaton_GetWithMetadataOrientation(PipelineBaton* baton) { return baton->withMetadataOrientation; }
-void PipelineBaton_SetWithMetadataOrientation(PipelineBaton* baton, int val) { baton->withMetadataOrientation = val; }
-double PipelineBaton_GetWithMetadataDensity(PipelineBaton* baton) { return baton->withMetadataDensity; }
-void PipelineBaton_SetWithMetadataDensity(PipelineBaton* baton, double val) { baton->withMetadataDensity = val; }
-const char* PipelineBaton_GetWithMetadataIcc(PipelineBaton* baton) { return baton->withMetadataIcc.c_str(); }
-void PipelineBaton_SetWithMetadataIcc(PipelineBaton* baton, const char* val) { baton->withMetadataIcc = val; }
-std::unordered_map<std::string, std::string> PipelineBaton_GetWithMetadataStrs(PipelineBaton* baton) { return baton->withMetadataStrs; }
-void PipelineBaton_SetWithMetadataStrs(PipelineBaton* baton, std::unordered_map<std::string, std::string> val) { baton->withMetadataStrs = val; }
-int PipelineBaton_GetTimeoutSeconds(PipelineBaton* baton) { return baton->timeoutSeconds; }
-void PipelineBaton_SetTimeoutSeconds(PipelineBaton* baton, int val) { baton->timeoutSeconds = val; }
-double* PipelineBaton_GetConvKernel(PipelineBaton* baton) { return baton->convKernel.get(); }
-void PipelineBaton_SetConvKernelSize(PipelineBaton* baton, unsigned int size) { baton->convKernel = std::unique_ptr<double[]>(new double[size]); }
-int PipelineBaton_GetConvKernelWidth(PipelineBaton* baton) { return baton->convKernelWidth; }
-void PipelineBaton_SetConvKernelWidth(PipelineBaton* baton, int val) { baton->convKernelWidth = val; }
-int PipelineBaton_GetConvKernelHeight(PipelineBaton* baton) { return baton->convKernelHeight; }
-void PipelineBaton_SetConvKernelHeight(PipelineBaton* baton, int val) { baton->convKernelHeight = val; }
-double PipelineBaton_GetConvKernelScale(PipelineBaton* baton) { return baton->convKernelScale; }
-void PipelineBaton_SetConvKernelScale(PipelineBaton* baton, double val) { baton->convKernelScale = val; }
-double PipelineBaton_GetConvKernelOffset(PipelineBaton* baton) { return baton->convKernelOffset; }
-void PipelineBaton_SetConvKernelOffset(PipelineBaton* baton, double val) { baton->convKernelOffset = val; }
-InputDescriptor* PipelineBaton_GetBoolean(PipelineBaton* baton) { return baton->boolean; }
-void PipelineBaton_SetBoolean(PipelineBaton* baton, InputDescriptor* val) { baton->boolean = val; }
-VipsOperationBoolean PipelineBaton_GetBooleanOp(PipelineBaton* baton) { return baton->booleanOp; }
-void PipelineBaton_SetBooleanOp(PipelineBaton* baton, VipsOperationBoolean val) { baton->booleanOp = val; }
-VipsOperationBoolean PipelineBaton_GetBandBoolOp(PipelineBaton* baton) { return baton->bandBoolOp; }
-void PipelineBaton_SetBandBoolOp(PipelineBaton* baton, VipsOperationBoolean val) { baton->bandBoolOp = val; }
-int PipelineBaton_GetExtractChannel(PipelineBaton* baton) { return baton->extractChannel; }
-void PipelineBaton_SetExtractChannel(PipelineBaton* baton, int val) { baton->extractChannel = val; }
-bool PipelineBaton_GetRemoveAlpha(PipelineBaton* baton) { return baton->removeAlpha; }
-void PipelineBaton_SetRemoveAlpha(PipelineBaton* baton, bool val) { baton->removeAlpha = val; }
-double PipelineBaton_GetEnsureAlpha(PipelineBaton* baton) { return baton->ensureAlpha; }
-void PipelineBaton_SetEnsureAlpha(PipelineBaton* baton, double val) { baton->ensureAlpha = val; }
-VipsInterpretation PipelineBaton_GetColourspaceInput(PipelineBaton* baton) { return baton->colourspaceInput; }
-void PipelineBaton_SetColourspaceInput(PipelineBaton* baton, VipsInterpretation val) { baton->colourspaceInput = val; }
-VipsInterpretation PipelineBaton_GetColourspace(PipelineBaton* baton) { return baton->colourspace; }
-void PipelineBaton_SetColourspace(PipelineBaton* baton, VipsInterpretation val) { baton->colourspace = val; }
-int* PipelineBaton_GetDelay(PipelineBaton* baton) { return baton->delay.data(); }
+PipelineResult* PipelineBaton_GetResult(PipelineBaton* baton) { return &baton->result; }
+void PipelineBaton_SetConvKernel(PipelineBaton* baton, double* val, size_t count) {
+  baton->convKernel = std::vector<double>(val, val + count);
+}
 void PipelineBaton_SetDelay(PipelineBaton* baton, int* val, size_t count) { baton->delay = std::vector<int>(val, val + count); }
-int PipelineBaton_GetLoop(PipelineBaton* baton) { return baton->loop; }
-void PipelineBaton_SetLoop(PipelineBaton* baton, int val) { baton->loop = val; }
-int PipelineBaton_GetTileSize(PipelineBaton* baton) { return baton->tileSize; }
-void PipelineBaton_SetTileSize(PipelineBaton* baton, int val) { baton->tileSize = val; }
-int PipelineBaton_GetTileOverlap(PipelineBaton* baton) { return baton->tileOverlap; }
-void PipelineBaton_SetTileOverlap(PipelineBaton* baton, int val) { baton->tileOverlap = val; }
-VipsForeignDzContainer PipelineBaton_GetTileContainer(PipelineBaton* baton) { return baton->tileContainer; }
-void PipelineBaton_SetTileContainer(PipelineBaton* baton, VipsForeignDzContainer val) { baton->tileContainer = val; }
-VipsForeignDzLayout PipelineBaton_GetTileLayout(PipelineBaton* baton) { return baton->tileLayout; }
-void PipelineBaton_SetTileLayout(PipelineBaton* baton, VipsForeignDzLayout val) { baton->tileLayout = val; }
-const char* PipelineBaton_GetTileFormat(PipelineBaton* baton) { return baton->tileFormat.c_str(); }
-void PipelineBaton_SetTileFormat(PipelineBaton* baton, const char* val) { baton->tileFormat = val; }
-int PipelineBaton_GetTileAngle(PipelineBaton* baton) { return baton->tileAngle; }
-void PipelineBaton_SetTileAngle(PipelineBaton* baton, int val) { baton->tileAngle = val; }
-double* PipelineBaton_GetTileBackground(PipelineBaton* baton) { return baton->tileBackground.data(); }
-void PipelineBaton_SetTileBackground(PipelineBaton* baton, double* val, size_t count) { baton->tileBackground = std::vector<double>(val, val + count); }
-int PipelineBaton_GetTileSkipBlanks(PipelineBaton* baton) { return baton->tileSkipBlanks; }
-void PipelineBaton_SetTileSkipBlanks(PipelineBaton* baton, int val) { baton->tileSkipBlanks = val; }
-VipsForeignDzDepth PipelineBaton_GetTileDepth(PipelineBaton* baton) { return baton->tileDepth; }
-void PipelineBaton_SetTileDepth(PipelineBaton* baton, VipsForeignDzDepth val) { baton->tileDepth = val; }
-const char* PipelineBaton_GetTileId(PipelineBaton* baton) { return baton->tileId.c_str(); }
-void PipelineBaton_SetTileId(PipelineBaton* baton, const char* val) { baton->tileId = val; }
-double* PipelineBaton_GetRecombMatrix(PipelineBaton* baton) { return baton->recombMatrix.get(); }
-void PipelineBaton_SetRecombMatrixSize(PipelineBaton* baton, unsigned int size) { baton->recombMatrix = std::unique_ptr<double[]>(new double[size]); }
 
 void PipelineBaton_Composite_PushBack(PipelineBaton* baton, Composite * value) { baton->composite.push_back(value); }
 void PipelineBaton_JoinChannelIn_PushBack(PipelineBaton* baton, InputDescriptor * value) { baton->joinChannelIn.push_back(value); }
-void PipelineBaton_ResizeBackground_PushBack(PipelineBaton* baton, double value) { baton->resizeBackground.push_back(value); }
-void PipelineBaton_FlattenBackground_PushBack(PipelineBaton* baton, double value) { baton->flattenBackground.push_back(value); }
-void PipelineBaton_RotationBackground_PushBack(PipelineBaton* baton, double value) { baton->rotationBackground.push_back(value); }
-void PipelineBaton_ExtendBackground_PushBack(PipelineBaton* baton, double value) { baton->extendBackground.push_back(value); }
-void PipelineBaton_AffineMatrix_PushBack(PipelineBaton* baton, double value) { baton->affineMatrix.push_back(value); }
-void PipelineBaton_AffineBackground_PushBack(PipelineBaton* baton, double value) { baton->affineBackground.push_back(value); }
-void PipelineBaton_Delay_PushBack(PipelineBaton* baton, int value) { baton->delay.push_back(value); }
-void PipelineBaton_TileBackground_PushBack(PipelineBaton* baton, double value) { baton->tileBackground.push_back(value); }
-
-void PipelineBaton_WithMetadataStrs_Insert(PipelineBaton* baton, const char* key, const char* value) {  baton->withMetadataStrs.insert(std::make_pair(std::string(key), std::string(value))); }
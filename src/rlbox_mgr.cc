@@ -1,13 +1,289 @@
 #include "rlbox_mgr.h"
+#include "common_sandbox.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
 #include <mutex>
+#include <utility>
+#include <vector>
 
+namespace {
+  struct VipsSandboxSlot {
+    rlbox_sandbox_vips sandbox;
+    int leases = 0;
+    int pins = 0;
+    // Leases granted since creation
+    size_t requests = 0;
+    // Memory high-water mark last sampled while this sandbox was leased, zero while idle
+    size_t lastHighwater = 0;
+    // Growth of the memory high-water mark seen while this sandbox was leased
+    size_t growth = 0;
+    // Retired sandboxes receive no new leases and are destroyed once idle
+    bool retired = false;
+  };
 
-rlbox_sandbox_vips* GetVipsSandbox() {
-    static rlbox_sandbox_vips sandbox;
-    static std::once_flag sandbox_create_flag;
+  std::mutex poolMutex;
+  std::vector<std::unique_ptr<VipsSandboxSlot>> pool;
+  size_t poolSize = 0;
+  // Sandboxes being created outside poolMutex, which count towards the pool size
+  size_t creating = 0;
 
-    std::call_once(sandbox_create_flag, [&](){
-        sandbox.create_sandbox();
-    });
-    return &sandbox;
-}
\ No newline at end of file
+  // Recycling policy, zero disables each limit
+  std::atomic<size_t> recycleRequests(0);
+  std::atomic<size_t> recycleHighwater(0);
+  std::atomic<size_t> recycled(0);
+
+  /*
+    One sandbox per libuv worker thread, as only that many batons can be in Execute at once
+  */
+  size_t DefaultVipsSandboxPoolSize() {
+    size_t size = 4;
+    char const *threadpool = std::getenv("UV_THREADPOOL_SIZE");
+    if (threadpool != nullptr) {
+      int const value = std::atoi(threadpool);
+      if (value > 0) {
+        size = static_cast<size_t>(std::min(value, 1024));
+      }
+    }
+    return size;
+  }
+
+  size_t SandboxHighwater(rlbox_sandbox_vips* sandbox) {
+    return sandbox->invoke_sandbox_function(GetTrackedMemHighwater)
+      .unverified_safe_because("Worst case, a sandbox is recycled early or late");
+  }
+
+  VipsSandboxSlot* FindSlot(rlbox_sandbox_vips* sandbox) {
+    for (auto const &slot : pool) {
+      if (&slot->sandbox == sandbox) {
+        return slot.get();
+      }
+    }
+    return nullptr;
+  }
+
+  std::unique_ptr<VipsSandboxSlot> CreateSlot() {
+    std::unique_ptr<VipsSandboxSlot> created(new VipsSandboxSlot);
+    created->sandbox.create_sandbox();
+    return created;
+  }
+
+  /*
+    Start a sandbox and add it to the pool, without holding poolMutex meanwhile so other
+    requests are not queued behind it; expects lock to hold poolMutex, as it does again on return
+  */
+  VipsSandboxSlot* AddSlot(std::unique_lock<std::mutex> &lock) {
+    creating++;
+    lock.unlock();
+    std::unique_ptr<VipsSandboxSlot> created = CreateSlot();
+    lock.lock();
+    creating--;
+    pool.push_back(std::move(created));
+    return pool.back().get();
+  }
+
+  /*
+    Destroy idle sandboxes that are retired or above the pool size; expects poolMutex to be held
+  */
+  void TrimVipsSandboxPool() {
+    size_t live = 0;
+    for (auto it = pool.begin(); it != pool.end();) {
+      VipsSandboxSlot &slot = **it;
+      bool const excess = slot.retired || live >= poolSize;
+      if (excess && slot.leases == 0 && slot.pins == 0) {
+        slot.sandbox.destroy_sandbox();
+        it = pool.erase(it);
+        continue;
+      }
+      if (!slot.retired) {
+        live++;
+      }
+      ++it;
+    }
+  }
+
+  /*
+    Retire a sandbox; its replacement is created by the next AcquireVipsSandbox that finds
+    fewer live sandboxes than the pool size, outside poolMutex; expects poolMutex to be held
+  */
+  void RetireSlot(VipsSandboxSlot *slot) {
+    slot->retired = true;
+    recycled++;
+  }
+
+  /*
+    Add the growth of the memory high-water mark since the last sample on this sandbox.
+    Under the noop sandbox the high-water mark is process-wide, so growth is only attributed
+    to sandboxes that were leased while it happened, rather than to every sandbox in the pool.
+    The mark never falls, so this stops retiring sandboxes once the process-wide peak is reached,
+    and retiring one returns none of libvips' heap, which the noop sandbox shares with the process.
+  */
+  void SampleSlot(VipsSandboxSlot *slot, size_t highwater) {
+    if (slot->lastHighwater != 0 && highwater > slot->lastHighwater) {
+      slot->growth += highwater - slot->lastHighwater;
+    }
+    slot->lastHighwater = highwater;
+  }
+
+  /*
+    Count a lease of the sandbox and apply the request limit; expects poolMutex to be held
+  */
+  void LeaseSlot(VipsSandboxSlot *slot) {
+    slot->leases++;
+    slot->requests++;
+    // In-flight work finishes on a retired sandbox, later requests get a fresh one
+    size_t const maxRequests = recycleRequests.load();
+    if (maxRequests > 0 && slot->requests >= maxRequests && !slot->retired) {
+      RetireSlot(slot);
+    }
+  }
+
+  /*
+    Sample the memory high-water mark of a sandbox that has just been leased and apply the memory limit.
+    The sample calls into the sandbox, so is taken before poolMutex, as in ReleaseVipsSandbox.
+  */
+  void SampleLeasedSandbox(rlbox_sandbox_vips* sandbox) {
+    size_t const maxHighwater = recycleHighwater.load();
+    if (maxHighwater == 0) {
+      return;
+    }
+    size_t const highwater = SandboxHighwater(sandbox);
+    std::lock_guard<std::mutex> lock(poolMutex);
+    VipsSandboxSlot *slot = FindSlot(sandbox);
+    if (slot != nullptr) {
+      SampleSlot(slot, highwater);
+      if (!slot->retired && slot->growth > maxHighwater) {
+        RetireSlot(slot);
+      }
+    }
+  }
+}
+
+rlbox_sandbox_vips* AcquireVipsSandbox() {
+  std::unique_lock<std::mutex> lock(poolMutex);
+  if (poolSize == 0) {
+    poolSize = DefaultVipsSandboxPoolSize();
+  }
+  // Prefer the least leased sandbox, creating a new one while below the pool size
+  VipsSandboxSlot *chosen = nullptr;
+  size_t live = 0;
+  for (auto const &slot : pool) {
+    if (!slot->retired) {
+      live++;
+      if (chosen == nullptr || slot->leases < chosen->leases) {
+        chosen = slot.get();
+      }
+    }
+  }
+  if (chosen == nullptr || (chosen->leases > 0 && live + creating < poolSize)) {
+    chosen = AddSlot(lock);
+  }
+  LeaseSlot(chosen);
+  lock.unlock();
+  SampleLeasedSandbox(&chosen->sandbox);
+  return &chosen->sandbox;
+}
+
+rlbox_sandbox_vips* AcquireVipsSandbox(rlbox_sandbox_vips* preferred) {
+  bool leased = false;
+  {
+    std::lock_guard<std::mutex> lock(poolMutex);
+    // Retired or not, the preferred sandbox holds the memory the request needs
+    VipsSandboxSlot *slot = FindSlot(preferred);
+    if (slot != nullptr) {
+      LeaseSlot(slot);
+      leased = true;
+    }
+  }
+  if (!leased) {
+    return AcquireVipsSandbox();
+  }
+  SampleLeasedSandbox(preferred);
+  return preferred;
+}
+
+void ReleaseVipsSandbox(rlbox_sandbox_vips* sandbox) {
+  size_t const maxHighwater = recycleHighwater.load();
+  size_t const highwater = maxHighwater > 0 ? SandboxHighwater(sandbox) : 0;
+  std::lock_guard<std::mutex> lock(poolMutex);
+  VipsSandboxSlot *slot = FindSlot(sandbox);
+  if (slot != nullptr) {
+    slot->leases--;
+    if (maxHighwater > 0) {
+      SampleSlot(slot, highwater);
+      if (slot->leases == 0) {
+        slot->lastHighwater = 0;
+      }
+      if (!slot->retired && slot->growth > maxHighwater) {
+        RetireSlot(slot);
+      }
+    }
+  }
+  TrimVipsSandboxPool();
+}
+
+void PinVipsSandbox(rlbox_sandbox_vips* sandbox) {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  VipsSandboxSlot *slot = FindSlot(sandbox);
+  if (slot != nullptr) {
+    slot->pins++;
+  }
+}
+
+bool IsVipsSandboxRetired(rlbox_sandbox_vips* sandbox) {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  VipsSandboxSlot *slot = FindSlot(sandbox);
+  return slot == nullptr || slot->retired;
+}
+
+rlbox_sandbox_vips* PinVipsSandbox() {
+  std::unique_lock<std::mutex> lock(poolMutex);
+  if (poolSize == 0) {
+    poolSize = DefaultVipsSandboxPoolSize();
+  }
+  VipsSandboxSlot *chosen = nullptr;
+  for (auto const &slot : pool) {
+    if (!slot->retired) {
+      chosen = slot.get();
+      break;
+    }
+  }
+  if (chosen == nullptr) {
+    chosen = AddSlot(lock);
+  }
+  chosen->pins++;
+  return &chosen->sandbox;
+}
+
+void UnpinVipsSandbox(rlbox_sandbox_vips* sandbox) {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  VipsSandboxSlot *slot = FindSlot(sandbox);
+  if (slot != nullptr) {
+    slot->pins--;
+  }
+  TrimVipsSandboxPool();
+}
+
+size_t GetVipsSandboxPoolSize() {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  if (poolSize == 0) {
+    poolSize = DefaultVipsSandboxPoolSize();
+  }
+  return poolSize;
+}
+
+void SetVipsSandboxPoolSize(size_t size) {
+  std::lock_guard<std::mutex> lock(poolMutex);
+  poolSize = size > 0 ? size : DefaultVipsSandboxPoolSize();
+  TrimVipsSandboxPool();
+}
+
+void SetVipsSandboxRecycling(size_t requests, size_t highwater) {
+  recycleRequests = requests;
+  recycleHighwater = highwater;
+}
+
+VipsSandboxRecycling GetVipsSandboxRecycling() {
+  return { recycleRequests.load(), recycleHighwater.load(), recycled.load() };
+}
@@ -1,7 +1,5 @@
 #pragma once
 
-#define RLBOX_SINGLE_THREADED_INVOCATIONS
-
 #ifdef WASM_SANDBOXED_VIPS
 #  error "Not implemented"
 #else
@@ -19,8 +17,21 @@
 
 using namespace rlbox;
 
+#include "rlbox_profile.h"
+
+#ifdef SHARP_PROFILE_TRANSITIONS
+// Every invoke_sandbox_function is timed by a temporary created among its arguments
+#  undef invoke_sandbox_function
+#  define invoke_sandbox_function(func_name, ...)                          \
+    template INTERNAL_invoke_with_func_ptr<decltype(func_name)>(           \
+      sharp::profile::TransitionTimer(#func_name).Name(),                  \
+      sandbox_lookup_symbol_helper(RLBOX_USE_STATIC_CALLS(), func_name),   \
+      ##__VA_ARGS__)
+#endif
+
 #include "stats_sandbox.h"
 #include "metadata_sandbox.h"
+#include "pipeline_sandbox.h"
 
 #define sandbox_fields_reflection_vips_class_ChannelStats(f, g, ...) \
   f(int,    min,       FIELD_NORMAL, ##__VA_ARGS__) g()                          \
@@ -38,8 +49,280 @@ using namespace rlbox;
   f(int, width, FIELD_NORMAL, ##__VA_ARGS__) g()                          \
   f(int, height, FIELD_NORMAL, ##__VA_ARGS__) g()
 
+#define sandbox_fields_reflection_vips_class_PipelineOptions(f, g, ...) \
+  f(InputDescriptor*, input,                   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              topOffsetPre,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              leftOffsetPre,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              widthPre,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              heightPre,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              topOffsetPost,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              leftOffsetPost,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              widthPost,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              heightPost,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              width,                   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              height,                  FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              canvas,                  FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           tintA,                   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           tintB,                   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             withoutEnlargement,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             withoutReduction,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              position,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[4],        resizeBackground,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     kernel,                  FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             fastShrinkOnLoad,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           reorderTolerance,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             debugPlan,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             flatten,                 FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[3],        flattenBackground,       FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             negate,                  FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             negateAlpha,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           blurSigma,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           brightness,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           saturation,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              hue,                     FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           lightness,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              medianSize,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           sharpenSigma,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           sharpenM1,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           sharpenM2,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           sharpenX1,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           sharpenY2,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           sharpenY3,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              threshold,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             thresholdGrayscale,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           trimThreshold,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           gamma,                   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           gammaOut,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           linearA,                 FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           linearB,                 FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             greyscale,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             normalise,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              claheWidth,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              claheHeight,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              claheMaxSlope,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             useExifOrientation,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              angle,                   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           rotationAngle,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[4],        rotationBackground,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             rotateBeforePreExtract,  FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             flip,                    FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             flop,                    FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              extendTop,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              extendBottom,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              extendLeft,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              extendRight,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[4],        extendBackground,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              extractChannel,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     affineMatrixSize,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[4],        affineMatrix,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[4],        affineBackground,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           affineIdx,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           affineIdy,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           affineOdx,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           affineOdy,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     affineInterpolator,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             removeAlpha,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           ensureAlpha,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(InputDescriptor*, boolean,                 FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              booleanOp,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              bandBoolOp,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              convKernelWidth,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              convKernelHeight,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           convKernelScale,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           convKernelOffset,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             hasRecombMatrix,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[9],        recombMatrix,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              colourspaceInput,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              colourspace,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             reduceEarly,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     formatOut,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     fileOut,                 FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             withMetadata,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              withMetadataOrientation, FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           withMetadataDensity,     FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     withMetadataIcc,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     withMetadataStrs,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     withMetadataStrsCount,   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              timeoutSeconds,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              jpegQuality,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             jpegProgressive,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     jpegChromaSubsampling,   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             jpegTrellisQuantisation, FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              jpegQuantisationTable,   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             jpegOvershootDeringing,  FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             jpegOptimiseScans,       FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             jpegOptimiseCoding,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             pngProgressive,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              pngCompressionLevel,     FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             pngAdaptiveFiltering,    FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             pngPalette,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              pngQuality,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              pngEffort,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              pngBitdepth,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           pngDither,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              jp2Quality,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             jp2Lossless,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              jp2TileHeight,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              jp2TileWidth,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     jp2ChromaSubsampling,    FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              webpQuality,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              webpAlphaQuality,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             webpLossless,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             webpNearLossless,        FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             webpSmartSubsample,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              webpEffort,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              gifBitdepth,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              gifEffort,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           gifDither,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffQuality,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             tiffPyramid,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffBitdepth,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             tiffTile,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffTileWidth,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffTileHeight,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           tiffXres,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double,           tiffYres,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffCompression,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffPredictor,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tiffResolutionUnit,      FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              heifQuality,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             heifLossless,            FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              heifCompression,         FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              heifEffort,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     heifChromaSubsampling,   FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              rawDepth,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              loop,                    FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileSize,                FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileOverlap,             FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileAngle,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(double[4],        tileBackground,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileSkipBlanks,          FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileContainer,           FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileLayout,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     tileFormat,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(int,              tileDepth,               FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(bool,             tileCentre,              FIELD_NORMAL, ##__VA_ARGS__) g()  \
+  f(unsigned int,     tileId,                  FIELD_NORMAL, ##__VA_ARGS__) g()
+
+#define sandbox_fields_reflection_vips_class_PipelineResult(f, g, ...) \
+  f(const char*, err,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(const char*, formatOut,       FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(const char*, fileOut,         FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(void*,       bufferOut,       FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(size_t,      bufferOutLength, FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         width,           FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         height,          FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         channels,        FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         rawDepth,        FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,        premultiplied,   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,        hasCropOffset,   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         cropOffsetLeft,  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         cropOffsetTop,   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,        hasTrimOffset,   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         trimOffsetLeft,  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,         trimOffsetTop,   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(const char*, plan,            FIELD_NORMAL, ##__VA_ARGS__) g()
+
+#define sandbox_fields_reflection_vips_class_MetadataResult(f, g, ...) \
+  f(unsigned int, err,                    FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, format,                 FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(size_t,       size,                   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          width,                  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          height,                 FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, space,                  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          channels,               FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, depth,                  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          density,                FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, chromaSubsampling,      FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,         isProgressive,          FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          paletteBitDepth,        FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          pages,                  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          pageHeight,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          loop,                   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, delay,                  FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, delayCount,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          pagePrimary,            FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, compression,            FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, resolutionUnit,         FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, levels,                 FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, levelsCount,            FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          subifds,                FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, background,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, backgroundCount,        FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,         hasProfile,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,         hasAlpha,               FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(int,          orientation,            FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, exif,                   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, exifLength,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, icc,                    FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, iccLength,              FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, iptc,                   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, iptcLength,             FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, xmp,                    FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, xmpLength,              FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, tifftagPhotoshop,       FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(unsigned int, tifftagPhotoshopLength, FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(bool,         headerComplete,         FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(char*,        blob,                   FIELD_NORMAL, ##__VA_ARGS__) g()     \
+  f(size_t,       blobLength,             FIELD_NORMAL, ##__VA_ARGS__) g()
+
 #define sandbox_fields_reflection_vips_allClasses(f, ...)                 \
   f(MetadataDimension, vips, ##__VA_ARGS__) \
-  f(ChannelStats, vips, ##__VA_ARGS__)
+  f(MetadataResult, vips, ##__VA_ARGS__) \
+  f(ChannelStats, vips, ##__VA_ARGS__) \
+  f(PipelineOptions, vips, ##__VA_ARGS__) \
+  f(PipelineResult, vips, ##__VA_ARGS__)
+
+/*
+  Lease a sandbox from the pool for the lifetime of a baton.
+  The least leased sandbox is returned, so batons only share a sandbox once the pool is full.
+*/
+rlbox_sandbox_vips* AcquireVipsSandbox();
+
+/*
+  Lease the given sandbox, for example the one holding an input buffer, falling back to any sandbox
+*/
+rlbox_sandbox_vips* AcquireVipsSandbox(rlbox_sandbox_vips* preferred);
+
+/*
+  Return a sandbox obtained from AcquireVipsSandbox
+*/
+void ReleaseVipsSandbox(rlbox_sandbox_vips* sandbox);
+
+/*
+  Keep a sandbox alive, without counting towards its leases, while host objects reference its memory
+*/
+void PinVipsSandbox(rlbox_sandbox_vips* sandbox);
+void UnpinVipsSandbox(rlbox_sandbox_vips* sandbox);
+
+/*
+  Whether a sandbox has been retired by the recycling policy, or has already been destroyed.
+  Host objects that pin a sandbox should let go of a retired one so it can be destroyed once idle.
+*/
+bool IsVipsSandboxRetired(rlbox_sandbox_vips* sandbox);
+
+/*
+  Pin any live sandbox, creating one when there is none, for calls that are not requests,
+  such as reading statistics, and so do not count towards recycling; release with UnpinVipsSandbox
+*/
+rlbox_sandbox_vips* PinVipsSandbox();
+
+/*
+  Get and set the number of sandboxes in the pool, which defaults to UV_THREADPOOL_SIZE
+*/
+size_t GetVipsSandboxPoolSize();
+void SetVipsSandboxPoolSize(size_t size);
 
-rlbox_sandbox_vips* GetVipsSandbox();
\ No newline at end of file
+/*
+  Sandboxes are retired after the given number of requests, or once the memory high-water mark
+  has grown by the given number of bytes while they were leased. Work in flight completes on the
+  retired sandbox, which is destroyed when idle, while its replacement starts in the background.
+  Zero disables either limit.
+*/
+struct VipsSandboxRecycling {
+  size_t requests;
+  size_t highwater;
+  size_t recycled;
+};
+void SetVipsSandboxRecycling(size_t requests, size_t highwater);
+VipsSandboxRecycling GetVipsSandboxRecycling();
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "rlbox_profile.h"
+
+#ifdef SHARP_PROFILE_TRANSITIONS
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace sharp {
+namespace profile {
+
+  namespace {
+    // Enough for every symbol the host invokes; further symbols are counted together as "(other)"
+    size_t const symbolSlots = 512;
+    char const *const otherSymbols = "(other)";
+
+    struct SymbolSlot {
+      std::atomic<char const *> name{nullptr};
+      std::atomic<uint64_t> calls{0};
+      std::atomic<uint64_t> ns{0};
+    };
+
+    /*
+      Written only by the owning thread, read by Collect from the JS thread
+    */
+    struct ThreadCounters {
+      SymbolSlot symbols[symbolSlots];
+      SymbolSlot other;
+      std::atomic<uint64_t> bytesIn{0};
+      std::atomic<uint64_t> bytesOut{0};
+    };
+
+    std::mutex registryMutex;
+    // Counters of running threads
+    std::vector<ThreadCounters*> registry;
+    // Counters of threads that have exited, folded together
+    std::map<std::string, std::pair<uint64_t, uint64_t>> exitedSymbols;
+    uint64_t exitedBytesIn = 0;
+    uint64_t exitedBytesOut = 0;
+
+    void AddSymbol(std::map<std::string, std::pair<uint64_t, uint64_t>> *bySymbol, SymbolSlot const &slot) {
+      char const *name = slot.name.load(std::memory_order_acquire);
+      if (name != nullptr) {
+        auto &symbol = (*bySymbol)[name];
+        symbol.first += slot.calls.load(std::memory_order_relaxed);
+        symbol.second += slot.ns.load(std::memory_order_relaxed);
+      }
+    }
+
+    /*
+      Registers the counters of a thread on first use, and folds them into the exited totals
+      when the thread ends, so short-lived threads do not accumulate counter blocks
+    */
+    class LocalCounters {
+     public:
+      LocalCounters() : counters(new ThreadCounters) {
+        counters->other.name.store(otherSymbols, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(counters);
+      }
+      ~LocalCounters() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (SymbolSlot const &slot : counters->symbols) {
+          AddSymbol(&exitedSymbols, slot);
+        }
+        AddSymbol(&exitedSymbols, counters->other);
+        exitedBytesIn += counters->bytesIn.load(std::memory_order_relaxed);
+        exitedBytesOut += counters->bytesOut.load(std::memory_order_relaxed);
+        registry.erase(std::find(registry.begin(), registry.end(), counters));
+        delete counters;
+      }
+      ThreadCounters *counters;
+    };
+
+    ThreadCounters& Local() {
+      thread_local LocalCounters local;
+      return *local.counters;
+    }
+
+    // Names are string literals, so the pointer identifies the call site's symbol
+    SymbolSlot& Slot(ThreadCounters& counters, char const *name) {
+      size_t index = std::hash<char const *>()(name) % symbolSlots;
+      for (size_t probe = 0; probe < symbolSlots; probe++) {
+        SymbolSlot& slot = counters.symbols[index];
+        char const *current = slot.name.load(std::memory_order_relaxed);
+        if (current == name) {
+          return slot;
+        }
+        if (current == nullptr) {
+          slot.name.store(name, std::memory_order_release);
+          return slot;
+        }
+        index = (index + 1) % symbolSlots;
+      }
+      return counters.other;
+    }
+  }
+
+  TransitionTimer::~TransitionTimer() {
+    uint64_t const elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count());
+    SymbolSlot& slot = Slot(Local(), name);
+    slot.calls.fetch_add(1, std::memory_order_relaxed);
+    slot.ns.fetch_add(elapsed, std::memory_order_relaxed);
+  }
+
+  void CountBytesIn(size_t bytes) {
+    Local().bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void CountBytesOut(size_t bytes) {
+    Local().bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  Totals Collect() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    std::map<std::string, std::pair<uint64_t, uint64_t>> bySymbol = exitedSymbols;
+    Totals totals = { {}, exitedBytesIn, exitedBytesOut };
+    for (ThreadCounters* counters : registry) {
+      for (SymbolSlot const &slot : counters->symbols) {
+        AddSymbol(&bySymbol, slot);
+      }
+      AddSymbol(&bySymbol, counters->other);
+      totals.bytesIn += counters->bytesIn.load(std::memory_order_relaxed);
+      totals.bytesOut += counters->bytesOut.load(std::memory_order_relaxed);
+    }
+    for (auto const &symbol : bySymbol) {
+      totals.symbols.push_back({ symbol.first, symbol.second.first, symbol.second.second });
+    }
+    return totals;
+  }
+
+}  // namespace profile
+}  // namespace sharp
+
+#endif  // SHARP_PROFILE_TRANSITIONS
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+  Optional instrumentation of sandbox transitions, enabled by building with SHARP_PROFILE_TRANSITIONS.
+  Counters are kept per thread without locks and only summed when read.
+*/
+namespace sharp {
+namespace profile {
+
+  struct SymbolTotals {
+    std::string name;
+    uint64_t calls;
+    uint64_t ns;
+  };
+
+  struct Totals {
+    std::vector<SymbolTotals> symbols;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+  };
+
+#ifdef SHARP_PROFILE_TRANSITIONS
+  /*
+    Times a transition from construction until the end of the enclosing full-expression,
+    so any work on the result within the same statement is included
+  */
+  class TransitionTimer {
+   public:
+    explicit TransitionTimer(char const *name) : name(name), start(std::chrono::steady_clock::now()) {}
+    ~TransitionTimer();
+    char const *Name() const { return name; }
+
+   private:
+    char const *name;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  // Bytes copied into and out of sandbox memory
+  void CountBytesIn(size_t bytes);
+  void CountBytesOut(size_t bytes);
+
+  // Sum the counters of every thread
+  Totals Collect();
+#else
+  inline void CountBytesIn(size_t) {}
+  inline void CountBytesOut(size_t) {}
+#endif
+
+}  // namespace profile
+}  // namespace sharp
@@ -34,11 +34,26 @@ Napi::Object init(Napi::Env env, Napi::Object exports) {
   g_log_set_handler("VIPS", static_cast<GLogLevelFlags>(G_LOG_LEVEL_WARNING),
     static_cast<GLogFunc>(sharp::VipsWarningCallback), nullptr);
 
+  // Enum nicks are resolved host-side from then on
+  rlbox_sandbox_vips* sandbox = AcquireVipsSandbox();
+  sharp::InitEnumTables(sandbox);
+  ReleaseVipsSandbox(sandbox);
+
   // Methods available to JavaScript
   exports.Set("metadata", Napi::Function::New(env, metadata));
+  exports.Set("metadataMany", Napi::Function::New(env, metadataMany));
   exports.Set("pipeline", Napi::Function::New(env, pipeline));
+  exports.Set("pipelineMany", Napi::Function::New(env, pipelineMany));
+  exports.Set("compile", Napi::Function::New(env, compile));
+  exports.Set("pipelineFromTemplate", Napi::Function::New(env, pipelineFromTemplate));
+  exports.Set("pipelineBatch", Napi::Function::New(env, pipelineBatch));
+  exports.Set("pipelineBatchResume", Napi::Function::New(env, pipelineBatchResume));
   exports.Set("cache", Napi::Function::New(env, cache));
   exports.Set("concurrency", Napi::Function::New(env, concurrency));
+  exports.Set("sandboxes", Napi::Function::New(env, sandboxes));
+  exports.Set("recycle", Napi::Function::New(env, recycle));
+  exports.Set("warmup", Napi::Function::New(env, warmup));
+  exports.Set("allocInputBuffer", Napi::Function::New(env, allocInputBuffer));
   exports.Set("counters", Napi::Function::New(env, counters));
   exports.Set("simd", Napi::Function::New(env, simd));
   exports.Set("libvipsVersion", Napi::Function::New(env, libvipsVersion));
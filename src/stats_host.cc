@@ -29,9 +29,13 @@ rlbox_load_structs_from_library(vips);
 
 class StatsWorker : public Napi::AsyncWorker {
  public:
-  StatsWorker(Napi::Function callback, tainted_vips<StatsBaton*> t_baton, Napi::Function debuglog, rlbox_sandbox_vips* sandbox) :
-    Napi::AsyncWorker(callback), t_baton(t_baton), debuglog(Napi::Persistent(debuglog)), sandbox(sandbox) {}
-  ~StatsWorker() {}
+  StatsWorker(Napi::Function callback, tainted_vips<StatsBaton*> t_baton, Napi::Function debuglog, rlbox_sandbox_vips* sandbox,
+    bool approximate) :
+    Napi::AsyncWorker(callback), t_baton(t_baton), debuglog(Napi::Persistent(debuglog)), sandbox(sandbox),
+    approximate(approximate) {}
+  ~StatsWorker() {
+    ReleaseVipsSandbox(sandbox);
+  }
 
   void Execute() {
     // Decrement queued task counter
@@ -52,6 +56,7 @@ class StatsWorker : public Napi::AsyncWorker {
     }
 
     std::string errString = sandbox->invoke_sandbox_function(StatsBaton_GetErr, t_baton).copy_and_verify_string([](std::string val) {
+      sharp::profile::CountBytesOut(val.size());
       // Worst case, the library says there is an error when there isn't
       return val;
     });
@@ -91,10 +96,15 @@ class StatsWorker : public Napi::AsyncWorker {
       dominant.Set("g", sandbox->invoke_sandbox_function(StatsBaton_GetDominantGreen, t_baton).unverified_safe_because(image_attrib_reason));
       dominant.Set("b", sandbox->invoke_sandbox_function(StatsBaton_GetDominantBlue, t_baton).unverified_safe_because(image_attrib_reason));
       info.Set("dominant", dominant);
+      if (approximate) {
+        info.Set("samplingFactor",
+          sandbox->invoke_sandbox_function(StatsBaton_GetSamplingFactor, t_baton).unverified_safe_because(image_attrib_reason));
+      }
       Callback().MakeCallback(Receiver().Value(), { env.Null(), info });
     } else {
       auto errString = sandbox->invoke_sandbox_function(StatsBaton_GetErr, t_baton)
       .copy_and_verify_string([](std::string val) {
+        sharp::profile::CountBytesOut(val.size());
         // Worst case you'd get a bad error message
         return val;
       });
@@ -108,27 +118,31 @@ class StatsWorker : public Napi::AsyncWorker {
   tainted_vips<StatsBaton*> t_baton;
   Napi::FunctionReference debuglog;
   rlbox_sandbox_vips* sandbox;
+  bool approximate;
 };
 
 /*
   stats(options, callback)
 */
 Napi::Value stats(const Napi::CallbackInfo& info) {
-  rlbox_sandbox_vips* sandbox = GetVipsSandbox();
+  Napi::Object options = info[0].As<Napi::Object>();
+  rlbox_sandbox_vips* sandbox = sharp::AcquireSandboxForInput(options.Get("input").As<Napi::Object>());
 
   // V8 objects are converted to non-V8 types held in the baton struct
   tainted_vips<StatsBaton*> t_baton = sandbox->invoke_sandbox_function(CreateStatsBaton);
-  Napi::Object options = info[0].As<Napi::Object>();
 
   // Input
   sandbox->invoke_sandbox_function(StatsBaton_SetInput, t_baton, sharp::CreateInputDescriptor(sandbox, options.Get("input").As<Napi::Object>()));
+  bool const approximate = sharp::AttrAsBool(options, "statsApproximate");
+  sandbox->invoke_sandbox_function(StatsBaton_SetApproximate, t_baton, approximate);
+  sandbox->invoke_sandbox_function(StatsBaton_SetMaxPixels, t_baton, sharp::AttrAsInt32(options, "statsMaxPixels"));
 
   // Function to notify of libvips warnings
   Napi::Function debuglog = options.Get("debuglog").As<Napi::Function>();
 
   // Join queue for worker thread
   Napi::Function callback = info[1].As<Napi::Function>();
-  StatsWorker *worker = new StatsWorker(callback, t_baton, debuglog, sandbox);
+  StatsWorker *worker = new StatsWorker(callback, t_baton, debuglog, sandbox, approximate);
   worker->Receiver().Set("options", options);
   worker->Queue();
 
@@ -1,19 +1,295 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
 #include <vips/vips8>
 
 #include "stats_sandbox.h"
 #include "common_sandbox.h"
 
 
-static const int STAT_MIN_INDEX = 0;
-static const int STAT_MAX_INDEX = 1;
-static const int STAT_SUM_INDEX = 2;
-static const int STAT_SQ_SUM_INDEX = 3;
-static const int STAT_MEAN_INDEX = 4;
-static const int STAT_STDEV_INDEX = 5;
-static const int STAT_MINX_INDEX = 6;
-static const int STAT_MINY_INDEX = 7;
-static const int STAT_MAXX_INDEX = 8;
-static const int STAT_MAXY_INDEX = 9;
+/*
+  Everything stats() reports, accumulated by one thread over the regions it is given
+  and then merged into the shared total. Positions of tied minima and maxima resolve
+  to the first in raster order, whichever region and thread found them.
+*/
+struct FusedStats {
+  int bands;
+  std::vector<double> min;
+  std::vector<double> max;
+  std::vector<double> sum;
+  std::vector<double> squaresSum;
+  std::vector<int> minX;
+  std::vector<int> minY;
+  std::vector<int> maxX;
+  std::vector<int> maxY;
+  std::vector<uint64_t> greyscaleHist;
+  double laplacianSum;
+  double laplacianSquaresSum;
+  std::vector<uint64_t> colourHist;
+
+  FusedStats(int bands, size_t greyscaleBins):
+    bands(bands),
+    min(bands, std::numeric_limits<double>::infinity()),
+    max(bands, -std::numeric_limits<double>::infinity()),
+    sum(bands, 0.0),
+    squaresSum(bands, 0.0),
+    minX(bands, 0),
+    minY(bands, 0),
+    maxX(bands, 0),
+    maxY(bands, 0),
+    greyscaleHist(greyscaleBins, 0),
+    laplacianSum(0.0),
+    laplacianSquaresSum(0.0),
+    colourHist(16 * 16 * 16, 0) {}
+};
+
+/*
+  Layout of the bands of the joined image the kernel traverses
+*/
+struct FusedStatsLayout {
+  int imageBands;
+  int greyscaleBand;
+  int laplacianBand;
+  int colourBand;
+  int bands;
+  size_t greyscaleBins;
+  double colourRange;
+  FusedStats *total;
+  GMutex lock;
+};
+
+static bool FirstInRaster(int x, int y, int otherX, int otherY) {
+  return y < otherY || (y == otherY && x < otherX);
+}
+
+static void *FusedStatsStart(VipsImage *, void *a, void *) {
+  FusedStatsLayout *layout = static_cast<FusedStatsLayout*>(a);
+  return new FusedStats(layout->imageBands, layout->greyscaleBins);
+}
+
+template <typename T>
+static void FusedStatsScanRows(VipsRegion *region, FusedStats *stats, FusedStatsLayout const *layout) {
+  VipsRect const *r = &region->valid;
+  int const imageBands = layout->imageBands;
+  int const bands = layout->bands;
+  size_t const greyscaleMax = layout->greyscaleBins - 1;
+  for (int y = 0; y < r->height; y++) {
+    T const *p = reinterpret_cast<T*>(VIPS_REGION_ADDR(region, r->left, r->top + y));
+    // Per-band accumulation runs along the row so that the sums stay in registers
+    for (int b = 0; b < imageBands; b++) {
+      double min = stats->min[b];
+      double max = stats->max[b];
+      double sum = 0.0;
+      double squaresSum = 0.0;
+      for (int x = 0; x < r->width; x++) {
+        double const v = static_cast<double>(p[x * bands + b]);
+        sum += v;
+        squaresSum += v * v;
+        // Regions reach a thread in no particular order, so ties compare positions too
+        if (v < min || (v == min && FirstInRaster(r->left + x, r->top + y, stats->minX[b], stats->minY[b]))) {
+          min = v;
+          stats->minX[b] = r->left + x;
+          stats->minY[b] = r->top + y;
+        }
+        if (v > max || (v == max && FirstInRaster(r->left + x, r->top + y, stats->maxX[b], stats->maxY[b]))) {
+          max = v;
+          stats->maxX[b] = r->left + x;
+          stats->maxY[b] = r->top + y;
+        }
+      }
+      stats->min[b] = min;
+      stats->max[b] = max;
+      stats->sum[b] += sum;
+      stats->squaresSum[b] += squaresSum;
+    }
+    for (int x = 0; x < r->width; x++) {
+      T const *px = p + x * bands;
+      // Histograms bin as hist_find and hist_find_ndim do, truncating anything other than ushort to uchar
+      double const grey = static_cast<double>(px[layout->greyscaleBand]);
+      stats->greyscaleHist[static_cast<size_t>(std::min(std::max(grey, 0.0), static_cast<double>(greyscaleMax)))]++;
+      if (layout->laplacianBand >= 0) {
+        double const l = static_cast<double>(px[layout->laplacianBand]);
+        stats->laplacianSum += l;
+        stats->laplacianSquaresSum += l * l;
+      }
+      int bin[3];
+      for (int c = 0; c < 3; c++) {
+        double const v = std::min(std::max(static_cast<double>(px[layout->colourBand + c]), 0.0),
+          layout->colourRange - 1);
+        bin[c] = static_cast<int>(static_cast<int>(v) * 16 / layout->colourRange);
+      }
+      stats->colourHist[(bin[1] * 16 + bin[0]) * 16 + bin[2]]++;
+    }
+  }
+}
+
+static int FusedStatsScan(VipsRegion *region, void *seq, void *a, void *, gboolean *) {
+  FusedStats *stats = static_cast<FusedStats*>(seq);
+  FusedStatsLayout const *layout = static_cast<FusedStatsLayout*>(a);
+  switch (region->im->BandFmt) {
+    case VIPS_FORMAT_UCHAR: FusedStatsScanRows<unsigned char>(region, stats, layout); break;
+    case VIPS_FORMAT_CHAR: FusedStatsScanRows<signed char>(region, stats, layout); break;
+    case VIPS_FORMAT_USHORT: FusedStatsScanRows<unsigned short>(region, stats, layout); break;
+    case VIPS_FORMAT_SHORT: FusedStatsScanRows<short>(region, stats, layout); break;
+    case VIPS_FORMAT_UINT: FusedStatsScanRows<unsigned int>(region, stats, layout); break;
+    case VIPS_FORMAT_INT: FusedStatsScanRows<int>(region, stats, layout); break;
+    case VIPS_FORMAT_FLOAT: FusedStatsScanRows<float>(region, stats, layout); break;
+    default: FusedStatsScanRows<double>(region, stats, layout); break;
+  }
+  return 0;
+}
+
+static int FusedStatsStop(void *seq, void *a, void *) {
+  FusedStats *stats = static_cast<FusedStats*>(seq);
+  FusedStatsLayout *layout = static_cast<FusedStatsLayout*>(a);
+  FusedStats *total = layout->total;
+  g_mutex_lock(&layout->lock);
+  for (int b = 0; b < stats->bands; b++) {
+    if (stats->min[b] < total->min[b] || (stats->min[b] == total->min[b] &&
+      FirstInRaster(stats->minX[b], stats->minY[b], total->minX[b], total->minY[b]))) {
+      total->min[b] = stats->min[b];
+      total->minX[b] = stats->minX[b];
+      total->minY[b] = stats->minY[b];
+    }
+    if (stats->max[b] > total->max[b] || (stats->max[b] == total->max[b] &&
+      FirstInRaster(stats->maxX[b], stats->maxY[b], total->maxX[b], total->maxY[b]))) {
+      total->max[b] = stats->max[b];
+      total->maxX[b] = stats->maxX[b];
+      total->maxY[b] = stats->maxY[b];
+    }
+    total->sum[b] += stats->sum[b];
+    total->squaresSum[b] += stats->squaresSum[b];
+  }
+  for (size_t i = 0; i < total->greyscaleHist.size(); i++) {
+    total->greyscaleHist[i] += stats->greyscaleHist[i];
+  }
+  total->laplacianSum += stats->laplacianSum;
+  total->laplacianSquaresSum += stats->laplacianSquaresSum;
+  for (size_t i = 0; i < total->colourHist.size(); i++) {
+    total->colourHist[i] += stats->colourHist[i];
+  }
+  g_mutex_unlock(&layout->lock);
+  delete stats;
+  return 0;
+}
+
+/*
+  Sample standard deviation, as stats and deviate calculate it
+*/
+static double StandardDeviation(double sum, double squaresSum, double n) {
+  return n > 1 ? std::sqrt(std::abs(squaresSum - (sum * sum / n)) / (n - 1)) : 0.0;
+}
+
+/*
+  Compute every statistic in a single parallel traversal of the image, its greyscale
+  version, the laplacian of that and its sRGB version, so the input is decoded once.
+*/
+static void RunFusedStats(StatsBaton *baton, VImage image) {
+  VImage greyscale = image.colourspace(VIPS_INTERPRETATION_B_W)[0];
+  VImage colour = sharp::RemoveAlpha(image).colourspace(VIPS_INTERPRETATION_sRGB);
+  if (colour.bands() < 3) {
+    colour = colour.bandjoin({ colour, colour });
+  }
+
+  FusedStatsLayout layout;
+  layout.imageBands = image.bands();
+  layout.greyscaleBand = layout.imageBands;
+  layout.laplacianBand = -1;
+  layout.greyscaleBins = greyscale.format() == VIPS_FORMAT_USHORT ? 65536 : 256;
+  layout.colourRange = colour.format() == VIPS_FORMAT_USHORT ? 65536.0 : 256.0;
+  // Bands are joined in the widest of their formats, which is float once the laplacian band is added
+  std::vector<VImage> parts = { image, greyscale };
+  // Sharpness is estimated via the standard deviation of the greyscale laplacian
+  if (image.width() > 1 || image.height() > 1) {
+    VImage laplacian = VImage::new_matrixv(3, 3,
+      0.0,  1.0, 0.0,
+      1.0, -4.0, 1.0,
+      0.0,  1.0, 0.0);
+    laplacian.set("scale", 9.0);
+    layout.laplacianBand = layout.greyscaleBand + 1;
+    parts.push_back(greyscale.conv(laplacian));
+  }
+  layout.colourBand = layout.greyscaleBand + static_cast<int>(parts.size()) - 1;
+  parts.push_back(colour.extract_band(0, VImage::option()->set("n", 3)));
+  VImage joined = VImage::bandjoin(parts);
+  if (vips_band_format_iscomplex(joined.format())) {
+    joined = joined.cast(VIPS_FORMAT_DOUBLE);
+  }
+  layout.bands = joined.bands();
+
+  FusedStats total(layout.imageBands, layout.greyscaleBins);
+  layout.total = &total;
+  g_mutex_init(&layout.lock);
+  int const status = vips_sink(joined.get_image(), FusedStatsStart, FusedStatsScan, FusedStatsStop, &layout, nullptr);
+  g_mutex_clear(&layout.lock);
+  if (status != 0) {
+    throw vips::VError();
+  }
+
+  double const n = static_cast<double>(image.width()) * image.height();
+  for (int b = 0; b < layout.imageBands; b++) {
+    baton->channelStats.push_back(ChannelStats(
+      static_cast<int>(total.min[b]),
+      static_cast<int>(total.max[b]),
+      total.sum[b],
+      total.squaresSum[b],
+      total.sum[b] / n,
+      StandardDeviation(total.sum[b], total.squaresSum[b], n),
+      total.minX[b], total.minY[b], total.maxX[b], total.maxY[b]));
+  }
+  // Image is not opaque when alpha layer is present and contains a non-mamixa value
+  if (sharp::HasAlpha(image)) {
+    if (total.min[layout.imageBands - 1] != sharp::MaximumImageAlpha(image.interpretation())) {
+      baton->isOpaque = false;
+    }
+  }
+  // Estimate entropy via histogram of greyscale value frequency
+  double entropy = 0.0;
+  for (uint64_t const count : total.greyscaleHist) {
+    if (count > 0) {
+      double const p = count / n;
+      entropy -= p * std::log2(p);
+    }
+  }
+  baton->entropy = std::abs(entropy);
+  if (layout.laplacianBand >= 0) {
+    baton->sharpness = StandardDeviation(total.laplacianSum, total.laplacianSquaresSum, n);
+  }
+  // Most dominant sRGB colour via 4096-bin 3D histogram, ties going to the first bin in the order maxpos scans
+  auto const dominant = std::max_element(total.colourHist.begin(), total.colourHist.end());
+  int const bin = static_cast<int>(std::distance(total.colourHist.begin(), dominant));
+  baton->dominantRed = (bin / 16) % 16 * 16 + 8;
+  baton->dominantGreen = bin / 256 * 16 + 8;
+  baton->dominantBlue = bin % 16 * 16 + 8;
+}
+
+/*
+  Reduce the image towards maxPixels, by reloading with shrink-on-load for JPEG and WebP,
+  as PipelineWorkerExecute does, or by subsampling for anything else
+*/
+static VImage OpenStatsProxy(StatsBaton *baton, VImage image, sharp::ImageType imageType) {
+  double const pixels = static_cast<double>(image.width()) * image.height();
+  double const shrink = std::sqrt(pixels / baton->maxPixels);
+  if (shrink < 2.0 || image.get_typeof(VIPS_META_PAGE_HEIGHT) == G_TYPE_INT) {
+    // Too small to be worth it, or a multi-page image whose pages would be mixed together
+    return image;
+  }
+  // Same shrink-on-load as the pipeline with fastShrinkOnLoad, as no resize follows to soften it
+  int jpegShrinkOnLoad;
+  double scale;
+  std::tie(jpegShrinkOnLoad, scale) = sharp::ShrinkOnLoadFactors(imageType, shrink, true);
+  if (jpegShrinkOnLoad > 1 || scale != 1.0) {
+    image = sharp::ShrinkOnLoad(image, baton->input, imageType, jpegShrinkOnLoad, scale);
+  } else {
+    // Every pixel is still decoded, but only a fraction of them are measured
+    int const factor = static_cast<int>(shrink);
+    image = image.subsample(factor, factor);
+  }
+  return image;
+}
 
 void StatsWorkerExecute(StatsBaton* baton) {
   vips::VImage image;
@@ -25,54 +301,25 @@ void StatsWorkerExecute(StatsBaton* baton) {
   }
   if (imageType != sharp::ImageType::UNKNOWN) {
     try {
-      vips::VImage stats = image.stats();
-      int const bands = image.bands();
-      for (int b = 1; b <= bands; b++) {
-        ChannelStats cStats(
-          static_cast<int>(stats.getpoint(STAT_MIN_INDEX, b).front()),
-          static_cast<int>(stats.getpoint(STAT_MAX_INDEX, b).front()),
-          stats.getpoint(STAT_SUM_INDEX, b).front(),
-          stats.getpoint(STAT_SQ_SUM_INDEX, b).front(),
-          stats.getpoint(STAT_MEAN_INDEX, b).front(),
-          stats.getpoint(STAT_STDEV_INDEX, b).front(),
-          static_cast<int>(stats.getpoint(STAT_MINX_INDEX, b).front()),
-          static_cast<int>(stats.getpoint(STAT_MINY_INDEX, b).front()),
-          static_cast<int>(stats.getpoint(STAT_MAXX_INDEX, b).front()),
-          static_cast<int>(stats.getpoint(STAT_MAXY_INDEX, b).front()));
-        baton->channelStats.push_back(cStats);
+      int const inputWidth = image.width();
+      int const inputHeight = image.height();
+      if (baton->approximate) {
+        image = OpenStatsProxy(baton, image, imageType);
+        baton->samplingFactor = (static_cast<double>(inputWidth) * inputHeight) /
+          (static_cast<double>(image.width()) * image.height());
       }
-      // Image is not opaque when alpha layer is present and contains a non-mamixa value
-      if (sharp::HasAlpha(image)) {
-        double const minAlpha = static_cast<double>(stats.getpoint(STAT_MIN_INDEX, bands).front());
-        if (minAlpha != sharp::MaximumImageAlpha(image.interpretation())) {
-          baton->isOpaque = false;
+      RunFusedStats(baton, image);
+      if (image.width() != inputWidth || image.height() != inputHeight) {
+        // Map positions back to the input
+        double const xfactor = static_cast<double>(inputWidth) / image.width();
+        double const yfactor = static_cast<double>(inputHeight) / image.height();
+        for (ChannelStats &channel : baton->channelStats) {
+          channel.minX = static_cast<int>(channel.minX * xfactor);
+          channel.minY = static_cast<int>(channel.minY * yfactor);
+          channel.maxX = static_cast<int>(channel.maxX * xfactor);
+          channel.maxY = static_cast<int>(channel.maxY * yfactor);
         }
       }
-      // Convert to greyscale
-      vips::VImage greyscale = image.colourspace(VIPS_INTERPRETATION_B_W)[0];
-      // Estimate entropy via histogram of greyscale value frequency
-      baton->entropy = std::abs(greyscale.hist_find().hist_entropy());
-      // Estimate sharpness via standard deviation of greyscale laplacian
-      if (image.width() > 1 || image.height() > 1) {
-        VImage laplacian = VImage::new_matrixv(3, 3,
-          0.0,  1.0, 0.0,
-          1.0, -4.0, 1.0,
-          0.0,  1.0, 0.0);
-        laplacian.set("scale", 9.0);
-        baton->sharpness = greyscale.conv(laplacian).deviate();
-      }
-      // Most dominant sRGB colour via 4096-bin 3D histogram
-      vips::VImage hist = sharp::RemoveAlpha(image)
-        .colourspace(VIPS_INTERPRETATION_sRGB)
-        .hist_find_ndim(VImage::option()->set("bins", 16));
-      std::complex<double> maxpos = hist.maxpos();
-      int const dx = static_cast<int>(std::real(maxpos));
-      int const dy = static_cast<int>(std::imag(maxpos));
-      std::vector<double> pel = hist(dx, dy);
-      int const dz = std::distance(pel.begin(), std::find(pel.begin(), pel.end(), hist.max()));
-      baton->dominantRed = dx * 16 + 8;
-      baton->dominantGreen = dy * 16 + 8;
-      baton->dominantBlue = dz * 16 + 8;
     } catch (vips::VError const &err) {
       (baton->err).append(err.what());
     }
@@ -94,6 +341,10 @@ void DestroyStatsBaton(StatsBaton* baton) {
 
 InputDescriptor* StatsBaton_GetInput(StatsBaton* baton) { return baton->input; }
 void StatsBaton_SetInput(StatsBaton* baton, InputDescriptor* val) { baton->input = val; }
+bool StatsBaton_GetApproximate(StatsBaton* baton) { return baton->approximate; }
+void StatsBaton_SetApproximate(StatsBaton* baton, bool val) { baton->approximate = val; }
+int StatsBaton_GetMaxPixels(StatsBaton* baton) { return baton->maxPixels; }
+void StatsBaton_SetMaxPixels(StatsBaton* baton, int val) { baton->maxPixels = val; }
 ChannelStats* StatsBaton_GetChannelStats(StatsBaton* baton) { return baton->channelStats.data(); }
 void StatsBaton_SetChannelStats(StatsBaton* baton, std::vector<ChannelStats> val) { baton->channelStats = val; }
 bool StatsBaton_GetIsOpaque(StatsBaton* baton) { return baton->isOpaque; }
@@ -108,6 +359,8 @@ int StatsBaton_GetDominantGreen(StatsBaton* baton) { return baton->dominantGreen
 void StatsBaton_SetDominantGreen(StatsBaton* baton, int val) { baton->dominantGreen = val; }
 int StatsBaton_GetDominantBlue(StatsBaton* baton) { return baton->dominantBlue; }
 void StatsBaton_SetDominantBlue(StatsBaton* baton, int val) { baton->dominantBlue = val; }
+double StatsBaton_GetSamplingFactor(StatsBaton* baton) { return baton->samplingFactor; }
+void StatsBaton_SetSamplingFactor(StatsBaton* baton, double val) { baton->samplingFactor = val; }
 const char* StatsBaton_GetErr(StatsBaton* baton) { return baton->err.c_str(); }
 void StatsBaton_SetErr(StatsBaton* baton, const char* val) { baton->err = val; }
 
@@ -42,6 +42,8 @@ struct ChannelStats {
 struct StatsBaton {
   // Input
   InputDescriptor *input;
+  bool approximate;
+  int maxPixels;
 
   // Output
   std::vector<ChannelStats> channelStats;
@@ -51,17 +53,21 @@ struct StatsBaton {
   int dominantRed;
   int dominantGreen;
   int dominantBlue;
+  double samplingFactor;
 
   std::string err;
 
   StatsBaton():
     input(nullptr),
+    approximate(false),
+    maxPixels(0),
     isOpaque(true),
     entropy(0.0),
     sharpness(0.0),
     dominantRed(0),
     dominantGreen(0),
-    dominantBlue(0)
+    dominantBlue(0),
+    samplingFactor(1.0)
     {}
 };
 
@@ -73,6 +79,10 @@ extern "C" {
 
   InputDescriptor* StatsBaton_GetInput(StatsBaton* baton);
   void StatsBaton_SetInput(StatsBaton* baton, InputDescriptor* val);
+  bool StatsBaton_GetApproximate(StatsBaton* baton);
+  void StatsBaton_SetApproximate(StatsBaton* baton, bool val);
+  int StatsBaton_GetMaxPixels(StatsBaton* baton);
+  void StatsBaton_SetMaxPixels(StatsBaton* baton, int val);
   ChannelStats* StatsBaton_GetChannelStats(StatsBaton* baton);
   void StatsBaton_SetChannelStats(StatsBaton* baton, std::vector<ChannelStats> val);
   bool StatsBaton_GetIsOpaque(StatsBaton* baton);
@@ -87,6 +97,8 @@ extern "C" {
   void StatsBaton_SetDominantGreen(StatsBaton* baton, int val);
   int StatsBaton_GetDominantBlue(StatsBaton* baton);
   void StatsBaton_SetDominantBlue(StatsBaton* baton, int val);
+  double StatsBaton_GetSamplingFactor(StatsBaton* baton);
+  void StatsBaton_SetSamplingFactor(StatsBaton* baton, double val);
   const char* StatsBaton_GetErr(StatsBaton* baton);
   void StatsBaton_SetErr(StatsBaton* baton, const char* val);
 
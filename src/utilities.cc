@@ -14,6 +14,7 @@
 
 #include <cmath>
 #include <string>
+#include <vector>
 
 #include <napi.h>
 #include <vips/vips8>
@@ -22,6 +23,7 @@
 #include "common_sandbox.h"
 #include "common_host.h"
 #include "operations.h"
+#include "rlbox_mgr.h"
 #include "utilities.h"
 
 /*
@@ -42,6 +44,12 @@ Napi::Value cache(const Napi::CallbackInfo& info) {
   if (info[2].IsNumber()) {
     vips_cache_set_max(info[2].As<Napi::Number>().Int32Value());
   }
+  // The profile cache lives in the sandbox, pinned rather than leased so reading it is not a request
+  rlbox_sandbox_vips* sandbox = PinVipsSandbox();
+  // Set profile limit
+  if (info[3].IsNumber()) {
+    sandbox->invoke_sandbox_function(IccCache_SetMax, static_cast<size_t>(info[3].As<Napi::Number>().Uint32Value()));
+  }
 
   // Get memory stats
   Napi::Object memory = Napi::Object::New(env);
@@ -58,10 +66,21 @@ Napi::Value cache(const Napi::CallbackInfo& info) {
   items.Set("current", vips_cache_get_size());
   items.Set("max", vips_cache_get_max());
 
+  // Get profile stats
+  Napi::Object icc = Napi::Object::New(env);
+  icc.Set("current", static_cast<double>(sandbox->invoke_sandbox_function(IccCache_GetSize)
+    .unverified_safe_because("Only reported back to the caller")));
+  icc.Set("max", static_cast<double>(sandbox->invoke_sandbox_function(IccCache_GetMax)
+    .unverified_safe_because("Only reported back to the caller")));
+  icc.Set("skipped", static_cast<double>(sandbox->invoke_sandbox_function(IccCache_GetSkipped)
+    .unverified_safe_because("Only reported back to the caller")));
+  UnpinVipsSandbox(sandbox);
+
   Napi::Object cache = Napi::Object::New(env);
   cache.Set("memory", memory);
   cache.Set("files", files);
   cache.Set("items", items);
+  cache.Set("icc", icc);
   return cache;
 }
 
@@ -77,6 +96,94 @@ Napi::Value concurrency(const Napi::CallbackInfo& info) {
   return Napi::Number::New(info.Env(), vips_concurrency_get());
 }
 
+/*
+  Get and set size of sandbox pool
+*/
+Napi::Value sandboxes(const Napi::CallbackInfo& info) {
+  // Set pool size
+  if (info[0].IsNumber()) {
+    SetVipsSandboxPoolSize(info[0].As<Napi::Number>().Uint32Value());
+  }
+  // Get pool size
+  return Napi::Number::New(info.Env(), static_cast<double>(GetVipsSandboxPoolSize()));
+}
+
+/*
+  Get and set the sandbox recycling policy
+*/
+Napi::Value recycle(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  if (info[0].IsNumber() && info[1].IsNumber()) {
+    SetVipsSandboxRecycling(info[0].As<Napi::Number>().Uint32Value(),
+      static_cast<size_t>(info[1].As<Napi::Number>().Uint32Value()) * 1048576);
+  }
+  VipsSandboxRecycling const recycling = GetVipsSandboxRecycling();
+  Napi::Object policy = Napi::Object::New(env);
+  policy.Set("requests", static_cast<double>(recycling.requests));
+  policy.Set("memory", static_cast<double>(recycling.highwater / 1048576));
+  policy.Set("recycled", static_cast<double>(recycling.recycled));
+  return policy;
+}
+
+/*
+  Create sandboxes up front and load the given formats in each, returning the formats that loaded
+*/
+Napi::Value warmup(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  size_t const poolSize = GetVipsSandboxPoolSize();
+  size_t count = info[0].As<Napi::Number>().Uint32Value();
+  if (count == 0 || count > poolSize) {
+    count = poolSize;
+  }
+  Napi::Array suffixes = info[1].As<Napi::Array>();
+
+  // Holding every lease at once makes the pool create distinct sandboxes
+  std::vector<rlbox_sandbox_vips*> sandboxes;
+  for (size_t i = 0; i < count; i++) {
+    sandboxes.push_back(AcquireVipsSandbox());
+  }
+  Napi::Array loaded = Napi::Array::New(env);
+  for (unsigned int i = 0; i < suffixes.Length(); i++) {
+    std::string suffix = sharp::AttrAsStr(suffixes, i);
+    bool ok = true;
+    for (rlbox_sandbox_vips* sandbox : sandboxes) {
+      sharp::SandboxArena arena(sandbox);
+      ok = sandbox->invoke_sandbox_function(WarmupFormat, sharp::CopyStringToSandbox(arena, suffix.c_str()))
+        .unverified_safe_because("Only reported back to the caller") && ok;
+    }
+    if (ok) {
+      loaded.Set(loaded.Length(), suffix);
+    }
+  }
+  for (rlbox_sandbox_vips* sandbox : sandboxes) {
+    ReleaseVipsSandbox(sandbox);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("sandboxes", static_cast<double>(count));
+  result.Set("formats", loaded);
+  return result;
+}
+
+/*
+  Allocate a Buffer in sandbox memory, from which images can be read without a copy
+*/
+Napi::Value allocInputBuffer(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint32_t const length = info[0].As<Napi::Number>().Uint32Value();
+
+  rlbox_sandbox_vips* sandbox = AcquireVipsSandbox();
+  tainted_vips<char*> t_data = sandbox->malloc_in_sandbox<char>(length);
+  if (t_data == nullptr) {
+    ReleaseVipsSandbox(sandbox);
+    throw Napi::Error::New(env, "Unable to allocate input buffer");
+  }
+  // The Buffer pins the sandbox, so the lease is no longer needed
+  Napi::Buffer<char> buffer = sharp::NewBufferFromSandbox(env, sandbox, t_data, length);
+  ReleaseVipsSandbox(sandbox);
+  return buffer;
+}
+
 /*
   Get internal counters (queued tasks, processing tasks)
 */
@@ -84,6 +191,22 @@ Napi::Value counters(const Napi::CallbackInfo& info) {
   Napi::Object counters = Napi::Object::New(info.Env());
   counters.Set("queue", sharp::counterQueue);
   counters.Set("process", sharp::counterProcess);
+#ifdef SHARP_PROFILE_TRANSITIONS
+  // Sandbox transitions per symbol, with time in milliseconds
+  sharp::profile::Totals totals = sharp::profile::Collect();
+  Napi::Object symbols = Napi::Object::New(info.Env());
+  for (auto const &symbol : totals.symbols) {
+    Napi::Object entry = Napi::Object::New(info.Env());
+    entry.Set("calls", static_cast<double>(symbol.calls));
+    entry.Set("time", static_cast<double>(symbol.ns) / 1e6);
+    symbols.Set(symbol.name, entry);
+  }
+  Napi::Object transitions = Napi::Object::New(info.Env());
+  transitions.Set("symbols", symbols);
+  transitions.Set("bytesIn", static_cast<double>(totals.bytesIn));
+  transitions.Set("bytesOut", static_cast<double>(totals.bytesOut));
+  counters.Set("transitions", transitions);
+#endif
   return counters;
 }
 
@@ -19,6 +19,10 @@
 
 Napi::Value cache(const Napi::CallbackInfo& info);
 Napi::Value concurrency(const Napi::CallbackInfo& info);
+Napi::Value sandboxes(const Napi::CallbackInfo& info);
+Napi::Value recycle(const Napi::CallbackInfo& info);
+Napi::Value warmup(const Napi::CallbackInfo& info);
+Napi::Value allocInputBuffer(const Napi::CallbackInfo& info);
 Napi::Value counters(const Napi::CallbackInfo& info);
 Napi::Value simd(const Napi::CallbackInfo& info);
 Napi::Value libvipsVersion(const Napi::CallbackInfo& info);
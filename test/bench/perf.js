@@ -574,6 +574,32 @@ async.series({
             }
           });
       }
+    }).add('sharp-stats', {
+      defer: true,
+      fn: function (deferred) {
+        sharp(inputJpgBuffer)
+          .stats(function (err, stats) {
+            if (err) {
+              throw err;
+            } else {
+              assert.strictEqual(3, stats.channels.length);
+              deferred.resolve();
+            }
+          });
+      }
+    }).add('sharp-stats-approximate', {
+      defer: true,
+      fn: function (deferred) {
+        sharp(inputJpgBuffer)
+          .stats({ approximate: true }, function (err, stats) {
+            if (err) {
+              throw err;
+            } else {
+              assert.strictEqual(3, stats.channels.length);
+              deferred.resolve();
+            }
+          });
+      }
     }).on('cycle', function (event) {
       console.log('operations ' + String(event.target));
     }).on('complete', function () {
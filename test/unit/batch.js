@@ -0,0 +1,110 @@
+'use strict';
+
+const assert = require('assert');
+
+const sharp = require('../../');
+const fixtures = require('../fixtures');
+
+const collect = async function (results) {
+  const all = [];
+  for await (const result of results) {
+    all.push(result);
+  }
+  return all.sort(function (a, b) {
+    return a.index - b.index;
+  });
+};
+
+describe('batch', function () {
+  it('Processes every input through the template', async function () {
+    const thumbnail = sharp.compile(sharp().resize(32, 24).jpeg());
+    const inputs = [fixtures.inputJpg, fixtures.inputPngWithTransparency, fixtures.inputWebP];
+    const results = await collect(sharp.batch(inputs, thumbnail, { concurrency: 2 }));
+    assert.strictEqual(inputs.length, results.length);
+    results.forEach(function ({ index, data, info, error }, i) {
+      assert.strictEqual(i, index);
+      assert.strictEqual(undefined, error);
+      assert.strictEqual(true, Buffer.isBuffer(data));
+      assert.strictEqual('jpeg', info.format);
+      assert.strictEqual(32, info.width);
+      assert.strictEqual(24, info.height);
+      assert.strictEqual(data.length, info.size);
+    });
+  });
+
+  it('Reports the error of each failed input alongside the others', async function () {
+    const thumbnail = sharp.compile(sharp().resize(8).png());
+    const results = await collect(sharp.batch([fixtures.inputJpg, Buffer.from('not an image')], thumbnail));
+    assert.strictEqual(2, results.length);
+    assert.strictEqual('png', results[0].info.format);
+    assert.strictEqual(1, results[1].index);
+    assert.strictEqual(true, results[1].error instanceof Error);
+    assert.strictEqual(undefined, results[1].data);
+  });
+
+  it('Matches the output of the template applied alone', async function () {
+    const thumbnail = sharp.compile(sharp().rotate().resize(64).png());
+    const [{ data }] = await collect(sharp.batch([fixtures.inputJpgWithLandscapeExif8], thumbnail));
+    const expected = await thumbnail.toBuffer(fixtures.inputJpgWithLandscapeExif8);
+    assert.strictEqual(0, Buffer.compare(expected.data, data));
+  });
+
+  it('Reports queue length changes as inputs start and finish', async function () {
+    const lengths = [];
+    const queueListener = function (queueLength) {
+      lengths.push(queueLength);
+    };
+    sharp.queue.on('change', queueListener);
+    const thumbnail = sharp.compile(sharp().resize(8).png());
+    const results = await collect(sharp.batch([fixtures.inputJpg, fixtures.inputJpg, fixtures.inputJpg], thumbnail, { concurrency: 1 }));
+    sharp.queue.removeListener('change', queueListener);
+    assert.strictEqual(3, results.length);
+    assert.deepStrictEqual([3, 2, 1, 0], lengths);
+  });
+
+  it('Starts no further inputs once destroyed', async function () {
+    const thumbnail = sharp.compile(sharp().resize(8).png());
+    const inputs = new Array(8).fill(fixtures.inputJpg);
+    let seen = 0;
+    for await (const { error } of sharp.batch(inputs, thumbnail, { concurrency: 1 })) {
+      assert.strictEqual(undefined, error);
+      seen++;
+      break;
+    }
+    assert.strictEqual(1, seen);
+    while (sharp.counters().queue !== 0 || sharp.counters().process !== 0) {
+      await new Promise(function (resolve) {
+        setTimeout(resolve, 10);
+      });
+    }
+  });
+
+  it('Ends immediately without inputs', async function () {
+    const results = await collect(sharp.batch([], sharp.compile(sharp().jpeg())));
+    assert.strictEqual(0, results.length);
+  });
+
+  describe('Invalid parameters', function () {
+    const template = sharp.compile(sharp().jpeg());
+    it('Inputs not an Array', function () {
+      assert.throws(function () {
+        sharp.batch(fixtures.inputJpg, template);
+      }, /Expected Array of Buffer or string for inputs but received/);
+    });
+    it('Input not a Buffer or string', function () {
+      assert.throws(function () {
+        sharp.batch([1], template);
+      }, /Expected Buffer or string for input but received 1 of type number/);
+    });
+    it('Template not compiled', function () {
+      assert.throws(function () {
+        sharp.batch([], sharp());
+      }, /Expected template returned by compile for template but received/);
+    });
+    it('Concurrency out of range', function () {
+      assert.throws(function () {
+        sharp.batch([], template, { concurrency: 0 });
+      }, /Expected integer between 1 and 1024 for concurrency but received 0 of type number/);
+    });
+  });
+});
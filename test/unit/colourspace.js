@@ -124,6 +124,25 @@ describe('Colour space conversion', function () {
     assert.strictEqual(b, 34);
   });
 
+  it('From RGB16, reduced to 8-bit after resize, matches reduction at output', async function () {
+    const rgb16 = await sharp(fixtures.inputJpg)
+      .resize(64)
+      .toColourspace('rgb16')
+      .png()
+      .toBuffer();
+    const early = await sharp(rgb16)
+      .resize(16)
+      .raw()
+      .toBuffer({ resolveWithObject: true });
+    const late = await sharp(rgb16)
+      .resize(16)
+      .toColourspace('srgb', { reduceEarly: false })
+      .raw()
+      .toBuffer({ resolveWithObject: true });
+    assert.deepStrictEqual(early.info, late.info);
+    assert.strictEqual(early.data.every((value, i) => Math.abs(value - late.data[i]) <= 1), true);
+  });
+
   it('Invalid pipelineColourspace input', function () {
     assert.throws(function () {
       sharp(fixtures.inputJpg)
@@ -137,4 +156,11 @@ describe('Colour space conversion', function () {
         .toColourspace(null);
     });
   });
+
+  it('Invalid toColourspace reduceEarly', function () {
+    assert.throws(function () {
+      sharp(fixtures.inputJpg)
+        .toColourspace('srgb', { reduceEarly: 'fail' });
+    }, /Expected boolean for reduceEarly but received fail of type string/);
+  });
 });
@@ -0,0 +1,81 @@
+'use strict';
+
+const assert = require('assert');
+
+const sharp = require('../../');
+const fixtures = require('../fixtures');
+
+describe('compile', function () {
+  it('Applies the same operations to many inputs', async function () {
+    const thumbnail = sharp.compile(sharp().resize(320, 240).webp());
+    const [jpeg, png] = await Promise.all([
+      thumbnail.toBuffer(fixtures.inputJpg),
+      thumbnail.toBuffer(fixtures.inputPngWithTransparency)
+    ]);
+    assert.strictEqual('webp', jpeg.info.format);
+    assert.strictEqual(320, jpeg.info.width);
+    assert.strictEqual(240, jpeg.info.height);
+    assert.strictEqual(3, jpeg.info.channels);
+    assert.strictEqual('webp', png.info.format);
+    assert.strictEqual(4, png.info.channels);
+    assert.strictEqual(true, Buffer.isBuffer(jpeg.data));
+    assert.strictEqual(jpeg.info.size, jpeg.data.length);
+  });
+
+  it('Matches the output of the instance it was compiled from', async function () {
+    const template = sharp.compile(sharp().rotate().resize(200).greyscale().png());
+    const actual = await template.toBuffer(fixtures.inputJpgWithLandscapeExif8);
+    const expected = await sharp(fixtures.inputJpgWithLandscapeExif8)
+      .rotate().resize(200).greyscale().png()
+      .toBuffer({ resolveWithObject: true });
+    assert.deepStrictEqual(expected.info, actual.info);
+    assert.strictEqual(0, Buffer.compare(expected.data, actual.data));
+  });
+
+  it('Is unaffected by later changes to the instance', async function () {
+    const pipeline = sharp().resize(64).jpeg();
+    const template = sharp.compile(pipeline);
+    pipeline.resize(32).png();
+    const { info } = await template.toBuffer(fixtures.inputJpg);
+    assert.strictEqual('jpeg', info.format);
+    assert.strictEqual(64, info.width);
+  });
+
+  it('Accepts input options', async function () {
+    const template = sharp.compile(sharp().png());
+    const { info } = await template.toBuffer(Buffer.alloc(4 * 4 * 3), { raw: { width: 4, height: 4, channels: 3 } });
+    assert.strictEqual(4, info.width);
+    assert.strictEqual(4, info.height);
+  });
+
+  it('Rejects when the input is invalid', function () {
+    return assert.rejects(
+      function () {
+        return sharp.compile(sharp().jpeg()).toBuffer(Buffer.from('not an image'));
+      },
+      /Input buffer contains unsupported image format/
+    );
+  });
+
+  describe('Invalid parameters', function () {
+    it('Not a Sharp instance', function () {
+      assert.throws(function () {
+        sharp.compile({ width: 10 });
+      }, /Expected Sharp instance for pipeline but received \[object Object\] of type object/);
+    });
+    it('References other inputs', function () {
+      assert.throws(function () {
+        sharp.compile(sharp().composite([{ input: fixtures.inputPngWithTransparency }]));
+      }, /Compiled pipelines can not reference other inputs/);
+      assert.throws(function () {
+        sharp.compile(sharp().joinChannel(fixtures.inputJpg));
+      }, /Compiled pipelines can not reference other inputs/);
+    });
+    it('Missing input', function () {
+      const template = sharp.compile(sharp().jpeg());
+      assert.throws(function () {
+        template.toBuffer();
+      }, /Unsupported input 'undefined' of type undefined/);
+    });
+  });
+});
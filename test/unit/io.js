@@ -150,6 +150,46 @@ describe('Input/output', function () {
     readable.pipe(pipeline).pipe(writable);
   });
 
+  it('Read from sandbox-allocated Buffer and write to Buffer', async () => {
+    const jpeg = fs.readFileSync(fixtures.inputJpg);
+    const input = sharp.allocInputBuffer(jpeg.length);
+    jpeg.copy(input);
+    const { data, info } = await sharp(input)
+      .resize(320, 240)
+      .toBuffer({ resolveWithObject: true });
+
+    assert.strictEqual(true, data.length > 0);
+    assert.strictEqual(data.length, info.size);
+    assert.strictEqual('jpeg', info.format);
+    assert.strictEqual(320, info.width);
+    assert.strictEqual(240, info.height);
+  });
+
+  it('Read from a view into a sandbox-allocated Buffer', async () => {
+    const jpeg = fs.readFileSync(fixtures.inputJpg);
+    const input = sharp.allocInputBuffer(jpeg.length + 16);
+    jpeg.copy(input, 16);
+    const { width, height } = await sharp(input.subarray(16)).metadata();
+    assert.strictEqual(2725, width);
+    assert.strictEqual(2225, height);
+  });
+
+  it('Use Buffer output as Buffer input', async () => {
+    const first = await sharp(fixtures.inputJpg).resize(320, 240).toBuffer();
+    const { info } = await sharp(first).resize(32, 24).toBuffer({ resolveWithObject: true });
+    assert.strictEqual(32, info.width);
+    assert.strictEqual(24, info.height);
+  });
+
+  it('Fail when sandbox-allocated Buffer size is invalid', function () {
+    assert.throws(function () {
+      sharp.allocInputBuffer(0);
+    }, /Expected integer between 1 and 2147483647 for size but received 0 of type number/);
+    assert.throws(function () {
+      sharp.allocInputBuffer('spoons');
+    });
+  });
+
   it('Read from Uint8Array and write to Buffer', async () => {
     const uint8array = Uint8Array.from([255, 255, 255, 0, 0, 0]);
     const { data, info } = await sharp(uint8array, {
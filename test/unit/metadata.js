@@ -792,6 +792,103 @@ describe('Image metadata', function () {
       });
   });
 
+  describe('Header-only', function () {
+    it('JPEG matches full metadata', async () => {
+      const full = await sharp(fixtures.inputJpg).metadata();
+      const header = await sharp(fixtures.inputJpg).metadata({ headerOnly: true });
+      assert.strictEqual(true, header.headerComplete);
+      assert.strictEqual(full.format, header.format);
+      assert.strictEqual(full.width, header.width);
+      assert.strictEqual(full.height, header.height);
+      assert.strictEqual(full.channels, header.channels);
+      assert.strictEqual('undefined', typeof full.headerComplete);
+    });
+
+    it('Truncated JPEG prefix that contains the header', async () => {
+      const prefix = fs.readFileSync(fixtures.inputJpg).subarray(0, 64 * 1024);
+      const { format, width, height, headerComplete } = await sharp(prefix, { failOnError: false })
+        .metadata({ headerOnly: true });
+      assert.strictEqual('jpeg', format);
+      assert.strictEqual(2725, width);
+      assert.strictEqual(2225, height);
+      assert.strictEqual(true, headerComplete);
+    });
+
+    it('Truncated PNG prefix that ends before the header', async () => {
+      const prefix = fs.readFileSync(fixtures.inputPng).subarray(0, 16);
+      const metadata = await sharp(prefix).metadata({ headerOnly: true });
+      assert.deepStrictEqual({ format: 'png', headerComplete: false }, metadata);
+    });
+
+    it('Corrupt PNG header is an error rather than incomplete', () => {
+      const signature = fs.readFileSync(fixtures.inputPng).subarray(0, 8);
+      const corrupt = Buffer.concat([signature, Buffer.alloc(64, 'A')]);
+      return assert.rejects(
+        () => sharp(corrupt).metadata({ headerOnly: true }),
+        /Input buffer has corrupt header/
+      );
+    });
+
+    it('Raw input fails fast', () =>
+      assert.rejects(
+        () => sharp(Buffer.alloc(4), { raw: { width: 2, height: 2, channels: 1 } }).metadata({ headerOnly: true }),
+        /Header-only metadata requires encoded input/
+      )
+    );
+
+    it('Invalid headerOnly option throws', function () {
+      assert.throws(function () {
+        sharp().metadata({ headerOnly: 'yes' });
+      }, /Expected boolean for metadataHeaderOnly but received yes of type string/);
+    });
+  });
+
+  describe('metadataMany', function () {
+    it('Files and Buffers, with failures', async () => {
+      const inputs = [
+        fixtures.inputJpg,
+        fs.readFileSync(fixtures.inputPng),
+        fixtures.inputWebP,
+        fixtures.path('does-not-exist.jpg'),
+        Buffer.from('not an image')
+      ];
+      const metadata = await sharp.metadataMany(inputs, { concurrency: 2 });
+      assert.strictEqual(5, metadata.length);
+      assert.ok(metadata.width instanceof Uint32Array);
+      assert.ok(metadata.format instanceof Uint8Array);
+      const formats = Array.from(metadata.format, id => metadata.formats[id]);
+      assert.deepStrictEqual(['jpeg', 'png', 'webp', 'unknown', 'unknown'], formats);
+      assert.deepStrictEqual([2725, 2809, 1024, 0, 0], Array.from(metadata.width));
+      assert.deepStrictEqual([2225, 2074, 772, 0, 0], Array.from(metadata.height));
+      assert.deepStrictEqual([3, 1, 3, 0, 0], Array.from(metadata.channels));
+      assert.deepStrictEqual([3, 4], metadata.errors.map(error => error.index));
+      assert.ok(metadata.errors[0].message.includes('Input file is missing'));
+    });
+
+    it('Matches metadata of a single input', async () => {
+      const single = await sharp(fixtures.inputGif).metadata();
+      const many = await sharp.metadataMany([fixtures.inputGif], { headerOnly: true });
+      assert.strictEqual(single.width, many.width[0]);
+      assert.strictEqual(single.height, many.height[0]);
+      assert.strictEqual(single.channels, many.channels[0]);
+      assert.strictEqual(single.hasAlpha ? 1 : 0, many.hasAlpha[0]);
+    });
+
+    it('Empty list', async () => {
+      const metadata = await sharp.metadataMany([]);
+      assert.strictEqual(0, metadata.length);
+      assert.strictEqual(0, metadata.width.length);
+      assert.deepStrictEqual([], metadata.errors);
+    });
+
+    it('Invalid parameters', function () {
+      assert.throws(() => sharp.metadataMany('fail'), /Expected Array of Buffer or string for inputs/);
+      assert.throws(() => sharp.metadataMany([1]), /Expected Buffer or string for input/);
+      assert.throws(() => sharp.metadataMany([], { concurrency: 0 }), /Expected integer between 1 and 1024 for concurrency/);
+      assert.throws(() => sharp.metadataMany([], { headerOnly: 1 }), /Expected boolean for headerOnly/);
+    });
+  });
+
   describe('Invalid withMetadata parameters', function () {
     it('String orientation', function () {
       assert.throws(function () {
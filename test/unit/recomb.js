@@ -118,6 +118,24 @@ describe('Recomb', function () {
       });
   });
 
+  it('combines with linear, extractChannel and ensureAlpha', async () => {
+    const { data, info } = await sharp({
+      create: { width: 1, height: 1, channels: 3, background: { r: 10, g: 20, b: 30 } }
+    })
+      .recomb([
+        [0, 1, 0],
+        [0, 0, 1],
+        [1, 0, 0]
+      ])
+      .linear(2, 5)
+      .extractChannel(1)
+      .ensureAlpha()
+      .raw()
+      .toBuffer({ resolveWithObject: true });
+    assert.strictEqual(2, info.channels);
+    assert.deepStrictEqual([65, 255], Array.from(data));
+  });
+
   describe('invalid matrix specification', function () {
     it('missing', function () {
       assert.throws(function () {
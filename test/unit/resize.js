@@ -760,6 +760,60 @@ describe('Resize dimensions', function () {
     assert.strictEqual(height, 334);
   });
 
+  it('reorderTolerance defers negate until after the reduction', async () => {
+    const plans = [];
+    const pipeline = sharp(fixtures.inputJpg)
+      .resize(320, 240, { reorderTolerance: 1 })
+      .negate();
+    pipeline.on('plan', plan => plans.push(plan));
+    const { data, info } = await pipeline.raw().toBuffer({ resolveWithObject: true });
+    assert.strictEqual(320, info.width);
+    assert.strictEqual(240, info.height);
+    assert.strictEqual(1, plans.length);
+    assert.ok(plans[0].includes('after resize [negate]'));
+
+    const expected = await sharp(fixtures.inputJpg)
+      .resize(320, 240)
+      .negate()
+      .raw()
+      .toBuffer();
+    for (let i = 0; i < data.length; i++) {
+      assert.ok(Math.abs(data[i] - expected[i]) <= 1);
+    }
+  });
+
+  it('point-wise operations keep their order by default', async () => {
+    const plans = [];
+    const pipeline = sharp(fixtures.inputJpg)
+      .resize(320, 240)
+      .negate();
+    pipeline.on('plan', plan => plans.push(plan));
+    await pipeline.toBuffer();
+    assert.strictEqual(1, plans.length);
+    assert.ok(/before resize \[[^\]]*negate\]/.test(plans[0]));
+    assert.ok(plans[0].includes('after resize [none]'));
+  });
+
+  it('greyscale of a colour image runs before the reduction', async () => {
+    const plans = [];
+    const pipeline = sharp(fixtures.inputJpg)
+      .resize(320, 240, { reorderTolerance: 255 })
+      .negate()
+      .greyscale();
+    pipeline.on('plan', plan => plans.push(plan));
+    const { info } = await pipeline.raw().toBuffer({ resolveWithObject: true });
+    assert.strictEqual(1, info.channels);
+    assert.strictEqual(1, plans.length);
+    assert.ok(/before resize \[[^\]]*negate, greyscale\]/.test(plans[0]));
+    assert.ok(plans[0].includes('after resize [none]'));
+  });
+
+  it('invalid reorderTolerance throws', function () {
+    assert.throws(function () {
+      sharp().resize(320, 240, { reorderTolerance: 256 });
+    }, /Expected number between 0 and 255 for reorderTolerance but received 256 of type number/);
+  });
+
   it('unknown kernel throws', function () {
     assert.throws(function () {
       sharp().resize(null, null, { kernel: 'unknown' });
@@ -390,4 +390,11 @@ describe('Rotation', function () {
         fixtures.assertSimilar(fixtures.expected('rotate-and-flop.jpg'), data, done);
       });
   });
+
+  it('Rotate by 180, flip and flop cancel out', async () => {
+    const input = sharp(fixtures.inputJpg).resize(32, 24);
+    const expected = await input.clone().raw().toBuffer();
+    const actual = await input.clone().rotate(180).flip().flop().raw().toBuffer();
+    assert.deepStrictEqual(expected, actual);
+  });
 });
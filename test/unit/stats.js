@@ -722,6 +722,37 @@ describe('Image Stats', function () {
       });
   });
 
+  describe('Approximate', function () {
+    it('JPEG is reduced and reports the sampling factor', async () => {
+      const full = await sharp(fixtures.inputJpg).stats();
+      const approximate = await sharp(fixtures.inputJpg).stats({ approximate: true });
+      assert.strictEqual('undefined', typeof full.samplingFactor);
+      // 2725x2225 needs a shrink of 2.4, too close to 2 for libjpeg, so is subsampled by 2
+      assert.strictEqual(true, isInRange(approximate.samplingFactor, 3.99, 4.01));
+      assert.strictEqual(full.isOpaque, approximate.isOpaque);
+      assert.strictEqual(true, Math.abs(approximate.entropy - full.entropy) / full.entropy < 0.02);
+      assert.strictEqual(true, Math.abs(approximate.channels[0].mean - full.channels[0].mean) / full.channels[0].mean < 0.02);
+      assert.strictEqual(true, isInRange(approximate.channels[0].maxX, 0, 2725));
+      assert.strictEqual(true, isInRange(approximate.channels[0].maxY, 0, 2225));
+    });
+
+    it('Smaller maxPixels uses shrink-on-load', async () => {
+      const { samplingFactor } = await sharp(fixtures.inputJpg).stats({ approximate: true, maxPixels: 65536 });
+      assert.strictEqual(true, samplingFactor > 60);
+    });
+
+    it('Small input is not reduced', async () => {
+      const { samplingFactor } = await sharp(fixtures.inputPngWithOneColor).stats({ approximate: true });
+      assert.strictEqual(1, samplingFactor);
+    });
+
+    it('Invalid parameters', function () {
+      assert.throws(() => sharp().stats({ approximate: 'fail' }), /Expected boolean for statsApproximate but received fail of type string/);
+      assert.throws(() => sharp().stats({ maxPixels: 0 }), /Expected integer between 1 and 2147483647 for maxPixels but received 0 of type number/);
+      assert.throws(() => sharp().stats({ maxPixels: 2147483648 }), /Expected integer between 1 and 2147483647 for maxPixels but received 2147483648 of type number/);
+    });
+  });
+
   it('Non-existent file in, Promise out', function (done) {
     sharp('fail').stats().then(function (stats) {
       throw new Error('Non-existent file');
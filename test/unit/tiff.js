@@ -449,6 +449,23 @@ describe('TIFF', function () {
       });
   });
 
+  it('TIFF page pyramid input is reduced from a smaller level', async () => {
+    const pyramid = await sharp(fixtures.inputJpg)
+      .tiff({ pyramid: true, tile: true, tileWidth: 256, tileHeight: 256 })
+      .toBuffer();
+    // Pages of 2725x2225 halve to 1362x1112, 681x556 and 340x278, the smallest still covering 320x240
+    const level = await sharp(pyramid, { page: 3 }).metadata();
+    assert.strictEqual(340, level.width);
+    assert.strictEqual(278, level.height);
+    const [reduced, fromLevel] = await Promise.all([
+      sharp(pyramid).resize(320, 240).raw().toBuffer({ resolveWithObject: true }),
+      sharp(pyramid, { page: 3 }).resize(320, 240).raw().toBuffer()
+    ]);
+    assert.strictEqual(320, reduced.info.width);
+    assert.strictEqual(240, reduced.info.height);
+    assert.strictEqual(0, Buffer.compare(fromLevel, reduced.data));
+  });
+
   it('TIFF pyramid true value does not throw error', function () {
     assert.doesNotThrow(function () {
       sharp().tiff({ pyramid: true });
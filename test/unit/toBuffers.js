@@ -0,0 +1,115 @@
+'use strict';
+
+const fs = require('fs');
+const assert = require('assert');
+
+const sharp = require('../../');
+const fixtures = require('../fixtures');
+
+describe('toBuffers', function () {
+  it('Returns every output in the order requested', async function () {
+    const outputs = await sharp(fixtures.inputJpg)
+      .toBuffers([
+        { resize: { width: 300 }, format: 'webp' },
+        { resize: { width: 1200 }, format: 'jpeg', options: { quality: 80 } },
+        { resize: { width: 600 }, format: 'png' }
+      ]);
+    assert.strictEqual(3, outputs.length);
+    const [small, large, medium] = outputs;
+    assert.strictEqual('webp', small.info.format);
+    assert.strictEqual(300, small.info.width);
+    assert.strictEqual('jpeg', large.info.format);
+    assert.strictEqual(1200, large.info.width);
+    assert.strictEqual('png', medium.info.format);
+    assert.strictEqual(600, medium.info.width);
+    outputs.forEach(function ({ data, info }) {
+      assert.strictEqual(true, Buffer.isBuffer(data));
+      assert.strictEqual(info.size, data.length);
+    });
+  });
+
+  it('Matches the dimensions of separate pipelines', async function () {
+    const widths = [1600, 800, 400, 200, 100];
+    const outputs = await sharp(fixtures.inputJpg)
+      .toBuffers(widths.map(width => ({ resize: { width } })));
+    for (let i = 0; i < widths.length; i++) {
+      const { info } = await sharp(fixtures.inputJpg)
+        .resize(widths[i])
+        .toBuffer({ resolveWithObject: true });
+      assert.strictEqual('jpeg', outputs[i].info.format);
+      assert.strictEqual(info.width, outputs[i].info.width);
+      assert.strictEqual(info.height, outputs[i].info.height);
+    }
+  });
+
+  it('Applies operations of the instance to every output', async function () {
+    const outputs = await sharp(fixtures.inputJpgWithLandscapeExif8)
+      .rotate()
+      .greyscale()
+      .toBuffers([
+        { resize: { width: 300 }, format: 'jpeg' },
+        { resize: { width: 100 }, format: 'jpeg' }
+      ]);
+    assert.strictEqual(300, outputs[0].info.width);
+    assert.strictEqual(225, outputs[0].info.height);
+    assert.strictEqual(100, outputs[1].info.width);
+    assert.strictEqual(75, outputs[1].info.height);
+    outputs.forEach(function ({ info }) {
+      assert.strictEqual(1, info.channels);
+    });
+  });
+
+  it('Keeps the alpha channel', async function () {
+    const outputs = await sharp(fixtures.inputPngWithTransparency)
+      .toBuffers([
+        { resize: { width: 512 }, format: 'png' },
+        { resize: { width: 128 }, format: 'webp' }
+      ]);
+    outputs.forEach(function ({ info }) {
+      assert.strictEqual(4, info.channels);
+    });
+  });
+
+  it('Reads a Stream input once it has finished', async function () {
+    const pipeline = sharp();
+    fs.createReadStream(fixtures.inputJpg).pipe(pipeline);
+    const outputs = await pipeline.toBuffers([
+      { resize: { width: 320 } },
+      { resize: { width: 80 } }
+    ]);
+    assert.strictEqual(320, outputs[0].info.width);
+    assert.strictEqual(80, outputs[1].info.width);
+  });
+
+  it('Rejects when the input is invalid', function () {
+    return assert.rejects(
+      function () {
+        return sharp(Buffer.from('not an image')).toBuffers([{ resize: { width: 10 } }]);
+      },
+      /Input buffer contains unsupported image format/
+    );
+  });
+
+  describe('Invalid parameters', function () {
+    it('Outputs not an Array', function () {
+      assert.throws(function () {
+        sharp().toBuffers({ resize: { width: 10 } });
+      }, /Expected non-empty Array for outputs but received \[object Object\] of type object/);
+    });
+    it('Outputs empty', function () {
+      assert.throws(function () {
+        sharp().toBuffers([]);
+      }, /Expected non-empty Array for outputs but received  of type object/);
+    });
+    it('Output not an object', function () {
+      assert.throws(function () {
+        sharp().toBuffers([100]);
+      }, /Expected object for outputs\[0\] but received 100 of type number/);
+    });
+    it('Invalid format', function () {
+      assert.throws(function () {
+        sharp(fixtures.inputJpg).toBuffers([{ format: 'zoinks' }]);
+      }, /Expected one of/);
+    });
+  });
+});
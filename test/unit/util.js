@@ -2,6 +2,7 @@
 
 const assert = require('assert');
 const sharp = require('../../');
+const fixtures = require('../fixtures');
 
 describe('Utilities', function () {
   describe('Cache', function () {
@@ -15,12 +16,44 @@ describe('Utilities', function () {
       assert.strictEqual(cache.files.max, 0);
       assert.strictEqual(cache.items.current, 0);
       assert.strictEqual(cache.items.max, 0);
+      assert.strictEqual(cache.icc.current, 0);
+      assert.strictEqual(cache.icc.max, 0);
     });
     it('Can be enabled with defaults', function () {
       const cache = sharp.cache(true);
       assert.strictEqual(cache.memory.max, 50);
       assert.strictEqual(cache.files.max, 20);
       assert.strictEqual(cache.items.max, 100);
+      assert.strictEqual(cache.icc.max, 64);
+    });
+    it('Remembers embedded profiles that cannot be transformed', async function () {
+      // Insert an APP2 ICC_PROFILE segment holding a profile that lcms rejects after the JPEG SOI marker
+      const jpeg = await sharp({ create: { width: 16, height: 16, channels: 3, background: 'red' } }).jpeg().toBuffer();
+      const marker = Buffer.concat([Buffer.from('ICC_PROFILE\0'), Buffer.from([1, 1]), Buffer.alloc(132, 0x5a)]);
+      const length = Buffer.alloc(2);
+      length.writeUInt16BE(marker.length + 2);
+      const input = Buffer.concat([jpeg.slice(0, 2), Buffer.from([0xff, 0xe2]), length, marker, jpeg.slice(2)]);
+
+      sharp.cache({ icc: 0 });
+      const uncached = await sharp(input).resize(8).raw().toBuffer();
+      sharp.cache(true);
+      const first = await sharp(input).resize(8).raw().toBuffer();
+      const afterFirst = sharp.cache().icc;
+      const second = await sharp(input).resize(8).raw().toBuffer();
+      const afterSecond = sharp.cache().icc;
+      assert.strictEqual(1, afterFirst.current);
+      assert.strictEqual(afterFirst.skipped + 1, afterSecond.skipped);
+      assert.strictEqual(0, Buffer.compare(uncached, first));
+      assert.strictEqual(0, Buffer.compare(uncached, second));
+    });
+    it('Does not remember embedded profiles that transform', async function () {
+      sharp.cache({ icc: 0 });
+      const before = sharp.cache(true).icc;
+      await sharp(fixtures.inputPngP3).resize(8).toBuffer();
+      await sharp(fixtures.inputPngP3).resize(8).toBuffer();
+      const after = sharp.cache().icc;
+      assert.strictEqual(0, after.current);
+      assert.strictEqual(before.skipped, after.skipped);
     });
     it('Can be set to zero', function () {
       const cache = sharp.cache({
@@ -67,6 +100,80 @@ describe('Utilities', function () {
     });
   });
 
+  describe('Sandboxes', function () {
+    it('Can be set to use 8 sandboxes', function () {
+      sharp.sandboxes(8);
+      assert.strictEqual(8, sharp.sandboxes());
+    });
+    it('Can be reset to default', function () {
+      sharp.sandboxes(0);
+      assert.strictEqual(true, sharp.sandboxes() > 0);
+    });
+    it('Ignores invalid values', function () {
+      const defaultSandboxes = sharp.sandboxes();
+      sharp.sandboxes('spoons');
+      sharp.sandboxes(-1);
+      assert.strictEqual(defaultSandboxes, sharp.sandboxes());
+    });
+  });
+
+  describe('Recycle', function () {
+    afterEach(function () {
+      sharp.recycle({ requests: 0, memory: 0 });
+    });
+    it('Can be set and reset', function () {
+      const policy = sharp.recycle({ requests: 10, memory: 256 });
+      assert.strictEqual(10, policy.requests);
+      assert.strictEqual(256, policy.memory);
+      assert.strictEqual('number', typeof policy.recycled);
+      const reset = sharp.recycle({});
+      assert.strictEqual(0, reset.requests);
+      assert.strictEqual(0, reset.memory);
+    });
+    it('Retires sandboxes after a number of requests', async function () {
+      const before = sharp.recycle().recycled;
+      sharp.recycle({ requests: 1 });
+      for (let i = 0; i < 3; i++) {
+        const { info } = await sharp(fixtures.inputJpg).resize(8).toBuffer({ resolveWithObject: true });
+        assert.strictEqual(8, info.width);
+      }
+      assert.strictEqual(true, sharp.recycle().recycled >= before + 3);
+    });
+    it('Invalid requests throws', function () {
+      assert.throws(function () {
+        sharp.recycle({ requests: -1 });
+      }, /Expected integer between 0 and 4294967295 for requests but received -1 of type number/);
+    });
+    it('Invalid memory throws', function () {
+      assert.throws(function () {
+        sharp.recycle({ memory: 'spoons' });
+      }, /Expected integer between 0 and 4294967295 for memory but received spoons of type string/);
+    });
+  });
+
+  describe('Warmup', function () {
+    it('Creates sandboxes and loads formats', function () {
+      const warmed = sharp.warmup({ sandboxes: 2, formats: ['jpeg', 'png'] });
+      assert.strictEqual(2, warmed.sandboxes);
+      assert.deepStrictEqual(['jpeg', 'png'], warmed.formats);
+    });
+    it('Defaults to the size of the sandbox pool', function () {
+      const warmed = sharp.warmup();
+      assert.strictEqual(sharp.sandboxes(), warmed.sandboxes);
+      assert.deepStrictEqual([], warmed.formats);
+    });
+    it('Invalid sandboxes throws', function () {
+      assert.throws(function () {
+        sharp.warmup({ sandboxes: -1 });
+      }, /Expected positive integer for sandboxes but received -1 of type number/);
+    });
+    it('Invalid formats throws', function () {
+      assert.throws(function () {
+        sharp.warmup({ formats: ['spoons'] });
+      }, /Expected array containing any of: .* for formats/);
+    });
+  });
+
   describe('Counters', function () {
     it('Have zero value at rest', (done) => {
       queueMicrotask(() => {
@@ -76,6 +183,18 @@ describe('Utilities', function () {
         done();
       });
     });
+    it('Report sandbox transitions when profiled', async function () {
+      if (!sharp.counters().transitions) {
+        return this.skip();
+      }
+      const calls = (counters) => (counters.transitions.symbols.PipelineWorkerExecute || { calls: 0 }).calls;
+      const before = sharp.counters();
+      await sharp(fixtures.inputJpg).resize(8).toBuffer();
+      const after = sharp.counters();
+      assert.strictEqual(calls(after), calls(before) + 1);
+      assert.strictEqual(after.transitions.symbols.PipelineWorkerExecute.time >= 0, true);
+      assert.strictEqual(after.transitions.bytesIn > before.transitions.bytesIn, true);
+    });
   });
 
   describe('SIMD', function () {